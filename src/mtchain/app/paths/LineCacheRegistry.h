@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_APP_PATHS_LINECACHEREGISTRY_H_INCLUDED
+#define MTCHAIN_APP_PATHS_LINECACHEREGISTRY_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <memory>
+#include <mutex>
+
+namespace mtchain {
+
+/** Hands out one line cache per ledger to concurrent path requests.
+
+    Each path request used to build its own RippleLineCache, reading
+    the same trust lines again for every request against the same
+    ledger. The registry returns the cache already in use for a ledger
+    if there is one, and otherwise makes a new one. It only holds weak
+    references: a ledger's cache goes away with the last request using
+    it, so caches of old ledgers are never kept alive.
+
+    `Cache` must be safe to use from several threads at once, as
+    RippleLineCache is.
+*/
+template <class Cache>
+class LineCacheRegistry
+{
+public:
+    /** Returns the cache for a ledger.
+
+        @param make Called with no arguments to create the cache
+                    if there is none.
+    */
+    template <class Make>
+    std::shared_ptr<Cache>
+    get (uint256 const& ledgerHash, Make&& make)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+
+        auto& slot = caches_[ledgerHash];
+        if (auto cache = slot.lock ())
+        {
+            ++shared_;
+            return cache;
+        }
+
+        // Drop the entries of caches which are no longer in use
+        for (auto iter = caches_.begin (); iter != caches_.end ();)
+        {
+            if (iter->first != ledgerHash && iter->second.expired ())
+                iter = caches_.erase (iter);
+            else
+                ++iter;
+        }
+
+        std::shared_ptr<Cache> cache = make ();
+        caches_[ledgerHash] = cache;
+        ++created_;
+        return cache;
+    }
+
+    /** Returns the number of caches created. */
+    std::size_t
+    created () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return created_;
+    }
+
+    /** Returns how often a request was given an existing cache. */
+    std::size_t
+    shared () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return shared_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    hash_map<uint256, std::weak_ptr<Cache>> caches_;
+    std::size_t created_ = 0;
+    std::size_t shared_ = 0;
+};
+
+} //
+
+#endif
@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_APP_PATHS_PARALLELPATHSEARCH_H_INCLUDED
+#define MTCHAIN_APP_PATHS_PARALLELPATHSEARCH_H_INCLUDED
+
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace mtchain {
+
+/** The point at which a path search should stop and report.
+
+    Searches poll expired() between steps and, once it returns true,
+    return the best paths they have found so far.
+*/
+class SearchDeadline
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    explicit
+    SearchDeadline (clock_type::time_point when)
+        : when_ (when)
+    {
+    }
+
+    /** A deadline this far from now. */
+    template <class Rep, class Period>
+    explicit
+    SearchDeadline (std::chrono::duration<Rep, Period> d)
+        : when_ (clock_type::now () + d)
+    {
+    }
+
+    bool
+    expired () const
+    {
+        return cancelled_.load (std::memory_order_relaxed) ||
+            clock_type::now () >= when_;
+    }
+
+    /** Make the deadline expire now. */
+    void
+    cancel ()
+    {
+        cancelled_ = true;
+    }
+
+    clock_type::time_point
+    when () const
+    {
+        return when_;
+    }
+
+private:
+    clock_type::time_point const when_;
+    std::atomic<bool> cancelled_ {false};
+};
+
+/** Run independent path searches, such as one per source currency,
+    on several threads.
+
+    Each search is run as
+
+        Result search (std::size_t i, SearchDeadline const& deadline)
+
+    and is expected to return early, with what it has, once the
+    deadline expires. Searches which have not started by then are
+    not run, and their slot in the result is empty.
+
+    If a search throws, the remaining searches are not started and
+    the first exception is rethrown once all threads have finished.
+*/
+template <class Result, class Search>
+std::vector<boost::optional<Result>>
+searchInParallel (std::size_t count, std::size_t threads,
+    SearchDeadline const& deadline, Search&& search)
+{
+    std::vector<boost::optional<Result>> results (count);
+    std::atomic<std::size_t> next {0};
+    std::atomic<bool> failed {false};
+    std::exception_ptr error;
+
+    auto worker = [&]
+    {
+        for (;;)
+        {
+            auto const i = next++;
+            if (i >= count || failed || deadline.expired ())
+                return;
+            try
+            {
+                results[i].emplace (search (i, deadline));
+            }
+            catch (...)
+            {
+                if (! failed.exchange (true))
+                    error = std::current_exception ();
+                return;
+            }
+        }
+    };
+
+    threads = std::max<std::size_t> (1, std::min (threads, count));
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (std::size_t t = 1; t < threads; ++t)
+        workers.emplace_back (worker);
+    worker ();
+    for (auto& w : workers)
+        w.join ();
+
+    if (error)
+        std::rethrow_exception (error);
+    return results;
+}
+
+} //
+
+#endif
@@ -0,0 +1,194 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_APP_PATHS_PATHREQUESTTRACKER_H_INCLUDED
+#define MTCHAIN_APP_PATHS_PATHREQUESTTRACKER_H_INCLUDED
+
+#include <mtchain/ledger/DependencyIndex.h>
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace mtchain {
+
+/** Decides which path_find subscriptions a closed ledger affects.
+
+    After each computation of a request, computed() records what the
+    search read: the keys of the trust lines it followed and the
+    account root of every account it visited, including the source and
+    destination; the books it considered; and every issue it searched.
+    Account
+    roots matter beyond balances: creating or deleting a trust line or
+    offer changes the owner count in the account root of its owners,
+    so a new line out of an intermediate account, which may open a new
+    path, shows up in the metadata through them.
+
+    Books are matched on their bookBase, not on the directory keys: an
+    offer at a new quality creates a directory no search has read. A
+    book created by the ledger, whose first offer went into an empty
+    book, was not there for the search to consider at all, so it
+    affects every request which searched both its issues.
+
+    When a ledger closes, only requests depending on something it
+    changed need to be recomputed; the results of the others are still
+    what a fresh search would return.
+
+    New requests are recomputed at the next close. If a ledger is
+    skipped, nothing is known about what changed, so every request is
+    recomputed.
+*/
+template <class Id, class Issue>
+class PathRequestTracker
+{
+public:
+    /** Counters, as returned by getStats. */
+    struct Stats
+    {
+        std::uint64_t closes = 0;
+        std::uint64_t recomputed = 0;   // requests returned for update
+        std::uint64_t skipped = 0;      // requests left alone
+    };
+
+    /** Track a new request. */
+    void
+    add (Id const& id)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        requests_.insert (id);
+        dirty_.insert (id);
+    }
+
+    /** Stop tracking a request. */
+    void
+    remove (Id const& id)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        requests_.erase (id);
+        dirty_.erase (id);
+        deps_.erase (id);
+        issues_.erase (id);
+    }
+
+    /** Record what the latest computation of a request read.
+
+        @param seq The sequence of the closed ledger the search ran
+                   against. If another ledger has closed since, the
+                   result may already be stale and the request stays
+                   due for recomputation.
+        @param entries The keys of the trust lines and account roots.
+        @param books A directory key of each book considered.
+        @param issues The issues searched.
+    */
+    void
+    computed (Id const& id, std::uint32_t seq,
+        std::vector<uint256> entries, std::vector<uint256> const& books = {},
+            std::vector<Issue> issues = {})
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (requests_.count (id) == 0)
+            return;
+        if (seq == seq_)
+            dirty_.erase (id);
+        for (auto const& dir : books)
+            entries.push_back (bookBase (dir));
+        deps_.insert (id, std::move (entries));
+        issues_[id] = std::move (issues);
+    }
+
+    /** Returns the requests to recompute after a ledger closed.
+
+        @param seq The sequence of the closed ledger.
+        @param modified The keys of the entries other than book
+                        directories it created, modified or deleted.
+        @param books The keys of the book directories it created,
+                     modified or deleted.
+        @param newBooks The in and out issues of each book which had
+                        no directory before the ledger.
+    */
+    std::vector<Id>
+    onLedgerClosed (std::uint32_t seq, std::vector<uint256> modified,
+        std::vector<uint256> const& books = {},
+            std::vector<std::pair<Issue, Issue>> const& newBooks = {})
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+
+        bool const gap = seq_ != 0 && seq != seq_ + 1;
+        seq_ = seq;
+        ++stats_.closes;
+
+        if (gap)
+        {
+            dirty_.insert (requests_.begin (), requests_.end ());
+        }
+        else
+        {
+            for (auto const& dir : books)
+                modified.push_back (bookBase (dir));
+            for (auto const& id : deps_.affected (modified))
+                dirty_.insert (id);
+
+            for (auto const& book : newBooks)
+            {
+                for (auto const& e : issues_)
+                {
+                    if (searched (e.second, book.first) &&
+                            searched (e.second, book.second))
+                        dirty_.insert (e.first);
+                }
+            }
+        }
+
+        // Requests stay dirty until recomputed, in case the update
+        // is abandoned for a later ledger.
+        std::vector<Id> result (dirty_.begin (), dirty_.end ());
+        stats_.recomputed += result.size ();
+        stats_.skipped += requests_.size () - result.size ();
+        return result;
+    }
+
+    std::size_t
+    size () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return requests_.size ();
+    }
+
+    Stats
+    getStats () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return stats_;
+    }
+
+private:
+    static
+    bool
+    searched (std::vector<Issue> const& issues, Issue const& issue)
+    {
+        return std::find (issues.begin (), issues.end (), issue) !=
+            issues.end ();
+    }
+
+    mutable std::mutex mutex_;
+    std::uint32_t seq_ = 0;
+    hash_set<Id> requests_;
+    hash_set<Id> dirty_;
+    DependencyIndex<Id> deps_;
+    hash_map<Id, std::vector<Issue>> issues_;
+    Stats stats_;
+};
+
+} //
+
+#endif
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_BASICS_CACHEGOVERNOR_H_INCLUDED
+#define MTCHAIN_BASICS_CACHEGOVERNOR_H_INCLUDED
+
+#include <mtchain/beast/utility/Journal.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+
+/** Divides a memory budget between caches according to their usefulness.
+
+    Each registered cache reports how many entries it holds, roughly how
+    many bytes they occupy, and its cumulative hit and miss counts. On
+    every call to rebalance() the governor measures, for each cache, the
+    misses seen since the previous call per byte currently held. That is
+    an estimate of how many lookups one more byte given to that cache
+    would turn into hits. The budget is then shifted gradually towards
+    the caches with the highest estimate, converted back into entry
+    counts using each cache's observed bytes per entry, clamped to the
+    cache's limits, and handed to the caches as new target sizes. The
+    part of a cache's share beyond its maximum size goes to the other
+    caches, in proportion to their estimates. Target
+    ages are scaled in proportion to the target size.
+
+    A cache which misses nothing drifts down to its minimum size, while
+    the total of all targets never exceeds the budget unless the minimum
+    sizes alone do.
+*/
+class CacheGovernor
+{
+public:
+    /** Figures reported by a cache on each rebalance. */
+    struct Usage
+    {
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+        std::uint64_t hits = 0;     // cumulative
+        std::uint64_t misses = 0;   // cumulative
+    };
+
+    /** Bounds within which the governor may size a cache. */
+    struct Limits
+    {
+        int minSize = 0;
+        int maxSize = 0;            // 0 = no upper bound
+        int baseSize = 0;           // the configured size
+        std::chrono::seconds baseAge {0};
+        std::chrono::seconds minAge {0};
+        std::chrono::seconds maxAge {0};    // 0 = no upper bound
+    };
+
+    /** A cache which can be governed. */
+    class Source
+    {
+    public:
+        virtual ~Source () = default;
+
+        virtual
+        std::string const&
+        name () const = 0;
+
+        virtual
+        Usage
+        usage () = 0;
+
+        virtual
+        void
+        setTarget (int size, std::chrono::seconds age) = 0;
+    };
+
+    /** The current decision for one cache. */
+    struct Target
+    {
+        std::string name;
+        int size = 0;
+        std::chrono::seconds age {0};
+        std::size_t bytes = 0;
+        double score = 0;
+    };
+
+    CacheGovernor (std::size_t budget, beast::Journal journal);
+
+    CacheGovernor (CacheGovernor const&) = delete;
+    CacheGovernor& operator= (CacheGovernor const&) = delete;
+
+    /** Register a cache. It must outlive its registration. */
+    void
+    add (Source& source, Limits const& limits);
+
+    void
+    remove (Source& source);
+
+    std::size_t
+    budget () const;
+
+    void
+    setBudget (std::size_t budget);
+
+    /** Sample every cache and hand out new targets. */
+    void
+    rebalance ();
+
+    /** Returns the targets chosen by the last rebalance. */
+    std::vector<Target>
+    getTargets () const;
+
+private:
+    struct Entry
+    {
+        Source* source;
+        Limits limits;
+        std::uint64_t lastHits = 0;
+        std::uint64_t lastMisses = 0;
+        double bytesPerEntry = 0;
+        double score = 0;
+        bool sampled = false;
+        int size = 0;
+        std::chrono::seconds age {0};
+    };
+
+    int
+    clampSize (Entry const& e, double size) const;
+
+    // The bytes each cache would get with no limit on how fast sizes move
+    std::vector<double>
+    idealShares () const;
+
+    std::chrono::seconds
+    ageFor (Entry const& e, int size) const;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::size_t budget_;
+    beast::Journal j_;
+};
+
+//------------------------------------------------------------------------------
+
+/** Adapts a ShardedTaggedCache to the governor.
+
+    The byte footprint is approximated as the number of strongly cached
+    entries times a fixed per-entry estimate supplied by the owner.
+*/
+template <class Cache>
+class GovernedCache : public CacheGovernor::Source
+{
+private:
+    std::string const name_;
+    Cache& cache_;
+    std::size_t const bytesPerEntry_;
+
+public:
+    GovernedCache (std::string const& name, Cache& cache,
+            std::size_t bytesPerEntry)
+        : name_ (name)
+        , cache_ (cache)
+        , bytesPerEntry_ (bytesPerEntry)
+    {
+    }
+
+    std::string const&
+    name () const override
+    {
+        return name_;
+    }
+
+    CacheGovernor::Usage
+    usage () override
+    {
+        CacheGovernor::Usage u;
+        for (auto const& s : cache_.getShardStats ())
+        {
+            u.entries += s.cached;
+            u.hits += s.hits;
+            u.misses += s.misses;
+        }
+        u.bytes = u.entries * bytesPerEntry_;
+        return u;
+    }
+
+    void
+    setTarget (int size, std::chrono::seconds age) override
+    {
+        cache_.setTargetSize (size);
+        cache_.setTargetAge (age.count ());
+    }
+};
+
+} //
+
+#endif
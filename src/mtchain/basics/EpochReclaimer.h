@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_BASICS_EPOCHRECLAIMER_H_INCLUDED
+#define MTCHAIN_BASICS_EPOCHRECLAIMER_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mtchain {
+
+/** Defers freeing of shared, immutable objects until no reader can see them.
+
+    Readers bracket each traversal with a ReadGuard and may then follow
+    plain pointers without touching any reference counts. A writer which
+    unlinks an object hands it to retire() instead of deleting it. The
+    object is destroyed by a later call to reclaim() once every reader
+    that was active when it was retired has left.
+
+    Internally a global epoch counter is advanced by reclaim() whenever
+    every active reader has observed the current epoch. An object retired
+    in epoch e is freed once the epoch reaches e + 2. Readers occupy one
+    slot each, on its own cache line, so entering and leaving a read
+    section only writes memory private to the reader.
+
+    Read sections should be short: a reader which stays inside one blocks
+    all reclamation for as long as it does.
+*/
+class EpochReclaimer
+{
+public:
+    /** Marks the calling thread as reading for its lifetime. */
+    class ReadGuard
+    {
+    public:
+        explicit
+        ReadGuard (EpochReclaimer& reclaimer);
+
+        ~ReadGuard ();
+
+        ReadGuard (ReadGuard const&) = delete;
+        ReadGuard& operator= (ReadGuard const&) = delete;
+
+    private:
+        EpochReclaimer& reclaimer_;
+        std::size_t slot_;
+    };
+
+    /** Create a reclaimer.
+
+        @param maxReaders The number of read sections which may be open
+                          at once. Further readers wait for a free slot.
+    */
+    explicit
+    EpochReclaimer (std::size_t maxReaders = 128);
+
+    /** Frees every retired object. No reader may be active. */
+    ~EpochReclaimer ();
+
+    EpochReclaimer (EpochReclaimer const&) = delete;
+    EpochReclaimer& operator= (EpochReclaimer const&) = delete;
+
+    /** Schedule an unlinked object for destruction. */
+    void
+    retire (void* p, void (*deleter)(void*));
+
+    template <class T>
+    void
+    retire (T* p)
+    {
+        retire (p, [](void* v) { delete static_cast<T*> (v); });
+    }
+
+    /** Keep an object alive until every current reader has left.
+
+        This lets structures which own their nodes through shared_ptr
+        drop a reference without racing readers that hold raw pointers.
+    */
+    template <class T>
+    void
+    retire (std::shared_ptr<T> p)
+    {
+        retire (new std::shared_ptr<T> (std::move (p)));
+    }
+
+    /** Advance the epoch if possible and free what became safe.
+
+        @return The number of objects freed.
+    */
+    std::size_t
+    reclaim ();
+
+    /** Returns the current epoch. */
+    std::uint64_t
+    epoch () const
+    {
+        return epoch_.load ();
+    }
+
+    /** Returns the number of objects waiting to be freed. */
+    std::size_t
+    pending () const;
+
+private:
+    // Aligned so that each slot has a cache line to itself
+    struct alignas(64) Slot
+    {
+        // 0 when free, otherwise the epoch the reader entered in
+        std::atomic<std::uint64_t> epoch {0};
+    };
+
+    struct Retired
+    {
+        void* p;
+        void (*deleter)(void*);
+        std::uint64_t epoch;
+    };
+
+    std::size_t
+    enter ();
+
+    void
+    leave (std::size_t slot);
+
+    bool
+    tryAdvance ();
+
+    std::atomic<std::uint64_t> epoch_ {1};
+    // Before C++17 new[] need not honour the alignment of Slot, so the
+    // slots are placed in a larger buffer by hand.
+    std::unique_ptr<char[]> storage_;
+    Slot* slots_;
+    std::size_t const slotCount_;
+
+    mutable std::mutex mutex_;
+    std::vector<Retired> retired_;
+};
+
+} //
+
+#endif
@@ -0,0 +1,633 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+#define MTCHAIN_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+
+#include <mtchain/basics/hardened_hash.h>
+#include <mtchain/basics/Log.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <mtchain/beast/clock/abstract_clock.h>
+#include <mtchain/beast/insight/Insight.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+
+/** A TaggedCache split into independently locked shards.
+
+    The interface and the caching rules are those of TaggedCache: entries
+    are strongly held until they age out, then weakly tracked for as long
+    as someone else holds them. Each key maps to one shard, and each shard
+    has its own mutex, map, share of the target size and hit counters, so
+    threads working on different keys rarely contend.
+
+    sweep() visits every shard, holding only one shard's lock at a time.
+    sweepSome() visits a few shards per call, continuing where the last
+    call stopped, which lets a frequent timer spread the work of a sweep
+    over many short lock holds.
+*/
+template <
+    class Key,
+    class T,
+    class Hash = hardened_hash <>,
+    class KeyEqual = std::equal_to <Key>,
+    class Mutex = std::mutex
+>
+class ShardedTaggedCache
+{
+public:
+    using mutex_type = Mutex;
+    using lock_guard = std::lock_guard <mutex_type>;
+    using key_type = Key;
+    using mapped_type = T;
+    using weak_mapped_ptr = std::weak_ptr <mapped_type>;
+    using mapped_ptr = std::shared_ptr <mapped_type>;
+    using clock_type = beast::abstract_clock <std::chrono::steady_clock>;
+
+    /** Counters for one shard, as returned by getShardStats. */
+    struct ShardStats
+    {
+        std::size_t cached = 0;     // strongly held entries
+        std::size_t tracked = 0;    // all entries, strong or weak
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+public:
+    ShardedTaggedCache (std::string const& name, int size,
+        clock_type::rep expiration_seconds, clock_type& clock,
+            beast::Journal journal,
+                beast::insight::Collector::ptr const& collector =
+                    beast::insight::NullCollector::New (),
+                        std::size_t shards = 16)
+        : m_journal (journal)
+        , m_clock (clock)
+        , m_stats (name,
+            std::bind (&ShardedTaggedCache::collect_metrics, this),
+                collector)
+        , m_name (name)
+        , m_shards (std::max <std::size_t> (shards, 1))
+        , m_target_size (size)
+        , m_target_age (clock_type::duration (
+            std::chrono::seconds (expiration_seconds)).count ())
+        , m_next_sweep (0)
+    {
+    }
+
+    ShardedTaggedCache (ShardedTaggedCache const&) = delete;
+    ShardedTaggedCache& operator= (ShardedTaggedCache const&) = delete;
+
+public:
+    /** Return the clock associated with the cache. */
+    clock_type&
+    clock ()
+    {
+        return m_clock;
+    }
+
+    std::size_t
+    shardCount () const
+    {
+        return m_shards.size ();
+    }
+
+    int
+    getTargetSize () const
+    {
+        return m_target_size.load ();
+    }
+
+    void
+    setTargetSize (int s)
+    {
+        m_target_size = s;
+
+        JLOG(m_journal.debug()) << m_name << " target size set to " << s;
+    }
+
+    clock_type::rep
+    getTargetAge () const
+    {
+        return std::chrono::duration_cast<std::chrono::seconds> (
+            clock_type::duration (m_target_age.load ())).count ();
+    }
+
+    void
+    setTargetAge (clock_type::rep s)
+    {
+        m_target_age = clock_type::duration (
+            std::chrono::seconds (s)).count ();
+
+        JLOG(m_journal.debug()) << m_name << " target age set to " << s;
+    }
+
+    int
+    getCacheSize () const
+    {
+        std::size_t n = 0;
+        for (auto const& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            n += shard.cached;
+        }
+        return static_cast<int> (n);
+    }
+
+    int
+    getTrackSize () const
+    {
+        std::size_t n = 0;
+        for (auto const& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            n += shard.map.size ();
+        }
+        return static_cast<int> (n);
+    }
+
+    float
+    getHitRate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        for (auto const& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            hits += shard.hits;
+            misses += shard.misses;
+        }
+        return hits * (100.0f / std::max (1.0f,
+            static_cast<float> (hits + misses)));
+    }
+
+    /** Returns the size and hit counters of each shard. */
+    std::vector <ShardStats>
+    getShardStats () const
+    {
+        std::vector <ShardStats> result;
+        result.reserve (m_shards.size ());
+        for (auto const& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            ShardStats s;
+            s.cached = shard.cached;
+            s.tracked = shard.map.size ();
+            s.hits = shard.hits;
+            s.misses = shard.misses;
+            result.push_back (s);
+        }
+        return result;
+    }
+
+    void
+    clear ()
+    {
+        for (auto& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            shard.map.clear ();
+            shard.cached = 0;
+        }
+    }
+
+    void
+    reset ()
+    {
+        for (auto& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            shard.map.clear ();
+            shard.cached = 0;
+            shard.hits = 0;
+            shard.misses = 0;
+        }
+    }
+
+    /** Sweep every shard. */
+    void
+    sweep ()
+    {
+        sweepSome (m_shards.size ());
+    }
+
+    /** Sweep the next `count` shards, in round-robin order.
+
+        @return The number of entries removed from the cache.
+    */
+    std::size_t
+    sweepSome (std::size_t count)
+    {
+        count = std::min (count, m_shards.size ());
+
+        std::size_t removed = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto const index = m_next_sweep++ % m_shards.size ();
+            removed += sweepShard (m_shards[index]);
+        }
+        return removed;
+    }
+
+    bool
+    del (const key_type& key, bool valid)
+    {
+        // Remove from cache, if !valid, remove from map too. Returns true if
+        // removed from cache
+        auto& shard = shardFor (key);
+        lock_guard lock (shard.mutex);
+
+        auto cit = shard.map.find (key);
+
+        if (cit == shard.map.end ())
+            return false;
+
+        Entry& entry = cit->second;
+
+        bool ret = false;
+
+        if (entry.isCached ())
+        {
+            --shard.cached;
+            entry.ptr.reset ();
+            ret = true;
+        }
+
+        if (!valid || entry.isExpired ())
+            shard.map.erase (cit);
+
+        return ret;
+    }
+
+    /** Replace aliased objects with originals.
+
+        Due to concurrency it is possible for two separate objects with
+        the same content and referring to the same unique "thing" to exist.
+        This routine eliminates the duplicate and performs a replacement
+        on the callers shared pointer if needed.
+
+        @param key The key corresponding to the object
+        @param data A shared pointer to the data corresponding to the object.
+        @param replace `true` if we have the correct data and should replace.
+
+        @return `true` If the key already existed.
+    */
+    bool
+    canonicalize (const key_type& key, std::shared_ptr<T>& data,
+        bool replace = false)
+    {
+        // Return canonical value, store if needed, refresh in cache
+        // Return values: true=we had the data already
+        auto& shard = shardFor (key);
+        lock_guard lock (shard.mutex);
+
+        auto cit = shard.map.find (key);
+
+        if (cit == shard.map.end ())
+        {
+            shard.map.emplace (std::piecewise_construct,
+                std::forward_as_tuple (key),
+                std::forward_as_tuple (m_clock.now (), data));
+            ++shard.cached;
+            return false;
+        }
+
+        Entry& entry = cit->second;
+        entry.touch (m_clock.now ());
+
+        if (entry.isCached ())
+        {
+            if (replace)
+            {
+                entry.ptr = data;
+                entry.weak_ptr = data;
+            }
+            else
+            {
+                data = entry.ptr;
+            }
+
+            return true;
+        }
+
+        auto cachedData = entry.lock ();
+
+        if (cachedData)
+        {
+            if (replace)
+            {
+                entry.ptr = data;
+                entry.weak_ptr = data;
+            }
+            else
+            {
+                entry.ptr = cachedData;
+                data = cachedData;
+            }
+
+            ++shard.cached;
+            return true;
+        }
+
+        entry.ptr = data;
+        entry.weak_ptr = data;
+        ++shard.cached;
+
+        return false;
+    }
+
+    std::shared_ptr<T>
+    fetch (const key_type& key)
+    {
+        // fetch us a shared pointer to the stored data object
+        auto& shard = shardFor (key);
+        lock_guard lock (shard.mutex);
+
+        auto cit = shard.map.find (key);
+
+        if (cit == shard.map.end ())
+        {
+            ++shard.misses;
+            return mapped_ptr ();
+        }
+
+        Entry& entry = cit->second;
+        entry.touch (m_clock.now ());
+
+        if (entry.isCached ())
+        {
+            ++shard.hits;
+            return entry.ptr;
+        }
+
+        entry.ptr = entry.lock ();
+
+        if (entry.isCached ())
+        {
+            // independent of cache size, so not counted as a hit
+            ++shard.cached;
+            return entry.ptr;
+        }
+
+        shard.map.erase (cit);
+        ++shard.misses;
+        return mapped_ptr ();
+    }
+
+    /** Insert the element into the container.
+        If the key already exists, nothing happens.
+        @return `true` If the element was inserted
+    */
+    bool
+    insert (key_type const& key, T const& value)
+    {
+        mapped_ptr p (std::make_shared <T> (
+            std::cref (value)));
+        return canonicalize (key, p);
+    }
+
+    // VFALCO NOTE It looks like this returns a copy of the data in
+    //             the output parameter 'data'. This could be expensive.
+    //             Perhaps it should work like standard containers, which
+    //             simply return an iterator.
+    //
+    bool
+    retrieve (const key_type& key, T& data)
+    {
+        // retrieve the value of the stored data
+        auto entry = fetch (key);
+
+        if (!entry)
+            return false;
+
+        data = *entry;
+        return true;
+    }
+
+    std::vector <key_type>
+    getKeys () const
+    {
+        std::vector <key_type> v;
+
+        for (auto const& shard : m_shards)
+        {
+            lock_guard lock (shard.mutex);
+            v.reserve (v.size () + shard.map.size ());
+            for (auto const& _ : shard.map)
+                v.push_back (_.first);
+        }
+
+        return v;
+    }
+
+private:
+    void
+    collect_metrics ()
+    {
+        m_stats.size.set (getCacheSize ());
+
+        {
+            beast::insight::Gauge::value_type hit_rate (0);
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            for (auto const& shard : m_shards)
+            {
+                lock_guard lock (shard.mutex);
+                hits += shard.hits;
+                misses += shard.misses;
+            }
+            if (hits + misses != 0)
+                hit_rate = (hits * 100) / (hits + misses);
+            m_stats.hit_rate.set (hit_rate);
+        }
+    }
+
+private:
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+        { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+    };
+
+    class Entry
+    {
+    public:
+        mapped_ptr ptr;
+        weak_mapped_ptr weak_ptr;
+        clock_type::time_point last_access;
+
+        Entry (clock_type::time_point const& last_access_,
+            mapped_ptr const& ptr_)
+            : ptr (ptr_)
+            , weak_ptr (ptr_)
+            , last_access (last_access_)
+        {
+        }
+
+        bool isWeak() const { return ptr == nullptr; }
+        bool isCached() const { return ptr != nullptr; }
+        bool isExpired() const { return weak_ptr.expired(); }
+        mapped_ptr lock() { return weak_ptr.lock(); }
+        void touch(clock_type::time_point const& now) { last_access = now; }
+    };
+
+    struct Shard
+    {
+        mutable mutex_type mutex;
+        hardened_hash_map <key_type, Entry, Hash, KeyEqual> map;
+        std::size_t cached = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+    Shard&
+    shardFor (key_type const& key)
+    {
+        // Fold the high bits in so the choice of shard does not line
+        // up with the bucket chosen inside the shard's own map.
+        std::size_t h = m_hash (key);
+        h ^= (h >> 17) ^ (h >> 31);
+        return m_shards[h % m_shards.size ()];
+    }
+
+    std::size_t
+    sweepShard (Shard& shard)
+    {
+        std::size_t cacheRemovals = 0;
+        std::size_t mapRemovals = 0;
+
+        // Keep references to all the stuff we sweep
+        // so that we can destroy them outside the lock.
+        std::vector <mapped_ptr> stuffToSweep;
+
+        {
+            clock_type::time_point const now (m_clock.now ());
+            clock_type::duration const targetAge (m_target_age.load ());
+            clock_type::time_point when_expire;
+
+            // Each shard is held to an even share of the target size
+            int const targetSize = m_target_size.load ();
+            std::size_t const shardTarget = (targetSize <= 0) ? 0 :
+                std::max <std::size_t> (1, targetSize / m_shards.size ());
+
+            lock_guard lock (shard.mutex);
+
+            if (shardTarget == 0 || shard.map.size () <= shardTarget)
+            {
+                when_expire = now - targetAge;
+            }
+            else
+            {
+                when_expire = now - targetAge *
+                    static_cast<clock_type::rep> (shardTarget) /
+                        static_cast<clock_type::rep> (shard.map.size ());
+
+                clock_type::duration const minimumAge (
+                    std::chrono::seconds (1));
+                if (when_expire > (now - minimumAge))
+                    when_expire = now - minimumAge;
+
+                JLOG(m_journal.trace()) <<
+                    m_name << " shard is growing fast " << shard.map.size () <<
+                        " of " << shardTarget;
+            }
+
+            stuffToSweep.reserve (shard.map.size ());
+
+            auto cit = shard.map.begin ();
+
+            while (cit != shard.map.end ())
+            {
+                if (cit->second.isWeak ())
+                {
+                    // weak
+                    if (cit->second.isExpired ())
+                    {
+                        ++mapRemovals;
+                        cit = shard.map.erase (cit);
+                    }
+                    else
+                    {
+                        ++cit;
+                    }
+                }
+                else if (cit->second.last_access <= when_expire)
+                {
+                    // strong, expired
+                    --shard.cached;
+                    ++cacheRemovals;
+                    if (cit->second.ptr.unique ())
+                    {
+                        stuffToSweep.push_back (cit->second.ptr);
+                        ++mapRemovals;
+                        cit = shard.map.erase (cit);
+                    }
+                    else
+                    {
+                        // remains weakly cached
+                        cit->second.ptr.reset ();
+                        ++cit;
+                    }
+                }
+                else
+                {
+                    // strong, not expired
+                    ++cit;
+                }
+            }
+        }
+
+        if (mapRemovals || cacheRemovals)
+        {
+            JLOG(m_journal.trace()) <<
+                m_name << ": shard cache = " << cacheRemovals <<
+                    "-" << mapRemovals;
+        }
+
+        // At this point stuffToSweep will go out of scope outside the lock
+        // and decrement the reference count on each strong pointer.
+        return cacheRemovals;
+    }
+
+    beast::Journal m_journal;
+    clock_type& m_clock;
+    Stats m_stats;
+    Hash m_hash;
+
+    std::string const m_name;
+    std::vector <Shard> m_shards;
+
+    // Desired number of cache entries (0 = ignore)
+    std::atomic <int> m_target_size;
+
+    // Desired maximum cache age, in clock ticks
+    std::atomic <clock_type::rep> m_target_age;
+
+    // Next shard for an incremental sweep
+    std::atomic <std::size_t> m_next_sweep;
+};
+
+} //
+
+#endif
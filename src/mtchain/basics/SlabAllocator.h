@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_BASICS_SLABALLOCATOR_H_INCLUDED
+#define MTCHAIN_BASICS_SLABALLOCATOR_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mtchain {
+
+/** Hands out small blocks carved from large slabs, by size class.
+
+    Requests are rounded up to a multiple of the granularity and served
+    from the free list of that size class, or from the unused end of the
+    class's current slab. This replaces one heap allocation (and its
+    bookkeeping overhead) per object with one per slab, for objects
+    which are created and destroyed in large numbers.
+
+    Memory is returned to the free list of its class on deallocation but
+    is only released to the system when the allocator is destroyed.
+    Requests larger than the largest class go to the global heap.
+*/
+class SlabAllocator
+{
+public:
+    static std::size_t constexpr granularity = 16;
+
+    /** Create an allocator.
+
+        @param maxSize The largest request served from slabs.
+        @param slabSize The size of each slab obtained from the heap.
+    */
+    explicit
+    SlabAllocator (std::size_t maxSize = 512,
+        std::size_t slabSize = 64 * 1024);
+
+    ~SlabAllocator ();
+
+    SlabAllocator (SlabAllocator const&) = delete;
+    SlabAllocator& operator= (SlabAllocator const&) = delete;
+
+    /** Returns a block of at least `size` bytes, aligned to granularity. */
+    void*
+    allocate (std::size_t size);
+
+    /** Return a block. `size` must be the size it was allocated with. */
+    void
+    deallocate (void* p, std::size_t size) noexcept;
+
+    /** Returns the number of bytes obtained from the heap for slabs. */
+    std::size_t
+    reserved () const;
+
+    /** Returns the number of slab sized allocations made. */
+    std::size_t
+    slabs () const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct SizeClass
+    {
+        std::mutex mutex;
+        FreeBlock* free = nullptr;
+        std::uint8_t* next = nullptr;
+        std::uint8_t* end = nullptr;
+        std::vector<void*> slabs;
+    };
+
+    std::size_t const maxSize_;
+    std::size_t const slabSize_;
+    std::unique_ptr<SizeClass[]> classes_;
+};
+
+} //
+
+#endif
@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/CacheGovernor.h>
+#include <mtchain/basics/Log.h>
+#include <algorithm>
+#include <limits>
+
+namespace mtchain {
+
+// How far towards the ideal split each rebalance moves
+static double constexpr rebalanceStep = 0.25;
+
+// Weight of the newest sample in the smoothed score
+static double constexpr scoreSmoothing = 0.5;
+
+CacheGovernor::CacheGovernor (std::size_t budget, beast::Journal journal)
+    : budget_ (budget)
+    , j_ (journal)
+{
+}
+
+void
+CacheGovernor::add (Source& source, Limits const& limits)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    Entry e;
+    e.source = &source;
+    e.limits = limits;
+    e.size = limits.baseSize;
+    e.age = limits.baseAge;
+    entries_.push_back (e);
+}
+
+void
+CacheGovernor::remove (Source& source)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    entries_.erase (std::remove_if (entries_.begin (), entries_.end (),
+        [&source](Entry const& e)
+        {
+            return e.source == &source;
+        }), entries_.end ());
+}
+
+std::size_t
+CacheGovernor::budget () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return budget_;
+}
+
+void
+CacheGovernor::setBudget (std::size_t budget)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    budget_ = budget;
+}
+
+int
+CacheGovernor::clampSize (Entry const& e, double size) const
+{
+    double hi = std::numeric_limits<int>::max ();
+    if (e.limits.maxSize > 0)
+        hi = e.limits.maxSize;
+    return static_cast<int> (std::max<double> (e.limits.minSize,
+        std::min (hi, size)));
+}
+
+std::chrono::seconds
+CacheGovernor::ageFor (Entry const& e, int size) const
+{
+    if (e.limits.baseSize <= 0)
+        return e.limits.baseAge;
+
+    std::chrono::seconds age (static_cast<std::chrono::seconds::rep> (
+        e.limits.baseAge.count () * static_cast<double> (size) /
+            e.limits.baseSize));
+
+    if (e.limits.maxAge.count () > 0)
+        age = std::min (age, e.limits.maxAge);
+    return std::max (age, e.limits.minAge);
+}
+
+std::vector<double>
+CacheGovernor::idealShares () const
+{
+    // Split the budget in proportion to the scores. A cache whose share
+    // exceeds its maximum size will be held at its maximum, and what it
+    // can not use is split between the others in the same way.
+    std::vector<double> ideal (entries_.size (), 0);
+    std::vector<bool> capped (entries_.size (), false);
+    double remaining = budget_;
+    double score = 0;
+    for (auto const& e : entries_)
+    {
+        if (e.bytesPerEntry != 0)
+            score += e.score;
+    }
+
+    for (bool changed = true; changed && score > 0;)
+    {
+        changed = false;
+        for (std::size_t i = 0; i < entries_.size (); ++i)
+        {
+            auto const& e = entries_[i];
+            if (capped[i] || e.bytesPerEntry == 0 || e.limits.maxSize <= 0)
+                continue;
+
+            double const most = e.limits.maxSize * e.bytesPerEntry;
+            double const share = remaining * (e.score / score);
+            if (share > most)
+            {
+                // Aim past the maximum so that the cache reaches it
+                ideal[i] = share;
+                capped[i] = true;
+                remaining -= most;
+                score -= e.score;
+                changed = true;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < entries_.size (); ++i)
+    {
+        if (! capped[i] && score > 0 && entries_[i].bytesPerEntry != 0)
+            ideal[i] = remaining * (entries_[i].score / score);
+    }
+    return ideal;
+}
+
+void
+CacheGovernor::rebalance ()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    if (entries_.empty ())
+        return;
+
+    // Sample each cache and update its score: recent misses per byte held
+    double totalScore = 0;
+    for (auto& e : entries_)
+    {
+        auto const u = e.source->usage ();
+
+        // Counters which went backwards were reset; count from zero
+        auto const hits = (u.hits >= e.lastHits) ?
+            u.hits - e.lastHits : u.hits;
+        auto const misses = (u.misses >= e.lastMisses) ?
+            u.misses - e.lastMisses : u.misses;
+        e.lastHits = u.hits;
+        e.lastMisses = u.misses;
+
+        if (u.entries != 0)
+            e.bytesPerEntry = static_cast<double> (u.bytes) / u.entries;
+
+        double const gain = static_cast<double> (misses) /
+            std::max<double> (1, u.bytes);
+
+        e.score = e.sampled ?
+            (1 - scoreSmoothing) * e.score + scoreSmoothing * gain : gain;
+        e.sampled = true;
+
+        totalScore += e.score;
+
+        JLOG(j_.trace()) << "CacheGovernor " << e.source->name () <<
+            ": " << hits << " hits, " << misses << " misses, " <<
+            u.bytes << " bytes";
+    }
+
+    // Move each cache part of the way towards its ideal share
+    auto const ideal = idealShares ();
+    double total = 0;
+    for (std::size_t i = 0; i < entries_.size (); ++i)
+    {
+        auto& e = entries_[i];
+
+        // Until a cache has reported entries its size cannot be costed
+        if (e.bytesPerEntry == 0)
+            continue;
+
+        if (totalScore > 0)
+        {
+            double const current = e.size * e.bytesPerEntry;
+            double const next = current +
+                (ideal[i] - current) * rebalanceStep;
+            e.size = clampSize (e, next / e.bytesPerEntry);
+        }
+
+        total += e.size * e.bytesPerEntry;
+    }
+
+    // Never hand out more than the budget
+    if (total > budget_ && total > 0)
+    {
+        double const scale = budget_ / total;
+        for (auto& e : entries_)
+        {
+            if (e.bytesPerEntry != 0)
+                e.size = clampSize (e, e.size * scale);
+        }
+    }
+
+    for (auto& e : entries_)
+    {
+        e.age = ageFor (e, e.size);
+        e.source->setTarget (e.size, e.age);
+
+        JLOG(j_.debug()) << "CacheGovernor " << e.source->name () <<
+            ": target " << e.size << " entries, " <<
+            e.age.count () << "s";
+    }
+}
+
+std::vector<CacheGovernor::Target>
+CacheGovernor::getTargets () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    std::vector<Target> result;
+    result.reserve (entries_.size ());
+    for (auto const& e : entries_)
+    {
+        Target t;
+        t.name = e.source->name ();
+        t.size = e.size;
+        t.age = e.age;
+        t.bytes = static_cast<std::size_t> (e.size * e.bytesPerEntry);
+        t.score = e.score;
+        result.push_back (t);
+    }
+    return result;
+}
+
+} //
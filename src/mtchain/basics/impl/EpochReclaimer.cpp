@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/EpochReclaimer.h>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace mtchain {
+
+EpochReclaimer::ReadGuard::ReadGuard (EpochReclaimer& reclaimer)
+    : reclaimer_ (reclaimer)
+    , slot_ (reclaimer.enter ())
+{
+}
+
+EpochReclaimer::ReadGuard::~ReadGuard ()
+{
+    reclaimer_.leave (slot_);
+}
+
+//------------------------------------------------------------------------------
+
+EpochReclaimer::EpochReclaimer (std::size_t maxReaders)
+    : storage_ (new char[maxReaders * sizeof(Slot) + alignof(Slot) - 1])
+    , slotCount_ (maxReaders)
+{
+    assert (maxReaders != 0);
+
+    void* p = storage_.get ();
+    std::size_t space = maxReaders * sizeof(Slot) + alignof(Slot) - 1;
+    slots_ = static_cast<Slot*> (
+        std::align (alignof(Slot), maxReaders * sizeof(Slot), p, space));
+    for (std::size_t i = 0; i < maxReaders; ++i)
+        new (&slots_[i]) Slot;
+
+    // Freeing the storage is all it takes to destroy the slots
+    static_assert (std::is_trivially_destructible<Slot>::value, "");
+    static_assert (sizeof(Slot) == 64, "");
+}
+
+EpochReclaimer::~EpochReclaimer ()
+{
+    for (auto const& r : retired_)
+        r.deleter (r.p);
+}
+
+std::size_t
+EpochReclaimer::enter ()
+{
+    // Start from a slot chosen by thread so that readers on different
+    // threads rarely contend for the same one.
+    auto slot = std::hash<std::thread::id>{} (
+        std::this_thread::get_id ()) % slotCount_;
+
+    auto e = epoch_.load ();
+    for (std::size_t tries = 0;; ++tries)
+    {
+        std::uint64_t expected = 0;
+        if (slots_[slot].epoch.compare_exchange_strong (expected, e))
+            break;
+
+        if (++slot == slotCount_)
+            slot = 0;
+        if (tries % slotCount_ == slotCount_ - 1)
+            std::this_thread::yield ();
+    }
+
+    // The epoch may have advanced before the slot became visible to
+    // reclaim(). Republish until both agree, so that the slot never
+    // claims an epoch older than the one the reader actually observes.
+    for (;;)
+    {
+        auto const now = epoch_.load ();
+        if (now == e)
+            return slot;
+        e = now;
+        slots_[slot].epoch.store (e);
+    }
+}
+
+void
+EpochReclaimer::leave (std::size_t slot)
+{
+    slots_[slot].epoch.store (0, std::memory_order_release);
+}
+
+bool
+EpochReclaimer::tryAdvance ()
+{
+    auto e = epoch_.load ();
+    for (std::size_t i = 0; i < slotCount_; ++i)
+    {
+        auto const s = slots_[i].epoch.load ();
+        if (s != 0 && s != e)
+            return false;
+    }
+    return epoch_.compare_exchange_strong (e, e + 1);
+}
+
+void
+EpochReclaimer::retire (void* p, void (*deleter)(void*))
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    retired_.push_back ({ p, deleter, epoch_.load () });
+}
+
+std::size_t
+EpochReclaimer::reclaim ()
+{
+    tryAdvance ();
+
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+
+        auto const e = epoch_.load ();
+        auto const first = std::partition (retired_.begin (), retired_.end (),
+            [e](Retired const& r)
+            {
+                return r.epoch + 2 > e;
+            });
+        ready.assign (first, retired_.end ());
+        retired_.erase (first, retired_.end ());
+    }
+
+    // Destructors run without the lock; they may retire more objects
+    for (auto const& r : ready)
+        r.deleter (r.p);
+
+    return ready.size ();
+}
+
+std::size_t
+EpochReclaimer::pending () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return retired_.size ();
+}
+
+} //
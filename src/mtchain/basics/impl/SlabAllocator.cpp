@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/SlabAllocator.h>
+#include <cassert>
+#include <new>
+
+namespace mtchain {
+
+namespace {
+
+std::size_t
+roundUp (std::size_t size)
+{
+    return (size + SlabAllocator::granularity - 1) &
+        ~(SlabAllocator::granularity - 1);
+}
+
+}
+
+SlabAllocator::SlabAllocator (std::size_t maxSize, std::size_t slabSize)
+    : maxSize_ (roundUp (maxSize))
+    , slabSize_ (slabSize)
+    , classes_ (new SizeClass[maxSize_ / granularity])
+{
+    assert (slabSize_ >= maxSize_);
+}
+
+SlabAllocator::~SlabAllocator ()
+{
+    for (std::size_t i = 0; i < maxSize_ / granularity; ++i)
+    {
+        for (auto slab : classes_[i].slabs)
+            ::operator delete (slab);
+    }
+}
+
+void*
+SlabAllocator::allocate (std::size_t size)
+{
+    size = roundUp (size == 0 ? 1 : size);
+    if (size > maxSize_)
+        return ::operator new (size);
+
+    auto& c = classes_[size / granularity - 1];
+    std::lock_guard<std::mutex> lock (c.mutex);
+
+    if (c.free)
+    {
+        auto const block = c.free;
+        c.free = block->next;
+        return block;
+    }
+
+    if (c.next == nullptr ||
+        c.end - c.next < static_cast<std::ptrdiff_t> (size))
+    {
+        auto const slab = static_cast<std::uint8_t*> (
+            ::operator new (slabSize_));
+        c.slabs.push_back (slab);
+        c.next = slab;
+        c.end = slab + slabSize_;
+    }
+
+    auto const block = c.next;
+    c.next += size;
+    return block;
+}
+
+void
+SlabAllocator::deallocate (void* p, std::size_t size) noexcept
+{
+    size = roundUp (size == 0 ? 1 : size);
+    if (size > maxSize_)
+    {
+        ::operator delete (p);
+        return;
+    }
+
+    auto& c = classes_[size / granularity - 1];
+    std::lock_guard<std::mutex> lock (c.mutex);
+
+    auto const block = static_cast<FreeBlock*> (p);
+    block->next = c.free;
+    c.free = block;
+}
+
+std::size_t
+SlabAllocator::reserved () const
+{
+    return slabs () * slabSize_;
+}
+
+std::size_t
+SlabAllocator::slabs () const
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < maxSize_ / granularity; ++i)
+    {
+        std::lock_guard<std::mutex> lock (classes_[i].mutex);
+        n += classes_[i].slabs.size ();
+    }
+    return n;
+}
+
+} //
@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/crypto/local_csprng.h>
+#include <mtchain/basics/contract.h>
+#include <openssl/crypto.h>
+#include <openssl/opensslv.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+namespace mtchain {
+
+namespace {
+
+// Incremented in the child of every fork, which makes every engine
+// discard the bytes it inherited.
+std::atomic<std::uint64_t> forkGeneration {0};
+
+#ifndef _WIN32
+void
+onFork ()
+{
+    ++forkGeneration;
+}
+
+bool const forkHandlerInstalled =
+    pthread_atfork (nullptr, nullptr, &onFork) == 0;
+#endif
+
+// Held around every call into OpenSSL's generator
+std::unique_lock<std::mutex>
+lockRand ()
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    static std::mutex m;
+    return std::unique_lock<std::mutex> (m);
+#else
+    return {};
+#endif
+}
+
+void
+fill (void* ptr, std::size_t count)
+{
+    auto const lock = lockRand ();
+    while (count != 0)
+    {
+        auto const n = std::min<std::size_t> (count,
+            std::numeric_limits<int>::max ());
+        if (RAND_bytes (static_cast<unsigned char*> (ptr),
+                static_cast<int> (n)) != 1)
+            Throw<std::runtime_error> ("CSPRNG: Insufficient entropy");
+        ptr = static_cast<std::uint8_t*> (ptr) + n;
+        count -= n;
+    }
+}
+
+}
+
+local_csprng_engine::local_csprng_engine ()
+    : used_ (bufferSize)
+    , generation_ (forkGeneration.load ())
+{
+#ifndef _WIN32
+    (void)forkHandlerInstalled;
+#endif
+}
+
+local_csprng_engine::~local_csprng_engine ()
+{
+    OPENSSL_cleanse (buffer_, sizeof(buffer_));
+}
+
+void
+local_csprng_engine::refill ()
+{
+    fill (buffer_, bufferSize);
+    used_ = 0;
+}
+
+void
+local_csprng_engine::mix_entropy (void* buffer, std::size_t count)
+{
+    std::array<std::random_device::result_type, 128> entropy;
+
+    {
+        // On every platform we support, std::random_device
+        // is non-deterministic and should provide some good
+        // quality entropy.
+        std::random_device rd;
+
+        for (auto& e : entropy)
+            e = rd();
+    }
+
+    {
+        auto const lock = lockRand ();
+        RAND_add (entropy.data (), entropy.size () * sizeof(entropy[0]), 0);
+        if (buffer != nullptr && count != 0)
+            RAND_add (buffer, count, 0);
+    }
+
+    // Later output must reflect the new entropy
+    OPENSSL_cleanse (buffer_, sizeof(buffer_));
+    used_ = bufferSize;
+}
+
+local_csprng_engine::result_type
+local_csprng_engine::operator()()
+{
+    result_type result;
+    (*this)(&result, sizeof(result));
+    return result;
+}
+
+void
+local_csprng_engine::operator()(void* ptr, std::size_t count)
+{
+    auto const generation = forkGeneration.load (std::memory_order_relaxed);
+    if (generation != generation_)
+    {
+        generation_ = generation;
+        used_ = bufferSize;
+    }
+
+    // Large requests gain nothing from the buffer
+    if (count >= bufferSize / 4)
+    {
+        fill (ptr, count);
+        return;
+    }
+
+    auto out = static_cast<std::uint8_t*> (ptr);
+    while (count != 0)
+    {
+        if (used_ == bufferSize)
+            refill ();
+
+        auto const n = std::min (count, bufferSize - used_);
+        std::memcpy (out, buffer_ + used_, n);
+        OPENSSL_cleanse (buffer_ + used_, n);
+        used_ += n;
+        out += n;
+        count -= n;
+    }
+}
+
+local_csprng_engine&
+local_crypto_prng()
+{
+    static thread_local local_csprng_engine engine;
+    return engine;
+}
+
+} //
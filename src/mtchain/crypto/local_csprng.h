@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_CRYPTO_LOCAL_CSPRNG_H_INCLUDED
+#define MTCHAIN_CRYPTO_LOCAL_CSPRNG_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace mtchain {
+
+/** A cryptographically secure random number engine for one thread.
+
+    It has the interface of csprng_engine but no lock: each thread
+    gets its own instance from local_crypto_prng(). Output is served
+    from a buffer which is refilled from OpenSSL's generator in large
+    chunks, so drawing a few bytes costs a copy rather than a call into
+    OpenSSL. Every byte is handed out once and then wiped. Since every
+    refill is fresh output of OpenSSL's generator, the engine is
+    reseeded as often as that generator is.
+
+    OpenSSL's generator is shared by every thread. Before OpenSSL 1.1.0
+    it is only thread safe when the application installs locking
+    callbacks, so with those versions calls into it are serialized by
+    a process wide mutex. They are rare enough, one per refill, for the
+    lock to cost little.
+
+    After a fork() the child discards whatever the parent had buffered
+    before producing any output, so parent and child never share
+    random numbers.
+*/
+class local_csprng_engine
+{
+public:
+    using result_type = std::uint64_t;
+
+    static std::size_t constexpr bufferSize = 4096;
+
+    local_csprng_engine ();
+    ~local_csprng_engine ();
+
+    local_csprng_engine (local_csprng_engine const&) = delete;
+    local_csprng_engine& operator= (local_csprng_engine const&) = delete;
+
+    /** Mix entropy into OpenSSL's pool and discard the buffer. */
+    void
+    mix_entropy (void* buffer = nullptr, std::size_t count = 0);
+
+    /** Generate a random integer */
+    result_type
+    operator()();
+
+    /** Fill a buffer with the requested amount of random data */
+    void
+    operator()(void* ptr, std::size_t count);
+
+    /* The smallest possible value that can be returned */
+    static constexpr
+    result_type
+    min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    /* The largest possible value that can be returned */
+    static constexpr
+    result_type
+    max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+private:
+    void
+    refill ();
+
+    std::uint8_t buffer_[bufferSize];
+    std::size_t used_;
+    std::uint64_t generation_;
+};
+
+/** The random number engine of the calling thread.
+
+    The engine must only be used by the thread which obtained it.
+*/
+local_csprng_engine&
+local_crypto_prng();
+
+} //
+
+#endif
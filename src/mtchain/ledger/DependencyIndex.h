@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_DEPENDENCYINDEX_H_INCLUDED
+#define MTCHAIN_LEDGER_DEPENDENCYINDEX_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <algorithm>
+#include <vector>
+
+namespace mtchain {
+
+/** Returns the key shared by every quality directory of a book.
+
+    The directories of an order book differ only in the low 64 bits of
+    their keys, which hold the quality. Items depending on a book are
+    registered with this key, and changed directories are mapped to it,
+    so that a directory for a new quality still affects them.
+*/
+inline
+uint256
+bookBase (uint256 const& directory)
+{
+    uint256 base = directory;
+    std::fill (base.end () - 8, base.end (), 0);
+    return base;
+}
+
+/** Tracks which items depend on which ledger entries.
+
+    Each item (a cached result, a subscription) is registered with the
+    keys of the state entries it was computed from, such as trust lines
+    and book directories. Given the keys a ledger or transaction
+    changed, affected() finds the items which must be recomputed
+    without looking at the others.
+
+    This class is not thread safe.
+*/
+template <class Id>
+class DependencyIndex
+{
+public:
+    /** Register an item, replacing any earlier registration. */
+    void
+    insert (Id const& id, std::vector<uint256> keys)
+    {
+        erase (id);
+
+        std::sort (keys.begin (), keys.end ());
+        keys.erase (std::unique (keys.begin (), keys.end ()), keys.end ());
+        for (auto const& k : keys)
+            dependents_[k].push_back (id);
+        keys_.emplace (id, std::move (keys));
+    }
+
+    /** Remove an item. */
+    void
+    erase (Id const& id)
+    {
+        auto const iter = keys_.find (id);
+        if (iter == keys_.end ())
+            return;
+
+        for (auto const& k : iter->second)
+        {
+            auto const d = dependents_.find (k);
+            auto& ids = d->second;
+            auto const pos = std::find (ids.begin (), ids.end (), id);
+            if (pos != ids.end ())
+            {
+                *pos = ids.back ();
+                ids.pop_back ();
+            }
+            if (ids.empty ())
+                dependents_.erase (d);
+        }
+        keys_.erase (iter);
+    }
+
+    bool
+    contains (Id const& id) const
+    {
+        return keys_.count (id) != 0;
+    }
+
+    /** Returns the items depending on any of the keys, once each. */
+    template <class FwdIt>
+    std::vector<Id>
+    affected (FwdIt first, FwdIt last) const
+    {
+        hash_set<Id> seen;
+        std::vector<Id> result;
+        for (; first != last; ++first)
+        {
+            auto const d = dependents_.find (*first);
+            if (d == dependents_.end ())
+                continue;
+            for (auto const& id : d->second)
+            {
+                if (seen.insert (id).second)
+                    result.push_back (id);
+            }
+        }
+        return result;
+    }
+
+    std::vector<Id>
+    affected (std::vector<uint256> const& keys) const
+    {
+        return affected (keys.begin (), keys.end ());
+    }
+
+    /** Returns the number of items. */
+    std::size_t
+    size () const
+    {
+        return keys_.size ();
+    }
+
+    /** Returns the number of distinct keys depended on. */
+    std::size_t
+    keys () const
+    {
+        return dependents_.size ();
+    }
+
+    void
+    clear ()
+    {
+        keys_.clear ();
+        dependents_.clear ();
+    }
+
+private:
+    hash_map<Id, std::vector<uint256>> keys_;
+    hash_map<uint256, std::vector<Id>> dependents_;
+};
+
+} //
+
+#endif
@@ -0,0 +1,435 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_FLATDEFERREDCREDITS_H_INCLUDED
+#define MTCHAIN_LEDGER_FLATDEFERREDCREDITS_H_INCLUDED
+
+#include <mtchain/beast/hash/uhash.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace mtchain {
+
+/** The credits and owner counts deferred by a payment sandbox.
+
+    This keeps the same information as the std::map based DeferredCredits
+    of PaymentSandbox, with the same results, in flat vectors. A sandbox
+    rarely touches more than a handful of trust lines, so lookups scan
+    the entries until there are enough of them to be worth hashing.
+
+    Flow creates and discards sandboxes thousands of times per payment.
+    When given a Pool, the vectors are taken from it on construction and
+    handed back, emptied but with their capacity, on destruction, so once
+    the first few strands have been evaluated the sandboxes of a Flow
+    call allocate nothing. The pool must outlive every table using it.
+    Neither class is thread safe.
+
+    `Amount` must support +=, unary - and an unqualified zeroed(amount)
+    returning zero in the amount's issue, as STAmount does. A table
+    keeps one `Hash` for its lifetime; hashes are never compared across
+    tables, so a seeded hasher such as hardened_hash also works.
+*/
+template <class Account, class Currency, class Amount,
+    class Hash = beast::uhash<>>
+class FlatDeferredCredits
+{
+public:
+    struct Adjustment
+    {
+        Adjustment (Amount const& d, Amount const& c, Amount const& b)
+            : debits (d), credits (c), origBalance (b)
+        {
+        }
+
+        Amount debits;
+        Amount credits;
+        Amount origBalance;
+    };
+
+private:
+    struct Credit
+    {
+        std::size_t hash;
+        Account low;
+        Account high;
+        Currency currency;
+        Amount lowAcctCredits;
+        Amount highAcctCredits;
+        Amount lowAcctOrigBalance;
+    };
+
+    struct Storage
+    {
+        std::vector<Credit> credits;
+        std::vector<std::uint32_t> index;   // open addressing, into credits
+        std::vector<std::pair<Account, std::uint32_t>> ownerCounts;
+    };
+
+public:
+    /** Storage shared by the sandboxes of one Flow call. */
+    class Pool
+    {
+    public:
+        Pool () = default;
+        Pool (Pool const&) = delete;
+        Pool& operator= (Pool const&) = delete;
+
+        /** Returns the number of tables given new storage. */
+        std::size_t
+        created () const
+        {
+            return created_;
+        }
+
+        /** Returns the number of tables given recycled storage. */
+        std::size_t
+        reused () const
+        {
+            return reused_;
+        }
+
+    private:
+        friend class FlatDeferredCredits;
+
+        Storage
+        acquire ()
+        {
+            if (free_.empty ())
+            {
+                ++created_;
+                return {};
+            }
+            ++reused_;
+            Storage s = std::move (free_.back ());
+            free_.pop_back ();
+            return s;
+        }
+
+        void
+        release (Storage&& s)
+        {
+            s.credits.clear ();
+            s.index.clear ();
+            s.ownerCounts.clear ();
+            free_.push_back (std::move (s));
+        }
+
+        std::vector<Storage> free_;
+        std::size_t created_ = 0;
+        std::size_t reused_ = 0;
+    };
+
+    explicit
+    FlatDeferredCredits (Pool* pool = nullptr)
+        : pool_ (pool)
+    {
+        if (pool_)
+            s_ = pool_->acquire ();
+    }
+
+    FlatDeferredCredits (FlatDeferredCredits&& other)
+        : hash_ (other.hash_)
+        , pool_ (other.pool_)
+        , s_ (std::move (other.s_))
+    {
+        other.pool_ = nullptr;
+    }
+
+    FlatDeferredCredits (FlatDeferredCredits const&) = delete;
+    FlatDeferredCredits& operator= (FlatDeferredCredits const&) = delete;
+
+    ~FlatDeferredCredits ()
+    {
+        if (pool_)
+            pool_->release (std::move (s_));
+    }
+
+    /** Record a credit made while the sandbox is open. */
+    void
+    credit (Account const& sender, Account const& receiver,
+        Amount const& amount, Amount const& preCreditSenderBalance,
+            Currency const& currency);
+
+    /** Record an owner count change, keeping the highest count seen. */
+    void
+    ownerCount (Account const& id, std::uint32_t cur, std::uint32_t next);
+
+    /** Returns the highest owner count recorded for the account. */
+    boost::optional<std::uint32_t>
+    ownerCount (Account const& id) const
+    {
+        auto const iter = findOwner (id);
+        if (iter == s_.ownerCounts.end ())
+            return boost::none;
+        return iter->second;
+    }
+
+    /** Returns the credits made between two accounts, from the point
+        of view of `main`.
+    */
+    boost::optional<Adjustment>
+    adjustments (Account const& main, Account const& other,
+        Currency const& currency) const;
+
+    /** Merge into the deferred credits of the parent sandbox. */
+    void
+    apply (FlatDeferredCredits& to) const;
+
+    /** Returns the number of trust lines credited. */
+    std::size_t
+    size () const
+    {
+        return s_.credits.size ();
+    }
+
+    bool
+    empty () const
+    {
+        return s_.credits.empty () && s_.ownerCounts.empty ();
+    }
+
+private:
+    // Below this many entries a scan beats hashing
+    static std::size_t constexpr linear = 8;
+    static std::uint32_t constexpr none =
+        std::numeric_limits<std::uint32_t>::max ();
+
+    std::size_t
+    hashKey (Account const& low, Account const& high,
+        Currency const& currency) const
+    {
+        std::size_t seed = hash_ (low);
+        seed ^= hash_ (high) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= hash_ (currency) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+
+    static
+    bool
+    matches (Credit const& c, std::size_t hash, Account const& low,
+        Account const& high, Currency const& currency)
+    {
+        return c.hash == hash && c.low == low && c.high == high &&
+            c.currency == currency;
+    }
+
+    Credit const*
+    find (std::size_t hash, Account const& low, Account const& high,
+        Currency const& currency) const;
+
+    Credit*
+    find (std::size_t hash, Account const& low, Account const& high,
+        Currency const& currency)
+    {
+        return const_cast<Credit*> (static_cast<FlatDeferredCredits const&> (
+            *this).find (hash, low, high, currency));
+    }
+
+    // Add a credit known not to be present
+    void
+    append (Credit&& c);
+
+    void
+    rehash ();
+
+    typename std::vector<std::pair<Account, std::uint32_t>>::const_iterator
+    findOwner (Account const& id) const
+    {
+        return std::find_if (s_.ownerCounts.begin (), s_.ownerCounts.end (),
+            [&id](std::pair<Account, std::uint32_t> const& e)
+            {
+                return e.first == id;
+            });
+    }
+
+    Hash hash_;
+    Pool* pool_;
+    Storage s_;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Account, class Currency, class Amount, class Hash>
+std::uint32_t constexpr
+FlatDeferredCredits<Account, Currency, Amount, Hash>::none;
+
+template <class Account, class Currency, class Amount, class Hash>
+auto
+FlatDeferredCredits<Account, Currency, Amount, Hash>::find (
+    std::size_t hash, Account const& low, Account const& high,
+        Currency const& currency) const -> Credit const*
+{
+    auto const& credits = s_.credits;
+    if (s_.index.empty ())
+    {
+        for (auto const& c : credits)
+        {
+            if (matches (c, hash, low, high, currency))
+                return &c;
+        }
+        return nullptr;
+    }
+
+    auto const mask = s_.index.size () - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask)
+    {
+        auto const pos = s_.index[i];
+        if (pos == none)
+            return nullptr;
+        if (matches (credits[pos], hash, low, high, currency))
+            return &credits[pos];
+    }
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+void
+FlatDeferredCredits<Account, Currency, Amount, Hash>::rehash ()
+{
+    std::size_t size = 2 * linear;
+    while (size < 2 * s_.credits.size ())
+        size *= 2;
+
+    s_.index.assign (size, none);
+    auto const mask = size - 1;
+    for (std::uint32_t pos = 0; pos < s_.credits.size (); ++pos)
+    {
+        auto i = s_.credits[pos].hash & mask;
+        while (s_.index[i] != none)
+            i = (i + 1) & mask;
+        s_.index[i] = pos;
+    }
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+void
+FlatDeferredCredits<Account, Currency, Amount, Hash>::append (Credit&& c)
+{
+    s_.credits.push_back (std::move (c));
+
+    // Keep the index at most half full
+    if (s_.credits.size () <= linear)
+        return;
+    if (2 * s_.credits.size () > s_.index.size ())
+        return rehash ();
+
+    auto const mask = s_.index.size () - 1;
+    auto i = s_.credits.back ().hash & mask;
+    while (s_.index[i] != none)
+        i = (i + 1) & mask;
+    s_.index[i] = static_cast<std::uint32_t> (s_.credits.size () - 1);
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+void
+FlatDeferredCredits<Account, Currency, Amount, Hash>::credit (
+    Account const& sender, Account const& receiver, Amount const& amount,
+        Amount const& preCreditSenderBalance, Currency const& currency)
+{
+    bool const senderLow = sender < receiver;
+    auto const& low = senderLow ? sender : receiver;
+    auto const& high = senderLow ? receiver : sender;
+    auto const hash = hashKey (low, high, currency);
+
+    if (auto c = find (hash, low, high, currency))
+    {
+        if (senderLow)
+            c->highAcctCredits += amount;
+        else
+            c->lowAcctCredits += amount;
+        return;
+    }
+
+    if (senderLow)
+    {
+        append (Credit { hash, low, high, currency,
+            zeroed (amount), amount, preCreditSenderBalance });
+    }
+    else
+    {
+        append (Credit { hash, low, high, currency,
+            amount, zeroed (amount), -preCreditSenderBalance });
+    }
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+void
+FlatDeferredCredits<Account, Currency, Amount, Hash>::ownerCount (
+    Account const& id, std::uint32_t cur, std::uint32_t next)
+{
+    auto const v = std::max (cur, next);
+    auto const iter = std::find_if (
+        s_.ownerCounts.begin (), s_.ownerCounts.end (),
+        [&id](std::pair<Account, std::uint32_t> const& e)
+        {
+            return e.first == id;
+        });
+    if (iter == s_.ownerCounts.end ())
+        s_.ownerCounts.emplace_back (id, v);
+    else
+        iter->second = std::max (iter->second, v);
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+auto
+FlatDeferredCredits<Account, Currency, Amount, Hash>::adjustments (
+    Account const& main, Account const& other,
+        Currency const& currency) const -> boost::optional<Adjustment>
+{
+    bool const mainLow = main < other;
+    auto const& low = mainLow ? main : other;
+    auto const& high = mainLow ? other : main;
+
+    auto const c = find (hashKey (low, high, currency), low, high, currency);
+    if (! c)
+        return boost::none;
+
+    if (mainLow)
+    {
+        return Adjustment (c->highAcctCredits, c->lowAcctCredits,
+            c->lowAcctOrigBalance);
+    }
+    return Adjustment (c->lowAcctCredits, c->highAcctCredits,
+        -c->lowAcctOrigBalance);
+}
+
+template <class Account, class Currency, class Amount, class Hash>
+void
+FlatDeferredCredits<Account, Currency, Amount, Hash>::apply (
+    FlatDeferredCredits& to) const
+{
+    for (auto const& c : s_.credits)
+    {
+        // The parent may hash differently
+        auto const hash = to.hashKey (c.low, c.high, c.currency);
+        if (auto t = to.find (hash, c.low, c.high, c.currency))
+        {
+            t->lowAcctCredits += c.lowAcctCredits;
+            t->highAcctCredits += c.highAcctCredits;
+            // The original balance is already correct
+        }
+        else
+        {
+            Credit copy (c);
+            copy.hash = hash;
+            to.append (std::move (copy));
+        }
+    }
+
+    for (auto const& o : s_.ownerCounts)
+        to.ownerCount (o.first, o.second, o.second);
+}
+
+} //
+
+#endif
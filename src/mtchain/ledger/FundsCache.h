@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_FUNDSCACHE_H_INCLUDED
+#define MTCHAIN_LEDGER_FUNDSCACHE_H_INCLUDED
+
+#include <mtchain/basics/UnorderedContainers.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace mtchain {
+
+/** Remembers how much of each asset its owners hold, for one transaction.
+
+    Crossing a long book asks for the funds of the same few owners over
+    and over: a busy market maker may own hundreds of consecutive
+    offers, and every one of them needs the owner's balance, trust line
+    and freeze state to decide whether it is funded. Wrapping those
+    lookups in this cache reads them once per owner and asset.
+
+    An entry is keyed on exactly (owner, issue, freeze handling), and
+    must hold the result of accountHolds for those arguments: whether
+    frozen funds count as zero (fhZERO_IF_FROZEN) or not
+    (fhIGNORE_FREEZE) changes the result, so the two are separate
+    entries. accountFunds must not be cached. When the owner is the
+    issuer it returns the amount the caller passed in, which differs
+    from one offer to the next, so callers wrap only the accountHolds
+    call it makes for other owners.
+
+    The cache must be told whenever an owner's funds may have changed,
+    which is whenever a balance or trust line of that owner is written
+    (for example from the view's credit hook), and it must not outlive
+    the view it was filled from. It is not thread safe.
+*/
+template <class Account, class Issue, class Amount, class FreezeHandling>
+class FundsCache
+{
+public:
+    FundsCache () = default;
+    FundsCache (FundsCache const&) = delete;
+    FundsCache& operator= (FundsCache const&) = delete;
+
+    /** Returns what an owner holds of an asset.
+
+        If it is not cached, `compute` is called with no arguments to
+        look it up with accountHolds (owner, issue, freeze).
+    */
+    template <class Compute>
+    Amount
+    get (Account const& owner, Issue const& issue,
+        FreezeHandling freeze, Compute&& compute)
+    {
+        auto& held = owners_[owner];
+        auto const iter = std::find_if (held.begin (), held.end (),
+            [&issue, freeze](Entry const& e)
+            {
+                return e.issue == issue && e.freeze == freeze;
+            });
+        if (iter != held.end ())
+        {
+            ++hits_;
+            return iter->amount;
+        }
+
+        ++misses_;
+        held.push_back (Entry { issue, freeze, compute () });
+        return held.back ().amount;
+    }
+
+    /** Forget everything cached for an owner. */
+    void
+    invalidate (Account const& owner)
+    {
+        owners_.erase (owner);
+    }
+
+    /** Forget everything cached for either side of a transfer. */
+    void
+    invalidate (Account const& from, Account const& to)
+    {
+        invalidate (from);
+        invalidate (to);
+    }
+
+    void
+    clear ()
+    {
+        owners_.clear ();
+    }
+
+    std::uint64_t
+    hits () const
+    {
+        return hits_;
+    }
+
+    std::uint64_t
+    misses () const
+    {
+        return misses_;
+    }
+
+private:
+    struct Entry
+    {
+        Issue issue;
+        FreezeHandling freeze;
+        Amount amount;
+    };
+
+    // An owner rarely holds more than a couple of the assets involved
+    // in one transaction, so a short list beats a second map.
+    hardened_hash_map<Account, std::vector<Entry>> owners_;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+};
+
+} //
+
+#endif
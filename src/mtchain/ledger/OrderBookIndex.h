@@ -0,0 +1,463 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_ORDERBOOKINDEX_H_INCLUDED
+#define MTCHAIN_LEDGER_ORDERBOOKINDEX_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace mtchain {
+
+/** An in-memory index of the offers in every order book.
+
+    Each book holds its offers in the order a walk of its directories
+    visits them: by quality, and within a quality in the order they
+    were placed. Along with each offer's key the index keeps an
+    `Offer` value chosen by the caller, typically the amounts and the
+    funded amount, so that iterating a book needs no state map lookups.
+
+    The index is built from a closed ledger and then updated from the
+    offer changes in each following ledger's metadata. A payment can
+    change what an offer is funded with without touching the offer, so
+    updates also name the owners whose funds changed (those with a
+    modified account root or trust line) and every offer they own is
+    refreshed. Every update publishes a new immutable Snapshot; books
+    which did not change are shared between snapshots, so open views
+    can hold on to the snapshot of their parent ledger for as long as
+    they like. A snapshot applies to a view only if it was built from
+    the view's parent ledger.
+
+    When an update can not be applied (a ledger was skipped, or the
+    changes refer to an offer the index does not hold) the index
+    becomes invalid until it is rebuilt with reset().
+
+    Updates, including reset(), must all be made from one thread.
+    Snapshots may be read from any thread.
+*/
+template <class Offer>
+class OrderBookIndex
+{
+public:
+    struct Entry
+    {
+        uint256 key;
+        std::uint64_t quality;
+        std::uint64_t order;        // position within the quality
+        Offer offer;
+        uint256 owner;              // the owner's account root key
+    };
+
+    /** The offers in one book, best first. */
+    class Book
+    {
+    public:
+        using const_iterator = typename std::vector<Entry>::const_iterator;
+
+        const_iterator
+        begin () const
+        {
+            return entries_.begin ();
+        }
+
+        const_iterator
+        end () const
+        {
+            return entries_.end ();
+        }
+
+        std::size_t
+        size () const
+        {
+            return entries_.size ();
+        }
+
+        bool
+        empty () const
+        {
+            return entries_.empty ();
+        }
+
+        /** Returns the first offer whose quality is no better than the
+            given one.
+        */
+        const_iterator
+        lower_bound (std::uint64_t quality) const
+        {
+            return std::lower_bound (entries_.begin (), entries_.end (),
+                quality, [](Entry const& e, std::uint64_t q)
+                {
+                    return e.quality < q;
+                });
+        }
+
+    private:
+        friend class OrderBookIndex;
+
+        std::vector<Entry> entries_;
+    };
+
+    /** The books as of one closed ledger. */
+    class Snapshot
+    {
+    public:
+        std::uint32_t
+        seq () const
+        {
+            return seq_;
+        }
+
+        uint256 const&
+        hash () const
+        {
+            return hash_;
+        }
+
+        /** Returns the book, or nullptr if it has no offers. */
+        std::shared_ptr<Book const>
+        book (uint256 const& base) const
+        {
+            auto const iter = books_.find (base);
+            if (iter == books_.end ())
+                return {};
+            return iter->second;
+        }
+
+        std::size_t
+        books () const
+        {
+            return books_.size ();
+        }
+
+    private:
+        friend class OrderBookIndex;
+
+        std::uint32_t seq_ = 0;
+        uint256 hash_;
+        hash_map<uint256, std::shared_ptr<Book const>> books_;
+    };
+
+    /** One change from a ledger's metadata. */
+    struct Change
+    {
+        enum Kind
+        {
+            created,
+            modified,
+            deleted,
+            funds                   // the owner's balances changed
+        };
+
+        Kind kind;
+        uint256 book;               // the book's base directory key
+        uint256 key;
+        std::uint64_t quality;      // needed when created
+        Offer offer;                // needed when created or modified
+        uint256 owner;              // needed when created, or funds
+    };
+
+    /** Returns the new value of an offer whose owner's funds changed. */
+    using Refresh = std::function<Offer (Entry const&)>;
+
+    OrderBookIndex () = default;
+    OrderBookIndex (OrderBookIndex const&) = delete;
+    OrderBookIndex& operator= (OrderBookIndex const&) = delete;
+
+    /** Returns the latest snapshot, or nullptr if the index is invalid. */
+    std::shared_ptr<Snapshot const>
+    current () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return current_;
+    }
+
+    /** Returns the latest snapshot if it was built from the given
+        ledger, otherwise nullptr.
+    */
+    std::shared_ptr<Snapshot const>
+    current (uint256 const& ledgerHash) const
+    {
+        auto s = current ();
+        if (s && s->hash () != ledgerHash)
+            s.reset ();
+        return s;
+    }
+
+    /** Rebuild the index from every offer in a closed ledger.
+
+        @param offers Created changes, in the order a walk of each
+                      book's directories visits the offers.
+    */
+    void
+    reset (std::uint32_t seq, uint256 const& hash,
+        std::vector<Change> const& offers);
+
+    /** Apply the changes of the ledger which follows the one the
+        index was built from.
+
+        Offer changes are applied in the order given, which should be
+        the order of the transactions which made them. Then, for each
+        funds change, `refresh` is called on every offer of the owner
+        and should compute its value as of the new ledger.
+
+        @return `false` if the changes could not be applied, in which
+                case the index is now invalid.
+    */
+    bool
+    apply (std::uint32_t seq, uint256 const& parentHash,
+        uint256 const& hash, std::vector<Change> const& changes,
+            Refresh const& refresh = {});
+
+    /** Discard the index until the next reset. */
+    void
+    invalidate ()
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        current_.reset ();
+    }
+
+private:
+    struct Location
+    {
+        uint256 book;
+        std::uint64_t quality;
+        std::uint64_t order;
+        uint256 owner;
+    };
+
+    static
+    bool
+    before (Entry const& e, std::pair<std::uint64_t, std::uint64_t> p)
+    {
+        return std::tie (e.quality, e.order) < std::tie (p.first, p.second);
+    }
+
+    // Returns a book of the new snapshot which may be modified
+    static
+    Book&
+    writable (Snapshot& next, hash_set<uint256>& copied, uint256 const& base);
+
+    bool
+    update (Snapshot& next, hash_set<uint256>& copied, Change const& c);
+
+    bool
+    refreshOwner (Snapshot& next, hash_set<uint256>& copied,
+        uint256 const& owner, Refresh const& refresh);
+
+    void
+    clearLocations ()
+    {
+        where_.clear ();
+        owned_.clear ();
+    }
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<Snapshot const> current_;
+
+    // Only used by the thread applying updates
+    hash_map<uint256, Location> where_;
+    hash_map<uint256, std::vector<uint256>> owned_;
+    std::uint64_t nextOrder_ = 0;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Offer>
+auto
+OrderBookIndex<Offer>::writable (Snapshot& next,
+    hash_set<uint256>& copied, uint256 const& base) -> Book&
+{
+    auto& slot = next.books_[base];
+    if (! slot)
+    {
+        copied.insert (base);
+        slot = std::make_shared<Book> ();
+    }
+    else if (copied.insert (base).second)
+    {
+        // The first change to this book in this update. Until now
+        // it was shared with the prior snapshot, so copy it.
+        slot = std::make_shared<Book> (*slot);
+    }
+
+    // Books this update made are not yet visible to anyone
+    return const_cast<Book&> (*slot);
+}
+
+template <class Offer>
+bool
+OrderBookIndex<Offer>::update (Snapshot& next,
+    hash_set<uint256>& copied, Change const& c)
+{
+    if (c.kind == Change::created)
+    {
+        if (where_.count (c.key) != 0)
+            return false;
+
+        Location const loc { c.book, c.quality, nextOrder_++, c.owner };
+        auto& book = writable (next, copied, c.book);
+        auto const pos = std::lower_bound (book.entries_.begin (),
+            book.entries_.end (), std::make_pair (loc.quality, loc.order),
+                &OrderBookIndex::before);
+        book.entries_.insert (pos,
+            Entry { c.key, loc.quality, loc.order, c.offer, c.owner });
+        where_.emplace (c.key, loc);
+        owned_[c.owner].push_back (c.key);
+        return true;
+    }
+
+    auto const iter = where_.find (c.key);
+    if (iter == where_.end ())
+        return false;
+    auto const loc = iter->second;
+
+    auto& book = writable (next, copied, loc.book);
+    auto const pos = std::lower_bound (book.entries_.begin (),
+        book.entries_.end (), std::make_pair (loc.quality, loc.order),
+            &OrderBookIndex::before);
+    if (pos == book.entries_.end () || pos->key != c.key)
+        return false;
+
+    if (c.kind == Change::modified)
+    {
+        pos->offer = c.offer;
+        return true;
+    }
+
+    auto const o = owned_.find (loc.owner);
+    if (o == owned_.end ())
+        return false;
+    auto& keys = o->second;
+    auto const k = std::find (keys.begin (), keys.end (), c.key);
+    if (k == keys.end ())
+        return false;
+
+    book.entries_.erase (pos);
+    where_.erase (iter);
+    if (book.entries_.empty ())
+        next.books_.erase (loc.book);
+
+    *k = keys.back ();
+    keys.pop_back ();
+    if (keys.empty ())
+        owned_.erase (o);
+    return true;
+}
+
+template <class Offer>
+bool
+OrderBookIndex<Offer>::refreshOwner (Snapshot& next,
+    hash_set<uint256>& copied, uint256 const& owner, Refresh const& refresh)
+{
+    auto const o = owned_.find (owner);
+    if (o == owned_.end ())
+        return true;
+    if (! refresh)
+        return false;
+
+    for (auto const& key : o->second)
+    {
+        auto const iter = where_.find (key);
+        if (iter == where_.end ())
+            return false;
+        auto const& loc = iter->second;
+        auto& book = writable (next, copied, loc.book);
+        auto const pos = std::lower_bound (book.entries_.begin (),
+            book.entries_.end (), std::make_pair (loc.quality, loc.order),
+                &OrderBookIndex::before);
+        if (pos == book.entries_.end () || pos->key != key)
+            return false;
+        pos->offer = refresh (*pos);
+    }
+    return true;
+}
+
+template <class Offer>
+void
+OrderBookIndex<Offer>::reset (std::uint32_t seq, uint256 const& hash,
+    std::vector<Change> const& offers)
+{
+    invalidate ();
+    clearLocations ();
+
+    auto next = std::make_shared<Snapshot> ();
+    next->seq_ = seq;
+    next->hash_ = hash;
+
+    hash_set<uint256> copied;
+    for (auto const& c : offers)
+    {
+        if (c.kind != Change::created || ! update (*next, copied, c))
+        {
+            clearLocations ();
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock (mutex_);
+    current_ = std::move (next);
+}
+
+template <class Offer>
+bool
+OrderBookIndex<Offer>::apply (std::uint32_t seq, uint256 const& parentHash,
+    uint256 const& hash, std::vector<Change> const& changes,
+        Refresh const& refresh)
+{
+    auto const prior = current ();
+    if (! prior || prior->seq () + 1 != seq || prior->hash () != parentHash)
+    {
+        invalidate ();
+        return false;
+    }
+
+    // Books are shared with the prior snapshot until first changed
+    auto next = std::make_shared<Snapshot> (*prior);
+    next->seq_ = seq;
+    next->hash_ = hash;
+
+    hash_set<uint256> copied;
+    for (auto const& c : changes)
+    {
+        if (c.kind != Change::funds && ! update (*next, copied, c))
+        {
+            invalidate ();
+            return false;
+        }
+    }
+
+    // Offers created above already carry their funding as of this
+    // ledger, but refreshing them again is harmless
+    for (auto const& c : changes)
+    {
+        if (c.kind == Change::funds &&
+            ! refreshOwner (*next, copied, c.owner, refresh))
+        {
+            invalidate ();
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock (mutex_);
+    current_ = std::move (next);
+    return true;
+}
+
+} //
+
+#endif
@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_SPECULATIVEAPPLY_H_INCLUDED
+#define MTCHAIN_LEDGER_SPECULATIVEAPPLY_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace mtchain {
+
+/** The outcome of running one transaction against the starting state,
+    with the state entry keys it read and wrote.
+*/
+template <class Outcome>
+struct Speculation
+{
+    Outcome outcome;
+    std::vector<uint256> reads;
+    std::vector<uint256> writes;
+};
+
+struct SpeculativeApplyStats
+{
+    std::size_t committed = 0;      // speculative results used
+    std::size_t reexecuted = 0;     // conflicts applied serially
+};
+
+/** Apply a sequence of transactions using parallel speculation.
+
+    First every transaction is run on `threads` threads against the
+    state as it was before any of them, each in its own sandbox, via
+
+        Speculation<Outcome> speculate (std::size_t i)
+
+    which must not modify shared state. Results are then committed in
+    canonical order. A speculation is only valid if no key it read or
+    wrote was written by an earlier transaction of the batch; otherwise
+    the transaction is applied again, serially, against the state as it
+    is at that point, via
+
+        std::vector<uint256> execute (std::size_t i)
+
+    which applies it and returns the keys it wrote. Valid speculations
+    are applied with
+
+        void commit (std::size_t i, Outcome&& outcome)
+
+    The result is the same as executing every transaction in order,
+    provided speculate reports every key its outcome depends on.
+
+    If speculate throws, the first exception is rethrown after all
+    threads have finished and nothing has been committed.
+*/
+template <class Outcome, class Speculate, class Commit, class Execute>
+SpeculativeApplyStats
+applySpeculatively (std::size_t count, std::size_t threads,
+    Speculate&& speculate, Commit&& commit, Execute&& execute)
+{
+    std::vector<boost::optional<Speculation<Outcome>>> results (count);
+
+    {
+        std::atomic<std::size_t> next {0};
+        std::atomic<bool> failed {false};
+        std::exception_ptr error;
+
+        auto worker = [&]
+        {
+            for (;;)
+            {
+                auto const i = next++;
+                if (i >= count || failed)
+                    return;
+                try
+                {
+                    results[i].emplace (speculate (i));
+                }
+                catch (...)
+                {
+                    if (! failed.exchange (true))
+                        error = std::current_exception ();
+                    return;
+                }
+            }
+        };
+
+        threads = std::max<std::size_t> (1, std::min (threads, count));
+        std::vector<std::thread> workers;
+        workers.reserve (threads - 1);
+        for (std::size_t t = 1; t < threads; ++t)
+            workers.emplace_back (worker);
+        worker ();
+        for (auto& w : workers)
+            w.join ();
+
+        if (error)
+            std::rethrow_exception (error);
+    }
+
+    SpeculativeApplyStats stats;
+    hash_set<uint256> written;
+
+    auto const clean = [&written](std::vector<uint256> const& keys)
+    {
+        return std::none_of (keys.begin (), keys.end (),
+            [&written](uint256 const& k)
+            {
+                return written.count (k) != 0;
+            });
+    };
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto& s = *results[i];
+        if (clean (s.reads) && clean (s.writes))
+        {
+            written.insert (s.writes.begin (), s.writes.end ());
+            commit (i, std::move (s.outcome));
+            ++stats.committed;
+        }
+        else
+        {
+            auto const writes = execute (i);
+            written.insert (writes.begin (), writes.end ());
+            ++stats.reexecuted;
+        }
+        results[i] = boost::none;
+    }
+
+    return stats;
+}
+
+} //
+
+#endif
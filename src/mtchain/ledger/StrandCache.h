@@ -0,0 +1,188 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_LEDGER_STRANDCACHE_H_INCLUDED
+#define MTCHAIN_LEDGER_STRANDCACHE_H_INCLUDED
+
+#include <mtchain/ledger/DependencyIndex.h>
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mtchain {
+
+/** Caches the strands built for payments through one open ledger.
+
+    Consecutive payments along the same corridor build identical
+    strands, and
+    their quality upper bounds only change when an entry the strands
+    step through changes. An entry holds whatever the payment engine
+    wants to reuse, typically the strands with their qualities, along
+    with the keys of the trust lines, accounts and book directories
+    those depend on.
+
+    A corridor is identified by a digest of everything strand
+    construction depends on: the source and destination accounts, the
+    assets, the path set, and the flags which change how strands are
+    built or which of them are used. These are whether the default
+    path, which ripples directly between the accounts, is added
+    (tfNoMTChainDirect), the limit quality when tfLimitQuality is set,
+    and whether the strands are for offer crossing.
+
+    Book directories are tracked by their bookBase, since an offer at a
+    new quality creates a directory the strands never read. Callers
+    pass their keys separately from the other keys, on insert() and on
+    invalidate(), and the cache maps them to the book; a directory key
+    passed among the other keys would only match itself.
+
+    After each transaction is applied, invalidate() is given the keys
+    it modified and drops every entry depending on them. The cache is
+    emptied when the open ledger changes, and when it is full.
+*/
+template <class Strands>
+class StrandCache
+{
+public:
+    using pointer = std::shared_ptr<Strands const>;
+
+    explicit
+    StrandCache (std::size_t capacity = 1024)
+        : capacity_ (capacity)
+    {
+    }
+
+    StrandCache (StrandCache const&) = delete;
+    StrandCache& operator= (StrandCache const&) = delete;
+
+    /** Start caching for a new open ledger, if it is not the current one.
+
+        @param ledger Identifies the open ledger, for example the hash
+                      of its parent.
+    */
+    void
+    reset (uint256 const& ledger)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (ledger == ledger_)
+            return;
+        ledger_ = ledger;
+        entries_.clear ();
+        deps_.clear ();
+    }
+
+    /** Returns the cached strands for a corridor, or nullptr.
+
+        @param key A digest of the corridor, including the flags
+                   described above.
+    */
+    pointer
+    find (uint256 const& key)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        auto const iter = entries_.find (key);
+        if (iter == entries_.end ())
+        {
+            ++misses_;
+            return {};
+        }
+        ++hits_;
+        return iter->second;
+    }
+
+    /** Cache strands along with the keys of the entries they used.
+
+        @param dependencies The keys of the trust lines and accounts.
+        @param books A directory key of each book stepped through.
+    */
+    void
+    insert (uint256 const& key, pointer strands,
+        std::vector<uint256> dependencies,
+            std::vector<uint256> const& books = {})
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (entries_.size () >= capacity_ && entries_.count (key) == 0)
+        {
+            entries_.clear ();
+            deps_.clear ();
+        }
+        for (auto const& dir : books)
+            dependencies.push_back (bookBase (dir));
+        entries_[key] = std::move (strands);
+        deps_.insert (key, std::move (dependencies));
+    }
+
+    /** Drop the strands which depend on any of the modified keys.
+
+        @param modified The keys of the entries other than book
+                        directories which were changed.
+        @param books The keys of the book directories which were
+                     created, modified or deleted.
+    */
+    void
+    invalidate (std::vector<uint256> modified,
+        std::vector<uint256> const& books = {})
+    {
+        for (auto const& dir : books)
+            modified.push_back (bookBase (dir));
+
+        std::lock_guard<std::mutex> lock (mutex_);
+        for (auto const& key : deps_.affected (modified))
+        {
+            entries_.erase (key);
+            deps_.erase (key);
+            ++invalidated_;
+        }
+    }
+
+    std::size_t
+    size () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return entries_.size ();
+    }
+
+    std::uint64_t
+    hits () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return hits_;
+    }
+
+    std::uint64_t
+    misses () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return misses_;
+    }
+
+    std::uint64_t
+    invalidated () const
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        return invalidated_;
+    }
+
+private:
+    std::size_t const capacity_;
+    mutable std::mutex mutex_;
+    uint256 ledger_;
+    hash_map<uint256, pointer> entries_;
+    DependencyIndex<uint256> deps_;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::uint64_t invalidated_ = 0;
+};
+
+} //
+
+#endif
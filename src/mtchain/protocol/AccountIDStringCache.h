@@ -0,0 +1,87 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_ACCOUNTIDSTRINGCACHE_H_INCLUDED
+#define MTCHAIN_PROTOCOL_ACCOUNTIDSTRINGCACHE_H_INCLUDED
+
+#include <mtchain/protocol/AccountID.h>
+#include <mtchain/basics/UnorderedContainers.h>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mtchain {
+
+/** Caches the base58 form of recently used account IDs.
+
+    Unlike AccountIDCache, which forgets everything once it fills up,
+    each shard keeps its entries in least recently used order and only
+    evicts the oldest, so the accounts which appear in most responses
+    stay cached. Account IDs are uniformly distributed, so the shard is
+    picked by the first byte, and each shard has its own lock.
+*/
+class AccountIDStringCache
+{
+public:
+    /** Create a cache.
+
+        @param capacity The number of strings held, across all shards.
+        @param shards The number of independently locked shards.
+    */
+    explicit
+    AccountIDStringCache (std::size_t capacity, std::size_t shards = 16);
+
+    AccountIDStringCache (AccountIDStringCache const&) = delete;
+    AccountIDStringCache& operator= (AccountIDStringCache const&) = delete;
+
+    /** Returns the base58 form of the account ID. */
+    std::string
+    toBase58 (AccountID const& id);
+
+    std::uint64_t
+    hits () const
+    {
+        return hits_.load ();
+    }
+
+    std::uint64_t
+    misses () const
+    {
+        return misses_.load ();
+    }
+
+    /** Returns the number of strings currently cached. */
+    std::size_t
+    size () const;
+
+private:
+    struct Shard
+    {
+        using list_type = std::list<std::pair<AccountID, std::string>>;
+
+        std::mutex mutex;
+        list_type lru;      // most recently used first
+        hardened_hash_map<AccountID, list_type::iterator> map;
+    };
+
+    std::size_t const perShard_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> hits_ {0};
+    std::atomic<std::uint64_t> misses_ {0};
+};
+
+} //
+
+#endif
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_FASTBASE58_H_INCLUDED
+#define MTCHAIN_PROTOCOL_FASTBASE58_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mtchain {
+
+/** Base58 conversion using word sized arithmetic.
+
+    The textbook conversion divides the whole number by 58 once per
+    output digit, which is quadratic in the number of digits with a
+    large constant. These routines instead keep the number in limbs
+    of five base 58 digits (or 32 bits, when decoding) and fold in the
+    input a whole limb at a time with 64-bit multiplies, so encoding an
+    account ID takes about fifty multiply-adds.
+
+    The alphabet and the token format (a type byte, the payload and a
+    four byte double SHA-256 checksum) are the ones used by
+    encodeBase58Token and decodeBase58Token, and the results are
+    identical to theirs.
+*/
+
+/** Encode bytes as base58, without a type or checksum. */
+std::string
+fastEncodeBase58 (void const* data, std::size_t size);
+
+/** Decode base58 without a type or checksum.
+
+    @return The bytes, or an empty string if `s` has a character
+            outside the alphabet.
+*/
+std::string
+fastDecodeBase58 (std::string const& s);
+
+/** Encode a token of the given TokenType, with its checksum. */
+std::string
+fastEncodeBase58Token (std::uint8_t type, void const* token,
+    std::size_t size);
+
+/** Decode a token of the given TokenType, verifying its checksum.
+
+    @return The payload, or an empty string if the token is malformed,
+            has the wrong type or fails the checksum.
+*/
+std::string
+fastDecodeBase58Token (std::string const& s, std::uint8_t type);
+
+} //
+
+#endif
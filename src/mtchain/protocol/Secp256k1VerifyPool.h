@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_SECP256K1VERIFYPOOL_H_INCLUDED
+#define MTCHAIN_PROTOCOL_SECP256K1VERIFYPOOL_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/Blob.h>
+#include <mtchain/basics/Slice.h>
+#include <boost/lockfree/queue.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mtchain {
+
+/** Verifies secp256k1 signatures on a dedicated set of threads.
+
+    Each worker owns its own verification context, with its own copy
+    of the precomputed multiplication tables, so workers never share
+    context state. Requests are passed to the workers through a
+    bounded lock-free queue, so that the threads submitting them (peer
+    and RPC handlers) never block on a lock held by a verifier.
+
+    The handler of each request is called on a worker thread with the
+    verdict. Requests still queued when the pool is destroyed are
+    verified before the destructor returns.
+*/
+class Secp256k1VerifyPool
+{
+public:
+    using handler_type = std::function<void(bool)>;
+
+    struct Stats
+    {
+        std::uint64_t verified = 0;     // good signatures
+        std::uint64_t failed = 0;       // bad or malformed signatures
+        std::uint64_t dropped = 0;      // refused because the queue was full
+        std::size_t queued = 0;         // waiting to be verified
+        double perSecond = 0;           // checks per second since creation
+    };
+
+    /** Create a pool.
+
+        @param threads The number of verification threads, at least one.
+        @param capacity The most requests which may be waiting.
+    */
+    Secp256k1VerifyPool (std::size_t threads, std::size_t capacity = 4096);
+
+    ~Secp256k1VerifyPool ();
+
+    Secp256k1VerifyPool (Secp256k1VerifyPool const&) = delete;
+    Secp256k1VerifyPool& operator= (Secp256k1VerifyPool const&) = delete;
+
+    /** Queue a signature over a digest for verification.
+
+        The public key and DER encoded signature are copied. The
+        verdict is the same as verifyDigest from PublicKey.h would
+        give: only 33 byte compressed keys are accepted, signatures
+        must be strictly DER encoded and canonical, and when
+        `fullyCanonical` is set a signature with a high S value is
+        rejected.
+
+        @return `false` if the queue was full, in which case the handler
+                is not called.
+    */
+    bool
+    submit (uint256 const& digest, Slice publicKey, Slice signature,
+        bool fullyCanonical, handler_type handler);
+
+    /** Returns the number of verification threads. */
+    std::size_t
+    threads () const
+    {
+        return workers_.size ();
+    }
+
+    Stats
+    stats () const;
+
+private:
+    struct Request
+    {
+        uint256 digest;
+        Blob publicKey;
+        Blob signature;
+        bool fullyCanonical;
+        handler_type handler;
+    };
+
+    void
+    run ();
+
+    boost::lockfree::queue<Request*> queue_;
+    std::atomic<std::size_t> queued_ {0};
+    std::atomic<std::size_t> sleeping_ {0};
+    std::atomic<bool> stop_ {false};
+    std::atomic<std::uint64_t> verified_ {0};
+    std::atomic<std::uint64_t> failed_ {0};
+    std::atomic<std::uint64_t> dropped_ {0};
+    std::size_t const capacity_;
+    std::chrono::steady_clock::time_point const start_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<std::thread> workers_;
+};
+
+} //
+
+#endif
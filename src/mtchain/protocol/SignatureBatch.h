@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_SIGNATUREBATCH_H_INCLUDED
+#define MTCHAIN_PROTOCOL_SIGNATUREBATCH_H_INCLUDED
+
+#include <mtchain/basics/Blob.h>
+#include <mtchain/basics/Slice.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mtchain {
+
+/** One ed25519 signature to check.
+
+    The public key is in the 33 byte form used by PublicKey, with
+    the 0xED prefix. The referenced memory must remain valid for the
+    duration of the call which verifies it.
+*/
+struct Ed25519BatchItem
+{
+    Slice message;
+    Slice publicKey;
+    Slice signature;
+};
+
+/** Verify several ed25519 signatures at once.
+
+    Signatures are checked together, 64 at a time, with a single
+    multi-scalar multiplication, which is roughly twice as fast per
+    signature as checking them one by one. When a batch fails, every
+    signature in it is checked individually to find the bad ones.
+
+    Malformed keys, and signatures whose S or R is not canonically
+    encoded, are rejected before batching, exactly as they would be
+    by verify().
+
+    @note A batch is accepted when a random linear combination of the
+          verification equations holds. For honestly produced
+          signatures the result is identical to verifying each one
+          alone, but a signature deliberately built with a small order
+          component, which individual verification rejects, can pass a
+          batch with non-negligible probability. The result must
+          therefore not be used where every server has to reach the
+          same verdict (for example to mark a transaction's signature
+          as good in the HashRouter) unless that divergence is
+          acceptable.
+
+    @param items Pointer to `count` signatures.
+    @param valid Pointer to `count` results, written in order.
+*/
+void
+verifyEd25519Batch (
+    Ed25519BatchItem const* items,
+    bool* valid,
+    std::size_t count);
+
+inline
+std::vector<bool>
+verifyEd25519Batch (std::vector<Ed25519BatchItem> const& items)
+{
+    std::unique_ptr<bool[]> valid (new bool[items.size ()]);
+    verifyEd25519Batch (items.data (), valid.get (), items.size ());
+    return std::vector<bool> (valid.get (), valid.get () + items.size ());
+}
+
+/** Collects ed25519 signatures and verifies them in batches.
+
+    Each signature is copied in along with a handler, which is called
+    with the verdict when the batch holding it is verified. A batch is
+    verified, on the calling thread, as soon as it is full or when
+    flush() is called; callers feeding it from a queue typically flush
+    whenever the queue runs dry so that no signature waits for long.
+
+    This class is not thread safe.
+*/
+class Ed25519BatchVerifier
+{
+public:
+    using handler_type = std::function<void(bool)>;
+
+    explicit
+    Ed25519BatchVerifier (std::size_t batchSize = 64);
+
+    Ed25519BatchVerifier (Ed25519BatchVerifier const&) = delete;
+    Ed25519BatchVerifier& operator= (Ed25519BatchVerifier const&) = delete;
+
+    /** Queue a signature, verifying the batch if it is now full. */
+    void
+    add (Slice message, Slice publicKey, Slice signature,
+        handler_type handler);
+
+    /** Verify any queued signatures. */
+    void
+    flush ();
+
+    /** Returns the number of queued signatures. */
+    std::size_t
+    size () const
+    {
+        return pending_.size ();
+    }
+
+private:
+    struct Pending
+    {
+        Blob message;
+        Blob publicKey;
+        Blob signature;
+        handler_type handler;
+    };
+
+    std::size_t const batchSize_;
+    std::vector<Pending> pending_;
+};
+
+} //
+
+#endif
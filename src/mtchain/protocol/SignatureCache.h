@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_SIGNATURECACHE_H_INCLUDED
+#define MTCHAIN_PROTOCOL_SIGNATURECACHE_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/Slice.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mtchain {
+
+/** Remembers signatures which have already been verified.
+
+    An entry records that a signature was found to be good. It is
+    identified by the transaction ID, the account the signature was
+    made for, the public key and the signature itself. The account is
+    needed because the signers of a multi-signed transaction each sign
+    the transaction along with their own account ID, and two Signers
+    entries may use the same key for different accounts: a good
+    signature for one must not vouch for the other. For a single
+    signature, which covers no account, pass an empty `signer`.
+    Failed checks are not recorded.
+
+    The cache has a fixed size. Entries are stored as a salted hash of
+    these in a set-associative table split into independently
+    locked shards; when a set is full, a new entry replaces one of the
+    existing ones. The salt is chosen at random per cache, so an
+    attacker can not pick transactions which crowd out a given entry.
+*/
+class SignatureCache
+{
+public:
+    /** Counters, as returned by getStats. */
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::size_t size = 0;
+
+        double
+        hitRate () const
+        {
+            auto const total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double> (hits) / total;
+        }
+    };
+
+    /** Create a cache.
+
+        @param capacity The number of signatures held, rounded up.
+    */
+    explicit
+    SignatureCache (std::size_t capacity = 65536);
+
+    SignatureCache (SignatureCache const&) = delete;
+    SignatureCache& operator= (SignatureCache const&) = delete;
+
+    /** Returns `true` if the signature was recorded as good.
+
+        Counts a hit or a miss.
+    */
+    bool
+    contains (uint256 const& txID, Slice signer, Slice publicKey,
+        Slice signature);
+
+    /** Record a good signature. */
+    void
+    insert (uint256 const& txID, Slice signer, Slice publicKey,
+        Slice signature);
+
+    /** Check a signature, using the cache if possible.
+
+        If the signature is not in the cache, `check` is called with no
+        arguments and, if it returns `true`, the signature is recorded.
+
+        @return `true` if the signature is good.
+    */
+    template <class Check>
+    bool
+    verify (uint256 const& txID, Slice signer, Slice publicKey,
+        Slice signature, Check&& check)
+    {
+        if (contains (txID, signer, publicKey, signature))
+            return true;
+        if (! check ())
+            return false;
+        insert (txID, signer, publicKey, signature);
+        return true;
+    }
+
+    /** Forget every signature. Counters are kept. */
+    void
+    clear ();
+
+    /** Returns the number of signatures the cache can hold. */
+    std::size_t
+    capacity () const
+    {
+        return shards_.size () * setsPerShard_ * ways;
+    }
+
+    Stats
+    getStats () const;
+
+private:
+    static std::size_t constexpr ways = 4;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::vector<uint256> slots;
+        std::size_t size = 0;
+    };
+
+    uint256
+    key (uint256 const& txID, Slice signer, Slice publicKey,
+        Slice signature) const;
+
+    Shard&
+    shard (uint256 const& k);
+
+    std::size_t
+    set (uint256 const& k) const;
+
+    std::uint8_t salt_[32];
+    std::size_t setsPerShard_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> hits_ {0};
+    std::atomic<std::uint64_t> misses_ {0};
+};
+
+} //
+
+#endif
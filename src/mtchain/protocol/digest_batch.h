@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_PROTOCOL_DIGEST_BATCH_H_INCLUDED
+#define MTCHAIN_PROTOCOL_DIGEST_BATCH_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/Slice.h>
+#include <cstddef>
+#include <vector>
+
+namespace mtchain {
+
+/** The implementations available for batch SHA-512Half. */
+enum class sha512_batch_engine
+{
+    scalar,     // one message at a time through OpenSSL
+    avx2,       // four messages per pass
+    avx512      // eight messages per pass
+};
+
+/** Returns the fastest batch engine supported by this CPU.
+
+    The result is determined once, on first use, by querying
+    the processor at run time.
+*/
+sha512_batch_engine
+sha512Half_batch_engine ();
+
+/** Returns a printable name for a batch engine. */
+char const*
+to_string (sha512_batch_engine engine);
+
+/** Compute the SHA-512-Half of several independent messages.
+
+    The messages are hashed side by side in the lanes of the widest
+    vector unit available, which is considerably faster than hashing
+    them one at a time when many small inputs of similar length are
+    hashed together (for example the children of dirty inner nodes).
+    The result is bit-for-bit identical to calling sha512Half on each
+    message individually.
+
+    @param messages Pointer to `count` message buffers.
+    @param digests Pointer to `count` results, written in order.
+*/
+void
+sha512Half_batch (
+    Slice const* messages,
+    uint256* digests,
+    std::size_t count);
+
+inline
+std::vector<uint256>
+sha512Half_batch (std::vector<Slice> const& messages)
+{
+    std::vector<uint256> digests (messages.size ());
+    sha512Half_batch (messages.data (), digests.data (), messages.size ());
+    return digests;
+}
+
+namespace detail {
+
+/** Hash a batch using a specific engine.
+
+    @return `false` if the engine is not supported by this CPU,
+            in which case no digests are written.
+*/
+bool
+sha512Half_batch (
+    sha512_batch_engine engine,
+    Slice const* messages,
+    uint256* digests,
+    std::size_t count);
+
+} // detail
+
+} //
+
+#endif
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/AccountIDStringCache.h>
+#include <mtchain/protocol/FastBase58.h>
+#include <algorithm>
+
+namespace mtchain {
+
+namespace {
+
+// TokenType::TOKEN_ACCOUNT_ID
+std::uint8_t constexpr accountIDToken = 0;
+
+std::size_t
+perShard (std::size_t capacity, std::size_t shards)
+{
+    return std::max<std::size_t> ((capacity + shards - 1) / shards, 1);
+}
+
+}
+
+AccountIDStringCache::AccountIDStringCache (
+        std::size_t capacity, std::size_t shards)
+    : perShard_ (perShard (capacity, std::max<std::size_t> (shards, 1)))
+{
+    shards = std::max<std::size_t> (shards, 1);
+    shards_.reserve (shards);
+    for (std::size_t i = 0; i < shards; ++i)
+    {
+        shards_.emplace_back (new Shard);
+        shards_.back ()->map.reserve (perShard_);
+    }
+}
+
+std::string
+AccountIDStringCache::toBase58 (AccountID const& id)
+{
+    auto& s = *shards_[id.data ()[0] % shards_.size ()];
+
+    {
+        std::lock_guard<std::mutex> lock (s.mutex);
+        auto const iter = s.map.find (id);
+        if (iter != s.map.end ())
+        {
+            s.lru.splice (s.lru.begin (), s.lru, iter->second);
+            ++hits_;
+            return iter->second->second;
+        }
+    }
+
+    // Encode without holding the lock
+    ++misses_;
+    auto result = fastEncodeBase58Token (
+        accountIDToken, id.data (), id.size ());
+
+    std::lock_guard<std::mutex> lock (s.mutex);
+    if (s.map.find (id) != s.map.end ())
+        return result;
+
+    if (s.lru.size () >= perShard_)
+    {
+        s.map.erase (s.lru.back ().first);
+        s.lru.pop_back ();
+    }
+    s.lru.emplace_front (id, result);
+    s.map.emplace (id, s.lru.begin ());
+    return result;
+}
+
+std::size_t
+AccountIDStringCache::size () const
+{
+    std::size_t n = 0;
+    for (auto const& s : shards_)
+    {
+        std::lock_guard<std::mutex> lock (s->mutex);
+        n += s->lru.size ();
+    }
+    return n;
+}
+
+} //
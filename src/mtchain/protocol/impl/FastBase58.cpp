@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/FastBase58.h>
+#include <mtchain/protocol/digest.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace mtchain {
+
+namespace {
+
+char const alphabet[] =
+    "rpshnaf39wBUDNEGHJKLM4PQRST7VWXYZ2bcdeCg65jkm8oFqi1tuvAxyz";
+
+// Five base 58 digits per limb when encoding
+std::uint64_t constexpr radix = 58ull * 58 * 58 * 58 * 58;
+std::size_t constexpr radixDigits = 5;
+
+std::array<std::uint64_t, 6> const powers58 = {{
+    1, 58, 58 * 58, 58 * 58 * 58, 58ull * 58 * 58 * 58, radix }};
+
+std::array<std::int8_t, 256> const&
+inverse ()
+{
+    static std::array<std::int8_t, 256> const table = []
+    {
+        std::array<std::int8_t, 256> t;
+        t.fill (-1);
+        for (int i = 0; i < 58; ++i)
+            t[static_cast<unsigned char> (alphabet[i])] =
+                static_cast<std::int8_t> (i);
+        return t;
+    }();
+    return table;
+}
+
+// Limb storage which avoids the heap for the usual small inputs
+class Limbs
+{
+public:
+    explicit
+    Limbs (std::size_t capacity)
+    {
+        if (capacity > small_.size ())
+        {
+            large_.resize (capacity);
+            data_ = large_.data ();
+        }
+    }
+
+    std::uint32_t*
+    data ()
+    {
+        return data_;
+    }
+
+private:
+    std::array<std::uint32_t, 48> small_;
+    std::vector<std::uint32_t> large_;
+    std::uint32_t* data_ = small_.data ();
+};
+
+// Multiply the little endian limbs by `factor` and add `carry`,
+// in the given base. Returns the new number of limbs.
+std::size_t
+multiplyAdd (std::uint32_t* limbs, std::size_t count,
+    std::uint64_t factor, std::uint64_t carry, std::uint64_t base)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const t = limbs[i] * factor + carry;
+        limbs[i] = static_cast<std::uint32_t> (t % base);
+        carry = t / base;
+    }
+    while (carry != 0)
+    {
+        limbs[count++] = static_cast<std::uint32_t> (carry % base);
+        carry /= base;
+    }
+    return count;
+}
+
+// Shifting by 32 bits is cheaper than the general division
+std::size_t
+multiplyAdd32 (std::uint32_t* limbs, std::size_t count,
+    std::uint64_t factor, std::uint64_t carry)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const t = limbs[i] * factor + carry;
+        limbs[i] = static_cast<std::uint32_t> (t);
+        carry = t >> 32;
+    }
+    while (carry != 0)
+    {
+        limbs[count++] = static_cast<std::uint32_t> (carry);
+        carry >>= 32;
+    }
+    return count;
+}
+
+void
+checksum (void* out, void const* data, std::size_t size)
+{
+    sha256_hasher h1;
+    h1 (data, size);
+    auto const d1 = static_cast<sha256_hasher::result_type> (h1);
+    sha256_hasher h2;
+    h2 (d1.data (), d1.size ());
+    auto const d2 = static_cast<sha256_hasher::result_type> (h2);
+    std::memcpy (out, d2.data (), 4);
+}
+
+}
+
+std::string
+fastEncodeBase58 (void const* data, std::size_t size)
+{
+    auto const p = static_cast<std::uint8_t const*> (data);
+
+    std::size_t zeros = 0;
+    while (zeros < size && p[zeros] == 0)
+        ++zeros;
+
+    // log(256) / log(58^5) is just under 0.28
+    Limbs buffer ((size - zeros) * 28 / 100 + 2);
+    auto const limbs = buffer.data ();
+    std::size_t count = 0;
+
+    // Fold in the input 32 bits at a time, the leading partial
+    // word first
+    std::size_t i = zeros;
+    std::size_t const head = (size - zeros) % 4;
+    if (head != 0)
+    {
+        std::uint64_t word = 0;
+        for (auto const end = i + head; i < end; ++i)
+            word = (word << 8) | p[i];
+        count = multiplyAdd (limbs, count, 1ull << (8 * head), word, radix);
+    }
+    for (; i < size; i += 4)
+    {
+        std::uint64_t const word =
+            (std::uint64_t (p[i]) << 24) | (std::uint64_t (p[i + 1]) << 16) |
+            (std::uint64_t (p[i + 2]) << 8) | p[i + 3];
+        count = multiplyAdd (limbs, count, 1ull << 32, word, radix);
+    }
+
+    std::string result (zeros + count * radixDigits, alphabet[0]);
+    auto out = result.begin () + zeros;
+    for (std::size_t j = count; j-- != 0;)
+    {
+        char digits[radixDigits];
+        std::uint32_t v = limbs[j];
+        for (std::size_t k = radixDigits; k-- != 0;)
+        {
+            digits[k] = alphabet[v % 58];
+            v /= 58;
+        }
+
+        if (j + 1 == count)
+        {
+            // No leading zero digits in the most significant limb
+            std::size_t skip = 0;
+            while (skip < radixDigits - 1 && digits[skip] == alphabet[0])
+                ++skip;
+            out = std::copy (digits + skip, digits + radixDigits, out);
+        }
+        else
+        {
+            out = std::copy (digits, digits + radixDigits, out);
+        }
+    }
+    result.erase (out, result.end ());
+    return result;
+}
+
+std::string
+fastDecodeBase58 (std::string const& s)
+{
+    auto const& inv = inverse ();
+
+    std::size_t zeros = 0;
+    while (zeros < s.size () && s[zeros] == alphabet[0])
+        ++zeros;
+
+    // log(58^5) / log(2^32) is just under 0.92, per five digits
+    Limbs buffer ((s.size () - zeros) * 19 / 100 + 2);
+    auto const limbs = buffer.data ();
+    std::size_t count = 0;
+
+    std::size_t i = zeros;
+    std::size_t head = (s.size () - zeros) % radixDigits;
+    if (head == 0)
+        head = radixDigits;
+    while (i < s.size ())
+    {
+        std::uint64_t group = 0;
+        for (auto const end = i + head; i < end; ++i)
+        {
+            auto const d = inv[static_cast<unsigned char> (s[i])];
+            if (d < 0)
+                return {};
+            group = group * 58 + d;
+        }
+        count = multiplyAdd32 (limbs, count, powers58[head], group);
+        head = radixDigits;
+    }
+
+    std::string result (zeros + count * 4, '\0');
+    auto out = result.begin () + zeros;
+    bool leading = true;
+    for (std::size_t j = count; j-- != 0;)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            auto const b = static_cast<char> (limbs[j] >> shift);
+            if (leading && b == 0)
+                continue;
+            leading = false;
+            *out++ = b;
+        }
+    }
+    result.erase (out, result.end ());
+    return result;
+}
+
+std::string
+fastEncodeBase58Token (std::uint8_t type, void const* token,
+    std::size_t size)
+{
+    std::uint8_t small[1 + 64 + 4];
+    std::vector<std::uint8_t> large;
+    auto buf = small;
+    if (size > 64)
+    {
+        large.resize (1 + size + 4);
+        buf = large.data ();
+    }
+
+    buf[0] = type;
+    if (size != 0)
+        std::memcpy (buf + 1, token, size);
+    checksum (buf + 1 + size, buf, 1 + size);
+    return fastEncodeBase58 (buf, 1 + size + 4);
+}
+
+std::string
+fastDecodeBase58Token (std::string const& s, std::uint8_t type)
+{
+    auto const result = fastDecodeBase58 (s);
+
+    // The type, at least one byte of payload, and the checksum
+    if (result.size () < 6)
+        return {};
+    if (static_cast<std::uint8_t> (result[0]) != type)
+        return {};
+
+    std::uint8_t guard[4];
+    checksum (guard, result.data (), result.size () - 4);
+    if (std::memcmp (guard, result.data () + result.size () - 4, 4) != 0)
+        return {};
+
+    return result.substr (1, result.size () - 5);
+}
+
+} //
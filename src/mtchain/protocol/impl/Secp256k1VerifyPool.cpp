@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/Secp256k1VerifyPool.h>
+#include <mtchain/protocol/PublicKey.h>
+#include <secp256k1/include/secp256k1.h>
+#include <algorithm>
+#include <memory>
+
+namespace mtchain {
+
+namespace {
+
+struct ContextDeleter
+{
+    void
+    operator() (secp256k1_context* ctx) const
+    {
+        secp256k1_context_destroy (ctx);
+    }
+};
+
+// Must accept exactly what verifyDigest in PublicKey.cpp accepts
+bool
+verifyDigest (secp256k1_context const* ctx, uint256 const& digest,
+    Blob const& publicKey, Blob const& signature, bool fullyCanonical)
+{
+    // Only compressed keys; PublicKey refuses anything else
+    if (publicKeyType (makeSlice (publicKey)) != KeyType::secp256k1)
+        return false;
+
+    auto const canonicality = ecdsaCanonicality (makeSlice (signature));
+    if (! canonicality)
+        return false;
+    if (fullyCanonical &&
+            *canonicality != ECDSACanonicality::fullyCanonical)
+        return false;
+
+    secp256k1_pubkey key;
+    if (secp256k1_ec_pubkey_parse (ctx, &key,
+            publicKey.data (), publicKey.size ()) != 1)
+        return false;
+
+    secp256k1_ecdsa_signature sig;
+    if (secp256k1_ecdsa_signature_parse_der (ctx, &sig,
+            signature.data (), signature.size ()) != 1)
+        return false;
+
+    // Verification only accepts the low S form
+    if (*canonicality != ECDSACanonicality::fullyCanonical)
+        secp256k1_ecdsa_signature_normalize (ctx, &sig, &sig);
+
+    return secp256k1_ecdsa_verify (ctx, &sig, digest.data (), &key) == 1;
+}
+
+}
+
+Secp256k1VerifyPool::Secp256k1VerifyPool (
+        std::size_t threads, std::size_t capacity)
+    : queue_ (capacity)
+    , capacity_ (capacity)
+    , start_ (std::chrono::steady_clock::now ())
+{
+    threads = std::max<std::size_t> (threads, 1);
+    workers_.reserve (threads);
+    for (std::size_t i = 0; i < threads; ++i)
+        workers_.emplace_back (&Secp256k1VerifyPool::run, this);
+}
+
+Secp256k1VerifyPool::~Secp256k1VerifyPool ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    wakeup_.notify_all ();
+    for (auto& w : workers_)
+        w.join ();
+}
+
+bool
+Secp256k1VerifyPool::submit (uint256 const& digest, Slice publicKey,
+    Slice signature, bool fullyCanonical, handler_type handler)
+{
+    // The queue itself may hold more than capacity_ once its free
+    // list has grown, so the limit is enforced on the count.
+    if (++queued_ > capacity_)
+    {
+        --queued_;
+        ++dropped_;
+        return false;
+    }
+
+    std::unique_ptr<Request> r (new Request);
+    r->digest = digest;
+    r->publicKey.assign (publicKey.data (),
+        publicKey.data () + publicKey.size ());
+    r->signature.assign (signature.data (),
+        signature.data () + signature.size ());
+    r->fullyCanonical = fullyCanonical;
+    r->handler = std::move (handler);
+
+    if (! queue_.push (r.get ()))
+    {
+        --queued_;
+        ++dropped_;
+        return false;
+    }
+    r.release ();
+
+    // Pairs with the fence in run(): either the worker sees the
+    // request or we see the worker asleep and wake it.
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (sleeping_.load () != 0)
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        wakeup_.notify_one ();
+    }
+    return true;
+}
+
+Secp256k1VerifyPool::Stats
+Secp256k1VerifyPool::stats () const
+{
+    Stats s;
+    s.verified = verified_.load ();
+    s.failed = failed_.load ();
+    s.dropped = dropped_.load ();
+    s.queued = queued_.load ();
+
+    auto const elapsed = std::chrono::duration<double> (
+        std::chrono::steady_clock::now () - start_).count ();
+    if (elapsed > 0)
+        s.perSecond = (s.verified + s.failed) / elapsed;
+    return s;
+}
+
+void
+Secp256k1VerifyPool::run ()
+{
+    std::unique_ptr<secp256k1_context, ContextDeleter> const ctx (
+        secp256k1_context_create (SECP256K1_CONTEXT_VERIFY));
+
+    for (;;)
+    {
+        Request* p = nullptr;
+        if (! queue_.pop (p))
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            ++sleeping_;
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+            while (! queue_.pop (p))
+            {
+                if (stop_)
+                {
+                    --sleeping_;
+                    return;
+                }
+                wakeup_.wait (lock);
+            }
+            --sleeping_;
+        }
+
+        std::unique_ptr<Request> const r (p);
+        --queued_;
+
+        bool const ok = verifyDigest (ctx.get (), r->digest,
+            r->publicKey, r->signature, r->fullyCanonical);
+        ++(ok ? verified_ : failed_);
+        r->handler (ok);
+    }
+}
+
+} //
@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/SignatureBatch.h>
+#include <ed25519-donna/ed25519.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace mtchain {
+
+namespace {
+
+// S must be below the group order, as verify() requires
+bool
+canonicalS (std::uint8_t const* s)
+{
+    // The order, little endian
+    static std::uint8_t const order[32] = {
+        0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58,
+        0xD6, 0x9C, 0xF7, 0xA2, 0xDE, 0xF9, 0xDE, 0x14,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10 };
+
+    for (int i = 31; i >= 0; --i)
+    {
+        if (s[i] != order[i])
+            return s[i] < order[i];
+    }
+    return false;
+}
+
+// Individual verification compares R with the encoding it computes, so
+// it never accepts an R which is not the canonical encoding of a point.
+// Batch verification decodes R instead and must be kept from accepting
+// an alternate encoding: y at or above the field prime, or a negative
+// zero x coordinate (y = 1 or y = -1 with the sign bit set).
+bool
+canonicalR (std::uint8_t const* r)
+{
+    bool const sign = (r[31] & 0x80) != 0;
+    bool const high = (r[31] & 0x7F) == 0x7F &&
+        std::all_of (r + 1, r + 31, [](std::uint8_t b) { return b == 0xFF; });
+
+    if (high && r[0] >= 0xED)
+        return false;
+
+    if (sign)
+    {
+        // y = p - 1
+        if (high && r[0] == 0xEC)
+            return false;
+        // y = 1
+        if (r[0] == 0x01 && (r[31] & 0x7F) == 0 &&
+                std::all_of (r + 1, r + 31,
+                    [](std::uint8_t b) { return b == 0; }))
+            return false;
+    }
+
+    return true;
+}
+
+bool
+wellFormed (Ed25519BatchItem const& item)
+{
+    return item.publicKey.size () == 33 &&
+        item.publicKey[0] == 0xED &&
+        item.signature.size () == 64 &&
+        canonicalR (item.signature.data ()) &&
+        canonicalS (item.signature.data () + 32);
+}
+
+}
+
+void
+verifyEd25519Batch (
+    Ed25519BatchItem const* items,
+    bool* valid,
+    std::size_t count)
+{
+    std::vector<unsigned char const*> messages;
+    std::vector<std::size_t> sizes;
+    std::vector<unsigned char const*> keys;
+    std::vector<unsigned char const*> signatures;
+    std::vector<std::size_t> index;
+
+    messages.reserve (count);
+    sizes.reserve (count);
+    keys.reserve (count);
+    signatures.reserve (count);
+    index.reserve (count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        valid[i] = false;
+        if (! wellFormed (items[i]))
+            continue;
+
+        messages.push_back (items[i].message.data ());
+        sizes.push_back (items[i].message.size ());
+        keys.push_back (items[i].publicKey.data () + 1);
+        signatures.push_back (items[i].signature.data ());
+        index.push_back (i);
+    }
+
+    if (index.empty ())
+        return;
+
+    std::vector<int> results (index.size ());
+    ed25519_sign_open_batch (messages.data (), sizes.data (), keys.data (),
+        signatures.data (), index.size (), results.data ());
+
+    for (std::size_t j = 0; j < index.size (); ++j)
+        valid[index[j]] = results[j] == 1;
+}
+
+//------------------------------------------------------------------------------
+
+Ed25519BatchVerifier::Ed25519BatchVerifier (std::size_t batchSize)
+    : batchSize_ (std::max<std::size_t> (batchSize, 1))
+{
+    pending_.reserve (batchSize_);
+}
+
+void
+Ed25519BatchVerifier::add (Slice message, Slice publicKey,
+    Slice signature, handler_type handler)
+{
+    Pending p;
+    p.message.assign (message.begin (), message.end ());
+    p.publicKey.assign (publicKey.begin (), publicKey.end ());
+    p.signature.assign (signature.begin (), signature.end ());
+    p.handler = std::move (handler);
+    pending_.push_back (std::move (p));
+
+    if (pending_.size () >= batchSize_)
+        flush ();
+}
+
+void
+Ed25519BatchVerifier::flush ()
+{
+    if (pending_.empty ())
+        return;
+
+    // Handlers may queue more signatures
+    std::vector<Pending> batch;
+    batch.swap (pending_);
+    pending_.reserve (batchSize_);
+
+    std::vector<Ed25519BatchItem> items;
+    items.reserve (batch.size ());
+    for (auto const& p : batch)
+        items.push_back ({ makeSlice (p.message), makeSlice (p.publicKey),
+            makeSlice (p.signature) });
+
+    auto const valid = verifyEd25519Batch (items);
+    for (std::size_t i = 0; i < batch.size (); ++i)
+        batch[i].handler (valid[i]);
+}
+
+} //
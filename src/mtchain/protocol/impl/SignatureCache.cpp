@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/SignatureCache.h>
+#include <mtchain/protocol/digest.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+namespace mtchain {
+
+namespace {
+
+std::size_t constexpr shardCount = 16;
+
+std::uint64_t
+load64 (std::uint8_t const* p)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+}
+
+SignatureCache::SignatureCache (std::size_t capacity)
+    : setsPerShard_ (1)
+{
+    while (shardCount * setsPerShard_ * ways < capacity)
+        setsPerShard_ *= 2;
+
+    shards_.reserve (shardCount);
+    for (std::size_t i = 0; i < shardCount; ++i)
+    {
+        shards_.emplace_back (new Shard);
+        shards_.back ()->slots.resize (setsPerShard_ * ways);
+    }
+
+    std::random_device rd;
+    for (auto& b : salt_)
+        b = static_cast<std::uint8_t> (rd ());
+}
+
+uint256
+SignatureCache::key (uint256 const& txID, Slice signer, Slice publicKey,
+    Slice signature) const
+{
+    sha512_half_hasher h;
+    h (salt_, sizeof(salt_));
+    h (txID.data (), txID.size ());
+
+    // Length prefixed, so that no two inputs hash the same bytes
+    for (auto const& s : { signer, publicKey, signature })
+    {
+        std::uint8_t const size[2] = {
+            static_cast<std::uint8_t> (s.size () >> 8),
+            static_cast<std::uint8_t> (s.size ()) };
+        h (size, sizeof(size));
+        h (s.data (), s.size ());
+    }
+    return static_cast<sha512_half_hasher::result_type> (h);
+}
+
+SignatureCache::Shard&
+SignatureCache::shard (uint256 const& k)
+{
+    return *shards_[k.data ()[0] % shards_.size ()];
+}
+
+std::size_t
+SignatureCache::set (uint256 const& k) const
+{
+    return (load64 (k.data () + 8) & (setsPerShard_ - 1)) * ways;
+}
+
+bool
+SignatureCache::contains (uint256 const& txID, Slice signer,
+    Slice publicKey, Slice signature)
+{
+    auto const k = key (txID, signer, publicKey, signature);
+    auto& s = shard (k);
+    auto const first = s.slots.begin () + set (k);
+
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock (s.mutex);
+        found = std::find (first, first + ways, k) != first + ways;
+    }
+
+    ++(found ? hits_ : misses_);
+    return found;
+}
+
+void
+SignatureCache::insert (uint256 const& txID, Slice signer,
+    Slice publicKey, Slice signature)
+{
+    auto const k = key (txID, signer, publicKey, signature);
+    auto& s = shard (k);
+    auto const first = s.slots.begin () + set (k);
+
+    std::lock_guard<std::mutex> lock (s.mutex);
+    if (std::find (first, first + ways, k) != first + ways)
+        return;
+
+    auto const empty = std::find_if (first, first + ways,
+        [](uint256 const& slot) { return slot.isZero (); });
+    if (empty != first + ways)
+    {
+        *empty = k;
+        ++s.size;
+        return;
+    }
+
+    // The set is full: evict the entry chosen by the new key
+    first[load64 (k.data () + 16) % ways] = k;
+}
+
+void
+SignatureCache::clear ()
+{
+    for (auto& s : shards_)
+    {
+        std::lock_guard<std::mutex> lock (s->mutex);
+        std::fill (s->slots.begin (), s->slots.end (), uint256 ());
+        s->size = 0;
+    }
+}
+
+SignatureCache::Stats
+SignatureCache::getStats () const
+{
+    Stats stats;
+    stats.hits = hits_.load ();
+    stats.misses = misses_.load ();
+    for (auto const& s : shards_)
+    {
+        std::lock_guard<std::mutex> lock (s->mutex);
+        stats.size += s->size;
+    }
+    return stats;
+}
+
+} //
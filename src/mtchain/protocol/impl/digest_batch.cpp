@@ -0,0 +1,409 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/digest_batch.h>
+#include <mtchain/protocol/digest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define MTCHAIN_DIGEST_BATCH_X86 1
+#include <immintrin.h>
+#else
+#define MTCHAIN_DIGEST_BATCH_X86 0
+#endif
+
+namespace mtchain {
+
+namespace {
+
+std::uint64_t const sha512_iv[8] =
+{
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+std::uint64_t const sha512_k[80] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+inline
+std::uint64_t
+load_be64 (std::uint8_t const* p)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+inline
+void
+store_be64 (std::uint8_t* p, std::uint64_t v)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        p[i] = static_cast<std::uint8_t>(v);
+        v >>= 8;
+    }
+}
+
+// One message being fed to one vector lane: whole blocks are read in
+// place, the padded remainder is built in a small local buffer.
+struct sha512_lane
+{
+    std::uint8_t const* data = nullptr;
+    std::size_t full = 0;
+    std::size_t blocks = 0;
+    std::uint8_t tail[256];
+
+    void
+    prepare (Slice const& message)
+    {
+        data = message.data ();
+        full = message.size () / 128;
+
+        std::size_t const rem = message.size () % 128;
+        std::size_t const tailBlocks = (rem + 17 <= 128) ? 1 : 2;
+
+        std::memset (tail, 0, sizeof(tail));
+        if (rem != 0)
+            std::memcpy (tail, data + full * 128, rem);
+        tail[rem] = 0x80;
+
+        // The length is 128 bits in the standard; the upper half is
+        // always zero for messages that fit in memory.
+        store_be64 (tail + tailBlocks * 128 - 8,
+            static_cast<std::uint64_t>(message.size ()) << 3);
+
+        blocks = full + tailBlocks;
+    }
+
+    std::uint8_t const*
+    block (std::size_t i) const
+    {
+        if (i < full)
+            return data + i * 128;
+        if (i < blocks)
+            return tail + (i - full) * 128;
+        // Past the end: feed padding, the result is never read
+        return tail;
+    }
+};
+
+void
+hash_scalar (Slice const* messages, uint256* digests, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        sha512_half_hasher h;
+        h (messages[i].data (), messages[i].size ());
+        digests[i] = static_cast<sha512_half_hasher::result_type>(h);
+    }
+}
+
+#if MTCHAIN_DIGEST_BATCH_X86
+
+//------------------------------------------------------------------------------
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+using vec = __m256i;
+std::size_t constexpr lanes = 4;
+
+inline vec add (vec a, vec b) { return _mm256_add_epi64 (a, b); }
+inline vec bxor (vec a, vec b) { return _mm256_xor_si256 (a, b); }
+
+inline
+vec
+ch (vec e, vec f, vec g)
+{
+    return _mm256_xor_si256 (
+        _mm256_and_si256 (e, f), _mm256_andnot_si256 (e, g));
+}
+
+inline
+vec
+maj (vec a, vec b, vec c)
+{
+    return _mm256_or_si256 (_mm256_and_si256 (a, b),
+        _mm256_and_si256 (c, _mm256_or_si256 (a, b)));
+}
+
+template <int n>
+inline
+vec
+ror (vec x)
+{
+    return _mm256_or_si256 (
+        _mm256_srli_epi64 (x, n), _mm256_slli_epi64 (x, 64 - n));
+}
+
+template <int n>
+inline
+vec
+shr (vec x)
+{
+    return _mm256_srli_epi64 (x, n);
+}
+
+inline
+vec
+broadcast (std::uint64_t v)
+{
+    return _mm256_set1_epi64x (static_cast<long long>(v));
+}
+
+inline
+vec
+load_lanes (std::uint64_t const* p)
+{
+    return _mm256_load_si256 (reinterpret_cast<vec const*>(p));
+}
+
+inline
+void
+store_lanes (std::uint64_t* p, vec v)
+{
+    _mm256_store_si256 (reinterpret_cast<vec*>(p), v);
+}
+
+#include <mtchain/protocol/impl/digest_batch_lanes.ipp>
+
+} // avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+//------------------------------------------------------------------------------
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// GCC's own AVX-512 intrinsics trip this warning (GCC bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace avx512 {
+
+using vec = __m512i;
+std::size_t constexpr lanes = 8;
+
+inline vec add (vec a, vec b) { return _mm512_add_epi64 (a, b); }
+inline vec bxor (vec a, vec b) { return _mm512_xor_si512 (a, b); }
+
+// (e & f) ^ (~e & g)
+inline vec ch (vec e, vec f, vec g) { return _mm512_ternarylogic_epi64 (e, f, g, 0xCA); }
+
+// (a & b) | (a & c) | (b & c)
+inline vec maj (vec a, vec b, vec c) { return _mm512_ternarylogic_epi64 (a, b, c, 0xE8); }
+
+template <int n>
+inline
+vec
+ror (vec x)
+{
+    return _mm512_ror_epi64 (x, n);
+}
+
+template <int n>
+inline
+vec
+shr (vec x)
+{
+    return _mm512_srli_epi64 (x, n);
+}
+
+inline
+vec
+broadcast (std::uint64_t v)
+{
+    return _mm512_set1_epi64 (static_cast<long long>(v));
+}
+
+inline
+vec
+load_lanes (std::uint64_t const* p)
+{
+    return _mm512_load_si512 (p);
+}
+
+inline
+void
+store_lanes (std::uint64_t* p, vec v)
+{
+    _mm512_store_si512 (p, v);
+}
+
+#include <mtchain/protocol/impl/digest_batch_lanes.ipp>
+
+} // avx512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif
+
+//------------------------------------------------------------------------------
+
+bool
+supported (sha512_batch_engine engine)
+{
+    switch (engine)
+    {
+    case sha512_batch_engine::scalar:
+        return true;
+#if MTCHAIN_DIGEST_BATCH_X86
+    case sha512_batch_engine::avx2:
+        return __builtin_cpu_supports ("avx2");
+    case sha512_batch_engine::avx512:
+        return __builtin_cpu_supports ("avx512f");
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+sha512_batch_engine
+select_engine ()
+{
+    if (supported (sha512_batch_engine::avx512))
+        return sha512_batch_engine::avx512;
+    if (supported (sha512_batch_engine::avx2))
+        return sha512_batch_engine::avx2;
+    return sha512_batch_engine::scalar;
+}
+
+void
+hash_with (sha512_batch_engine engine,
+    Slice const* messages, uint256* digests, std::size_t count)
+{
+    switch (engine)
+    {
+#if MTCHAIN_DIGEST_BATCH_X86
+    case sha512_batch_engine::avx512:
+        avx512::hash (messages, digests, count);
+        return;
+    case sha512_batch_engine::avx2:
+        avx2::hash (messages, digests, count);
+        return;
+#endif
+    default:
+        hash_scalar (messages, digests, count);
+        return;
+    }
+}
+
+} // (anonymous)
+
+sha512_batch_engine
+sha512Half_batch_engine ()
+{
+    static sha512_batch_engine const engine = select_engine ();
+    return engine;
+}
+
+char const*
+to_string (sha512_batch_engine engine)
+{
+    switch (engine)
+    {
+    case sha512_batch_engine::scalar: return "scalar";
+    case sha512_batch_engine::avx2:   return "avx2";
+    case sha512_batch_engine::avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+void
+sha512Half_batch (
+    Slice const* messages,
+    uint256* digests,
+    std::size_t count)
+{
+    // A single message gains nothing from the vector engines
+    if (count < 2)
+    {
+        hash_scalar (messages, digests, count);
+        return;
+    }
+
+    hash_with (sha512Half_batch_engine (), messages, digests, count);
+}
+
+namespace detail {
+
+bool
+sha512Half_batch (
+    sha512_batch_engine engine,
+    Slice const* messages,
+    uint256* digests,
+    std::size_t count)
+{
+    if (! supported (engine))
+        return false;
+
+    hash_with (engine, messages, digests, count);
+    return true;
+}
+
+} // detail
+
+} //
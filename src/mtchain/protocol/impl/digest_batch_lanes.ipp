@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+// Multi-lane SHA-512 compression and driver.
+//
+// This file is included once per vector engine by digest_batch.cpp, inside
+// a namespace that defines `vec`, `lanes` and the lane-wise primitives
+// add, bxor, ch, maj, ror<n>, shr<n>, broadcast, load_lanes and store_lanes.
+// It intentionally has no include guard.
+
+inline
+vec
+big_sigma0 (vec x)
+{
+    return bxor (bxor (ror<28> (x), ror<34> (x)), ror<39> (x));
+}
+
+inline
+vec
+big_sigma1 (vec x)
+{
+    return bxor (bxor (ror<14> (x), ror<18> (x)), ror<41> (x));
+}
+
+inline
+vec
+small_sigma0 (vec x)
+{
+    return bxor (bxor (ror<1> (x), ror<8> (x)), shr<7> (x));
+}
+
+inline
+vec
+small_sigma1 (vec x)
+{
+    return bxor (bxor (ror<19> (x), ror<61> (x)), shr<6> (x));
+}
+
+static
+void
+compress (vec* state, sha512_lane const* lane, std::size_t index)
+{
+    alignas(64) std::uint64_t tmp[lanes];
+    std::uint8_t const* block[lanes];
+
+    for (std::size_t l = 0; l < lanes; ++l)
+        block[l] = lane[l].block (index);
+
+    vec w[16];
+
+    for (int t = 0; t < 16; ++t)
+    {
+        for (std::size_t l = 0; l < lanes; ++l)
+            tmp[l] = load_be64 (block[l] + 8 * t);
+        w[t] = load_lanes (tmp);
+    }
+
+    vec a = state[0];
+    vec b = state[1];
+    vec c = state[2];
+    vec d = state[3];
+    vec e = state[4];
+    vec f = state[5];
+    vec g = state[6];
+    vec h = state[7];
+
+    for (int t = 0; t < 80; ++t)
+    {
+        if (t >= 16)
+        {
+            w[t & 15] = add (
+                add (small_sigma1 (w[(t - 2) & 15]), w[(t - 7) & 15]),
+                add (small_sigma0 (w[(t - 15) & 15]), w[t & 15]));
+        }
+
+        vec const t1 = add (
+            add (add (h, big_sigma1 (e)), add (ch (e, f, g), broadcast (sha512_k[t]))),
+            w[t & 15]);
+        vec const t2 = add (big_sigma0 (a), maj (a, b, c));
+
+        h = g;
+        g = f;
+        f = e;
+        e = add (d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = add (t1, t2);
+    }
+
+    state[0] = add (state[0], a);
+    state[1] = add (state[1], b);
+    state[2] = add (state[2], c);
+    state[3] = add (state[3], d);
+    state[4] = add (state[4], e);
+    state[5] = add (state[5], f);
+    state[6] = add (state[6], g);
+    state[7] = add (state[7], h);
+}
+
+static
+void
+hash (Slice const* messages, uint256* digests, std::size_t count)
+{
+    sha512_lane lane[lanes];
+    alignas(64) std::uint64_t out[4][lanes];
+
+    for (std::size_t base = 0; base < count; base += lanes)
+    {
+        std::size_t const active = std::min (lanes, count - base);
+        std::size_t rounds = 0;
+
+        for (std::size_t l = 0; l < lanes; ++l)
+        {
+            // Unused lanes hash an empty message whose result is discarded
+            lane[l].prepare (l < active ? messages[base + l] : Slice{});
+            if (l < active)
+                rounds = std::max (rounds, lane[l].blocks);
+        }
+
+        vec state[8];
+        for (int i = 0; i < 8; ++i)
+            state[i] = broadcast (sha512_iv[i]);
+
+        for (std::size_t i = 0; i < rounds; ++i)
+        {
+            compress (state, lane, i);
+
+            // A lane that has consumed its last block holds its final
+            // digest now; later passes only feed it padding and are ignored.
+            bool stored = false;
+
+            for (std::size_t l = 0; l < active; ++l)
+            {
+                if (lane[l].blocks != i + 1)
+                    continue;
+
+                if (! stored)
+                {
+                    for (int j = 0; j < 4; ++j)
+                        store_lanes (out[j], state[j]);
+                    stored = true;
+                }
+
+                std::uint8_t* p = digests[base + l].data ();
+                for (int j = 0; j < 4; ++j)
+                    store_be64 (p + 8 * j, out[j][l]);
+            }
+        }
+    }
+}
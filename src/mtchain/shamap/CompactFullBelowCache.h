@@ -0,0 +1,364 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_COMPACTFULLBELOWCACHE_H_INCLUDED
+#define MTCHAIN_SHAMAP_COMPACTFULLBELOWCACHE_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/beast/clock/abstract_clock.h>
+#include <mtchain/beast/insight/Insight.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+
+namespace detail {
+
+/** A FullBelowCache stored in a flat open-addressing table.
+
+    Offers the same interface as BasicFullBelowCache but keeps each entry
+    in a 16 byte slot: a 64-bit tag taken from the key, the generation
+    the entry was inserted in, and its last access time in seconds.
+    Clearing the cache only bumps the generation: entries from older
+    generations are simply treated as empty and are reused in place, so
+    clear() is O(1) no matter how many entries the cache holds.
+
+    Keys must be uniformly distributed (they are SHAMap node hashes), so
+    their leading bytes are used directly as both tag and probe start. Two
+    different keys with equal tags are indistinguishable. With 63 bits
+    of tag, the chance that any two of n entries share a tag is about
+    n^2 / 2^64: around 5 * 10^-6 for ten million entries, and the chance
+    for a given lookup is about n / 2^63. A false positive makes sync
+    treat a subtree it has not fetched as complete, so the missing nodes
+    are only noticed when something reads them (as a missing node) and
+    the ledger is acquired again. Use BasicFullBelowCache, which keeps
+    the full key, where that is not acceptable.
+
+    Probing is linear. Inserts always take the first slot on the probe
+    sequence that is not part of the current generation, and lookups stop
+    at that same slot, which keeps both short even when the table holds
+    many stale entries.
+*/
+template <class Key>
+class BasicCompactFullBelowCache
+{
+public:
+    enum
+    {
+         defaultCacheTargetSize = 0
+        ,defaultCacheExpirationSeconds = 120
+    };
+
+    using key_type   = Key;
+    using size_type  = std::size_t;
+    using clock_type = beast::abstract_clock <std::chrono::steady_clock>;
+
+private:
+    struct Slot
+    {
+        std::uint64_t tag;          // 0 = never used
+        std::uint32_t gen;
+        std::uint32_t when;         // seconds on clock_type
+    };
+
+    static_assert (sizeof(Slot) == 16, "");
+
+    static std::size_t constexpr minimumCapacity = 1024;
+
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            , hits (0)
+            , misses (0)
+        { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+
+        std::size_t hits;
+        std::size_t misses;
+    };
+
+    mutable std::mutex m_mutex;
+    Stats m_stats;
+    std::string const m_name;
+    clock_type& m_clock;
+    std::size_t const m_target_size;
+    std::chrono::seconds const m_target_age;
+
+    std::vector <Slot> m_slots;
+    std::size_t m_mask;
+    std::size_t m_size;             // entries of the current generation
+    std::size_t m_used;             // slots ever used since the last rebuild
+    std::atomic <std::uint32_t> m_gen;
+
+    static
+    std::uint64_t
+    read64 (std::uint8_t const* p)
+    {
+        std::uint64_t v;
+        std::memcpy (&v, p, sizeof(v));
+        return v;
+    }
+
+    static
+    std::uint64_t
+    tagOf (key_type const& key)
+    {
+        // Never zero, which marks an unused slot. The bit set is one
+        // the mask never covers, so every slot can be a home slot.
+        return read64 (key.data ()) | (std::uint64_t (1) << 63);
+    }
+
+    std::uint32_t
+    now () const
+    {
+        return static_cast<std::uint32_t> (
+            std::chrono::duration_cast<std::chrono::seconds> (
+                m_clock.now ().time_since_epoch ()).count ());
+    }
+
+    // Returns the slot holding the key in the current generation, or
+    // the slot where it belongs if it is absent.
+    Slot&
+    find (std::uint64_t tag, std::uint32_t gen)
+    {
+        std::size_t i = static_cast<std::size_t> (tag) & m_mask;
+        for (;;)
+        {
+            Slot& s = m_slots[i];
+            if (s.tag == 0 || s.gen != gen || s.tag == tag)
+                return s;
+            i = (i + 1) & m_mask;
+        }
+    }
+
+    // Reinsert the live entries of the current generation into a table
+    // of the given capacity, dropping anything stale or expired.
+    void
+    rebuild (std::size_t capacity, std::uint32_t expire)
+    {
+        std::uint32_t const gen = m_gen;
+        std::vector <Slot> old (capacity, Slot {0, 0, 0});
+        old.swap (m_slots);
+        m_mask = capacity - 1;
+        m_size = 0;
+        m_used = 0;
+
+        for (auto const& s : old)
+        {
+            if (s.tag == 0 || s.gen != gen || s.when < expire)
+                continue;
+
+            std::size_t i = static_cast<std::size_t> (s.tag) & m_mask;
+            while (m_slots[i].tag != 0)
+                i = (i + 1) & m_mask;
+            m_slots[i] = s;
+            ++m_size;
+            ++m_used;
+        }
+    }
+
+    void
+    collect_metrics ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        m_stats.size.set (m_size);
+        auto const total = m_stats.hits + m_stats.misses;
+        m_stats.hit_rate.set (total == 0 ? 0 : (m_stats.hits * 100) / total);
+    }
+
+public:
+    BasicCompactFullBelowCache (std::string const& name, clock_type& clock,
+        beast::insight::Collector::ptr const& collector =
+            beast::insight::NullCollector::New (),
+        std::size_t target_size = defaultCacheTargetSize,
+        std::size_t expiration_seconds = defaultCacheExpirationSeconds)
+        : m_stats (name,
+            std::bind (&BasicCompactFullBelowCache::collect_metrics, this),
+                collector)
+        , m_name (name)
+        , m_clock (clock)
+        , m_target_size (target_size)
+        , m_target_age (expiration_seconds)
+        , m_slots (minimumCapacity, Slot {0, 0, 0})
+        , m_mask (minimumCapacity - 1)
+        , m_size (0)
+        , m_used (0)
+        , m_gen (1)
+    {
+    }
+
+    BasicCompactFullBelowCache (BasicCompactFullBelowCache const&) = delete;
+    BasicCompactFullBelowCache& operator= (
+        BasicCompactFullBelowCache const&) = delete;
+
+    /** Return the clock associated with the cache. */
+    clock_type&
+    clock ()
+    {
+        return m_clock;
+    }
+
+    /** Return the number of entries in the current generation. */
+    size_type
+    size () const
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        return m_size;
+    }
+
+    /** Return the number of bytes held by the table. */
+    std::size_t
+    bytes () const
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        return m_slots.size () * sizeof(Slot);
+    }
+
+    /** Remove expired and stale entries, shrinking the table if it
+        has become mostly empty.
+    */
+    void
+    sweep ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+
+        auto const when = now ();
+        std::chrono::seconds age = m_target_age;
+        if (m_target_size != 0 && m_size > m_target_size)
+        {
+            age = std::max (std::chrono::seconds (1),
+                std::chrono::seconds (
+                    m_target_age.count () * m_target_size / m_size));
+        }
+        std::uint32_t const expire = (when > age.count ()) ?
+            static_cast<std::uint32_t> (when - age.count ()) : 0;
+
+        rebuild (m_slots.size (), expire);
+
+        std::size_t capacity = m_slots.size ();
+        while (capacity > minimumCapacity && m_size * 8 < capacity)
+            capacity /= 2;
+        if (capacity != m_slots.size ())
+            rebuild (capacity, 0);
+    }
+
+    /** Refresh the last access time of a key.
+
+        @return `true` if the key is in the current generation.
+    */
+    bool
+    touch_if_exists (key_type const& key)
+    {
+        auto const tag = tagOf (key);
+        std::lock_guard <std::mutex> lock (m_mutex);
+
+        Slot& s = find (tag, m_gen);
+        if (s.tag == tag && s.gen == m_gen)
+        {
+            s.when = now ();
+            ++m_stats.hits;
+            return true;
+        }
+
+        ++m_stats.misses;
+        return false;
+    }
+
+    /** Insert a key into the current generation. */
+    void
+    insert (key_type const& key)
+    {
+        auto const tag = tagOf (key);
+        std::lock_guard <std::mutex> lock (m_mutex);
+
+        std::uint32_t const gen = m_gen;
+        Slot& s = find (tag, gen);
+
+        if (s.tag == tag && s.gen == gen)
+        {
+            s.when = now ();
+            return;
+        }
+
+        if (s.tag == 0)
+            ++m_used;
+
+        s.tag = tag;
+        s.gen = gen;
+        s.when = now ();
+        ++m_size;
+
+        // Keep probe sequences short
+        if (m_used * 10 > m_slots.size () * 7)
+        {
+            std::size_t capacity = m_slots.size ();
+            while (m_size * 10 > capacity * 4)
+                capacity *= 2;
+            rebuild (capacity, 0);
+        }
+    }
+
+    std::uint32_t
+    getGeneration () const
+    {
+        return m_gen;
+    }
+
+    /** Forget every entry by starting a new generation. */
+    void
+    clear ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        m_size = 0;
+        ++m_gen;
+
+        // Generations wrapped: old slots could look current again
+        if (m_gen == 0)
+        {
+            m_gen = 1;
+            std::fill (m_slots.begin (), m_slots.end (), Slot {0, 0, 0});
+            m_used = 0;
+        }
+    }
+
+    void
+    reset ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        std::vector <Slot> (minimumCapacity, Slot {0, 0, 0}).swap (m_slots);
+        m_mask = minimumCapacity - 1;
+        m_size = 0;
+        m_used = 0;
+        m_gen = 1;
+    }
+};
+
+} // detail
+
+using CompactFullBelowCache = detail::BasicCompactFullBelowCache <uint256>;
+
+} //
+
+#endif
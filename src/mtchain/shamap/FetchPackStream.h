@@ -0,0 +1,185 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_FETCHPACKSTREAM_H_INCLUDED
+#define MTCHAIN_SHAMAP_FETCHPACKSTREAM_H_INCLUDED
+
+#include <mtchain/shamap/SHAMapTreeNode.h>
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/Blob.h>
+#include <mtchain/basics/Slice.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mtchain {
+
+/** Serializes fetch pack nodes straight into an outgoing buffer.
+
+    Each node is appended as its 32 byte hash, a 32-bit big-endian
+    length and the node data, so no per-node Blob is kept while the
+    pack is being built. The writer can be handed directly to
+    SHAMap::getFetchPack as its callback:
+
+    @code
+        FetchPackWriter writer (limitBytes);
+        map.getFetchPack (have, true, max, std::ref (writer));
+        send (writer.data ());
+    @endcode
+
+    Used that way, the result of each call is dropped and the walk goes
+    on after the buffer fills. Nodes refused are not written, and full()
+    tells the caller that the pack is incomplete.
+*/
+class FetchPackWriter
+{
+public:
+    /** Bytes added to every node by the framing. */
+    static std::size_t constexpr overhead = 32 + 4;
+
+    /** Create a writer.
+
+        @param limit The buffer size beyond which nodes are refused,
+                     or zero for no limit.
+    */
+    explicit
+    FetchPackWriter (std::size_t limit = 0);
+
+    /** Append a node.
+
+        @return `false` if the node would exceed the size limit, in
+                which case nothing is written.
+    */
+    bool
+    add (uint256 const& hash, Slice node);
+
+    /** Append a node, as add() does. */
+    bool
+    operator() (SHAMapHash const& hash, Blob const& node)
+    {
+        return add (hash.as_uint256 (), makeSlice (node));
+    }
+
+    /** Returns the number of nodes written. */
+    std::size_t
+    size () const
+    {
+        return count_;
+    }
+
+    /** Returns `true` once a node has been refused for lack of space. */
+    bool
+    full () const
+    {
+        return full_;
+    }
+
+    /** Returns the serialized pack. */
+    Slice
+    data () const
+    {
+        return Slice (buffer_.data (), buffer_.size ());
+    }
+
+    /** Hand over the buffer, leaving the writer empty. */
+    Blob
+    release ();
+
+private:
+    Blob buffer_;
+    std::size_t const limit_;
+    std::size_t count_ = 0;
+    bool full_ = false;
+};
+
+//------------------------------------------------------------------------------
+
+/** Reads a fetch pack in place.
+
+    Parsing only records where each node lies inside the received
+    buffer, which must outlive the reader. Node hashes can then be
+    checked on several threads at once, and verified nodes are handed
+    to the caller as slices of the original buffer for storing.
+*/
+class FetchPackReader
+{
+public:
+    struct Node
+    {
+        uint256 hash;
+        Slice data;
+    };
+
+    FetchPackReader () = default;
+
+    FetchPackReader (FetchPackReader const&) = delete;
+    FetchPackReader& operator= (FetchPackReader const&) = delete;
+
+    /** Parse a pack produced by FetchPackWriter.
+
+        @return `false` if the buffer is not a well formed pack, in
+                which case the reader is left empty.
+    */
+    bool
+    parse (Slice pack);
+
+    /** Check that each node hashes to its stated hash.
+
+        Nodes which do not are removed. The remaining nodes are sorted
+        by hash, with duplicates removed.
+
+        @param threads The number of threads to hash on. The calling
+                       thread is one of them.
+
+        @return The number of nodes removed because their hash did not
+                match their contents.
+    */
+    std::size_t
+    verify (std::size_t threads = 1);
+
+    /** Returns the nodes, in the order they were read or, after
+        verify(), ordered by hash.
+    */
+    std::vector<Node> const&
+    nodes () const
+    {
+        return nodes_;
+    }
+
+    std::size_t
+    size () const
+    {
+        return nodes_.size ();
+    }
+
+    /** Find a node by hash. Requires a prior call to verify().
+
+        @return The node data, or an empty slice if it is absent.
+    */
+    Slice
+    find (uint256 const& hash) const;
+
+    /** Call f(uint256 const& hash, Slice data) for each node. */
+    template <class Function>
+    void
+    forEach (Function&& f) const
+    {
+        for (auto const& n : nodes_)
+            f (n.hash, n.data);
+    }
+
+private:
+    std::vector<Node> nodes_;
+    bool sorted_ = false;
+};
+
+} //
+
+#endif
@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_INLINESHAMAPITEM_H_INCLUDED
+#define MTCHAIN_SHAMAP_INLINESHAMAPITEM_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/SlabAllocator.h>
+#include <mtchain/basics/Slice.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace mtchain {
+
+/** A SHAMap leaf stored as a single allocation.
+
+    The reference count, payload size, key and payload share one block
+    taken from a slab allocator, instead of a shared_ptr control block,
+    a SHAMapItem and a separately allocated Blob. Items are immutable
+    once made and are handled through InlineSHAMapItem::pointer.
+*/
+class InlineSHAMapItem
+{
+public:
+    class pointer;
+
+    /** Create an item holding a copy of the data. */
+    static
+    pointer
+    make (uint256 const& key, Slice data);
+
+    uint256 const&
+    key () const
+    {
+        return key_;
+    }
+
+    std::size_t
+    size () const
+    {
+        return size_;
+    }
+
+    void const*
+    data () const
+    {
+        return this + 1;
+    }
+
+    Slice
+    slice () const
+    {
+        return Slice (data (), size_);
+    }
+
+    /** Returns the number of bytes an item with a payload this large
+        occupies, before rounding by the allocator.
+    */
+    static
+    std::size_t
+    footprint (std::size_t size)
+    {
+        return sizeof(InlineSHAMapItem) + size;
+    }
+
+    /** The allocator shared by all items.
+
+        It is never destroyed, so that items held by other static
+        objects can still be released during shutdown.
+    */
+    static
+    SlabAllocator&
+    allocator ()
+    {
+        static SlabAllocator* const a = new SlabAllocator (512);
+        return *a;
+    }
+
+    InlineSHAMapItem (InlineSHAMapItem const&) = delete;
+    InlineSHAMapItem& operator= (InlineSHAMapItem const&) = delete;
+
+private:
+    InlineSHAMapItem (uint256 const& key, std::uint32_t size)
+        : refs_ (1)
+        , size_ (size)
+        , key_ (key)
+    {
+    }
+
+    void
+    addRef () const
+    {
+        refs_.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void
+    release () const
+    {
+        if (refs_.fetch_sub (1, std::memory_order_acq_rel) == 1)
+        {
+            auto const bytes = footprint (size_);
+            this->~InlineSHAMapItem ();
+            allocator ().deallocate (const_cast<InlineSHAMapItem*> (this),
+                bytes);
+        }
+    }
+
+    mutable std::atomic<std::uint32_t> refs_;
+    std::uint32_t const size_;
+    uint256 const key_;
+};
+
+/** A counted reference to an InlineSHAMapItem. */
+class InlineSHAMapItem::pointer
+{
+public:
+    pointer () = default;
+
+    pointer (pointer const& other)
+        : item_ (other.item_)
+    {
+        if (item_)
+            item_->addRef ();
+    }
+
+    pointer (pointer&& other) noexcept
+        : item_ (other.item_)
+    {
+        other.item_ = nullptr;
+    }
+
+    pointer&
+    operator= (pointer other) noexcept
+    {
+        std::swap (item_, other.item_);
+        return *this;
+    }
+
+    ~pointer ()
+    {
+        if (item_)
+            item_->release ();
+    }
+
+    InlineSHAMapItem const*
+    get () const
+    {
+        return item_;
+    }
+
+    InlineSHAMapItem const&
+    operator* () const
+    {
+        return *item_;
+    }
+
+    InlineSHAMapItem const*
+    operator-> () const
+    {
+        return item_;
+    }
+
+    explicit
+    operator bool () const
+    {
+        return item_ != nullptr;
+    }
+
+private:
+    friend class InlineSHAMapItem;
+
+    explicit
+    pointer (InlineSHAMapItem const* item)
+        : item_ (item)
+    {
+    }
+
+    InlineSHAMapItem const* item_ = nullptr;
+};
+
+inline
+InlineSHAMapItem::pointer
+InlineSHAMapItem::make (uint256 const& key, Slice data)
+{
+    auto const p = allocator ().allocate (footprint (data.size ()));
+    auto const item = new (p) InlineSHAMapItem (
+        key, static_cast<std::uint32_t> (data.size ()));
+    if (! data.empty ())
+        std::memcpy (static_cast<std::uint8_t*> (p) + sizeof(InlineSHAMapItem),
+            data.data (), data.size ());
+    return pointer (item);
+}
+
+} //
+
+#endif
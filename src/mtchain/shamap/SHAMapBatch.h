@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_SHAMAPBATCH_H_INCLUDED
+#define MTCHAIN_SHAMAP_SHAMAPBATCH_H_INCLUDED
+
+#include <mtchain/shamap/SHAMap.h>
+#include <mtchain/basics/Blob.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mtchain {
+
+/** The nodes returned for a batch of getNodeFat requests. */
+struct SHAMapFatReply
+{
+    std::vector<SHAMapNodeID> ids;
+    std::vector<Blob> nodes;
+
+    /** Total size of the node data. */
+    std::size_t bytes = 0;
+
+    /** Requested nodes answered, including those already covered by
+        an earlier node's fat subtree. Missing nodes are not counted.
+    */
+    std::size_t served = 0;
+
+    /** Requested nodes the map does not have. */
+    std::size_t missing = 0;
+
+    /** `true` if the size cap or the time budget ended the batch
+        before every requested node was answered.
+    */
+    bool truncated = false;
+};
+
+/** Answer several node requests with one reply.
+
+    Requests are served shallowest first, so a node which arrives as
+    part of an earlier node's fat subtree is neither fetched nor sent a
+    second time, and duplicate requests are ignored. Serving stops before
+    a node whose subtree would take the reply past `maxBytes`, or once
+    `budget` has elapsed; the reply is then marked truncated and the
+    peer can ask again for the rest.
+
+    @param requested The nodes asked for, in any order.
+    @param fatLeaves Whether leaves are included in fat subtrees.
+    @param depth How many levels below each node to include.
+    @param maxBytes Cap on the node data in the reply, zero for none.
+                    The first node served is sent whole even if its
+                    subtree alone is larger.
+    @param budget Time allowed for the batch, zero for no limit.
+*/
+SHAMapFatReply
+getNodesFat (SHAMap const& map,
+    std::vector<SHAMapNodeID> requested,
+    bool fatLeaves, std::uint32_t depth,
+    std::size_t maxBytes = 0,
+    std::chrono::steady_clock::duration budget = {});
+
+} //
+
+#endif
@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_SHAMAPRANGE_H_INCLUDED
+#define MTCHAIN_SHAMAP_SHAMAPRANGE_H_INCLUDED
+
+#include <mtchain/shamap/SHAMap.h>
+#include <mtchain/basics/base_uint.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace mtchain {
+
+/** An inclusive range of SHAMap keys. */
+struct SHAMapKeyRange
+{
+    uint256 first;
+    uint256 last;
+
+    bool
+    contains (uint256 const& key) const
+    {
+        return ! (key < first) && ! (last < key);
+    }
+};
+
+/** Split the key space into ranges aligned to inner node branches.
+
+    The ranges are contiguous, in key order, and together cover every
+    key. Each one starts and ends on a branch boundary at the shallowest
+    depth with enough branches, so a walk over one range only touches
+    the inner nodes on its own side of that boundary. Because keys are
+    hashes, ranges of equal width hold about the same number of leaves.
+
+    @param count The number of ranges wanted. At most 65536 are
+                 returned, one per branch at depth 4.
+*/
+inline
+std::vector<SHAMapKeyRange>
+partitionSHAMapKeys (std::size_t count)
+{
+    count = std::max<std::size_t> (1, std::min<std::size_t> (count, 65536));
+
+    int depth = 0;
+    std::size_t branches = 1;
+    while (branches < count)
+    {
+        branches *= 16;
+        ++depth;
+    }
+
+    // The first key under a branch, padded with `fill` below it
+    auto const key = [depth](std::size_t branch, std::uint8_t fill)
+    {
+        uint256 k;
+        std::fill (k.begin (), k.end (), fill);
+        for (int i = 0; i < depth; ++i)
+        {
+            auto const nibble = static_cast<std::uint8_t> (
+                (branch >> (4 * (depth - 1 - i))) & 15);
+            auto& byte = *(k.begin () + i / 2);
+            if (i % 2 == 0)
+                byte = (byte & 0x0f) | (nibble << 4);
+            else
+                byte = (byte & 0xf0) | nibble;
+        }
+        return k;
+    };
+
+    std::vector<SHAMapKeyRange> ranges;
+    ranges.reserve (count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const begin = i * branches / count;
+        auto const end = (i + 1) * branches / count;
+        ranges.push_back ({ key (begin, 0), key (end - 1, 0xff) });
+    }
+    return ranges;
+}
+
+/** Visit the leaves of one key range in key order.
+
+    @param marker If set, resume after this key instead of at the start
+                  of the range, as ledger_data does with its marker.
+
+    @param f Called as f(SHAMapItem const&) for each leaf. Returns
+             `false` to stop the walk early.
+
+    @return The key of the last leaf visited if `f` stopped the walk,
+            to be passed back as the marker; otherwise nothing.
+*/
+template <class Function>
+boost::optional<uint256>
+visitLeavesInRange (SHAMap const& map, SHAMapKeyRange const& range,
+    boost::optional<uint256> const& marker, Function&& f)
+{
+    auto it = map.end ();
+    if (marker && ! (*marker < range.first))
+    {
+        // Resume after the marker
+        if (! (*marker < range.last))
+            return boost::none;
+        it = map.upper_bound (*marker);
+    }
+    else if (range.first.isZero ())
+    {
+        it = map.begin ();
+    }
+    else
+    {
+        // Start at the first key itself, which upper_bound would skip
+        uint256 before = range.first;
+        it = map.upper_bound (--before);
+    }
+
+    for (; it != map.end (); ++it)
+    {
+        if (range.last < it->key ())
+            break;
+        if (! f (*it))
+            return it->key ();
+    }
+    return boost::none;
+}
+
+/** Visit every leaf of an immutable map on several threads.
+
+    The key space is split into more ranges than threads and each thread
+    takes the next unvisited range when it finishes one. Within a range
+    leaves are visited in key order; across ranges there is no order.
+
+    If f throws, the remaining ranges are not visited, the others stop
+    at their next leaf, and the first exception is rethrown once all
+    threads have finished.
+
+    @param f Called as f(SHAMapItem const&) from several threads at
+             once; it must be safe to call concurrently.
+*/
+template <class Function>
+void
+visitLeavesParallel (SHAMap const& map, std::size_t threads, Function f)
+{
+    threads = std::max<std::size_t> (1, threads);
+    auto const ranges = partitionSHAMapKeys (threads * 4);
+    std::atomic<std::size_t> next {0};
+    std::atomic<bool> failed {false};
+    std::exception_ptr error;
+
+    auto worker = [&]
+    {
+        for (;;)
+        {
+            auto const i = next++;
+            if (i >= ranges.size () || failed)
+                return;
+            try
+            {
+                visitLeavesInRange (map, ranges[i], boost::none,
+                    [&f, &failed](SHAMapItem const& item)
+                    {
+                        f (item);
+                        return ! failed;
+                    });
+            }
+            catch (...)
+            {
+                if (! failed.exchange (true))
+                    error = std::current_exception ();
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (std::size_t t = 1; t < threads; ++t)
+        workers.emplace_back (worker);
+    worker ();
+    for (auto& w : workers)
+        w.join ();
+
+    if (error)
+        std::rethrow_exception (error);
+}
+
+} //
+
+#endif
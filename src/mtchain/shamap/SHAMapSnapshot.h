@@ -0,0 +1,205 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_SHAMAPSNAPSHOT_H_INCLUDED
+#define MTCHAIN_SHAMAP_SHAMAPSNAPSHOT_H_INCLUDED
+
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/basics/Slice.h>
+#include <mtchain/protocol/digest.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+
+/*  Flat file holding the state map of one ledger.
+
+    All integers are little-endian. The file is laid out as:
+
+        header      128 bytes, see below
+        leaves      per leaf, in ascending key order:
+                        key (32), size (4), data (size)
+        inner       per inner node, in ascending (depth, prefix) order:
+                        depth (1), prefix (32), hash (32)
+        index       per leaf, in key order: offset of its record (8)
+
+    The header holds:
+
+        0   magic "MTCSNAP1"
+        8   format version (4)
+        12  ledger sequence (4)
+        16  root hash (32)
+        48  leaf count (8)
+        56  inner node count (8)
+        64  offset of the inner node table (8)
+        72  offset of the leaf index (8)
+        80  file size (8)
+        88  checksum (32)
+
+    The checksum is the SHA-512Half of every byte after the header
+    followed by the header itself, with the checksum field zeroed.
+
+    Leaves are found by a binary search of the index, inner node hashes
+    by a binary search of the inner node table, so a mapped file can be
+    read at once, without loading or parsing it first.
+*/
+
+/** Writes a state map snapshot.
+
+    Leaves must be added in ascending key order, and all of them before
+    the first inner node. Inner nodes are identified by their depth and
+    the key prefix leading to them, with the bits below the depth zero.
+*/
+class SHAMapSnapshotWriter
+{
+public:
+    SHAMapSnapshotWriter (std::string const& path,
+        std::uint32_t ledgerSeq, uint256 const& rootHash);
+
+    SHAMapSnapshotWriter (SHAMapSnapshotWriter const&) = delete;
+    SHAMapSnapshotWriter& operator= (SHAMapSnapshotWriter const&) = delete;
+
+    void
+    addLeaf (uint256 const& key, Slice data);
+
+    void
+    addInner (int depth, uint256 const& prefix, uint256 const& hash);
+
+    /** Write the index and the header. The file is complete once this
+        returns; a writer destroyed without it leaves an invalid file.
+    */
+    void
+    finish ();
+
+private:
+    void
+    write (void const* data, std::size_t size);
+
+    std::ofstream out_;
+    std::string const path_;
+    std::uint32_t const ledgerSeq_;
+    uint256 const rootHash_;
+    sha512_half_hasher checksum_;
+    std::uint64_t offset_;
+    std::vector<std::uint64_t> index_;
+    std::uint64_t innerCount_ = 0;
+    std::uint64_t innerOffset_ = 0;
+    uint256 lastKey_;
+    int lastDepth_ = -1;
+    uint256 lastPrefix_;
+    bool finished_ = false;
+};
+
+//------------------------------------------------------------------------------
+
+/** A read-only, memory mapped state map snapshot.
+
+    Construction maps the file and checks its header but does not read
+    the rest, so lookups are possible immediately. The checksum over the
+    whole file can be checked separately with verify(), for example on a
+    background thread while the snapshot is already serving reads.
+*/
+class SHAMapSnapshot
+{
+public:
+    struct Leaf
+    {
+        uint256 key;
+        Slice data;
+    };
+
+    /** Map a snapshot.
+
+        @throws std::runtime_error if the file cannot be mapped or its
+                header does not describe a well formed snapshot.
+    */
+    explicit
+    SHAMapSnapshot (std::string const& path);
+
+    SHAMapSnapshot (SHAMapSnapshot const&) = delete;
+    SHAMapSnapshot& operator= (SHAMapSnapshot const&) = delete;
+
+    std::uint32_t
+    ledgerSeq () const
+    {
+        return ledgerSeq_;
+    }
+
+    uint256 const&
+    rootHash () const
+    {
+        return rootHash_;
+    }
+
+    std::size_t
+    leafCount () const
+    {
+        return leafCount_;
+    }
+
+    std::size_t
+    innerCount () const
+    {
+        return innerCount_;
+    }
+
+    /** Returns `true` if the file matches its checksum. */
+    bool
+    verify () const;
+
+    /** Returns the leaf at a position in key order. */
+    Leaf
+    leaf (std::size_t i) const;
+
+    boost::optional<Slice>
+    findLeaf (uint256 const& key) const;
+
+    boost::optional<uint256>
+    findInner (int depth, uint256 const& prefix) const;
+
+    /** Call f(uint256 const& key, Slice data) for each leaf, in order. */
+    template <class Function>
+    void
+    forEachLeaf (Function&& f) const
+    {
+        for (std::size_t i = 0; i < leafCount_; ++i)
+        {
+            auto const l = leaf (i);
+            f (l.key, l.data);
+        }
+    }
+
+private:
+    std::uint8_t const*
+    at (std::uint64_t offset) const
+    {
+        return base_ + offset;
+    }
+
+    boost::interprocess::file_mapping file_;
+    boost::interprocess::mapped_region region_;
+    std::uint8_t const* base_;
+    std::uint64_t size_;
+    std::uint32_t ledgerSeq_;
+    uint256 rootHash_;
+    std::uint64_t leafCount_;
+    std::uint64_t innerCount_;
+    std::uint64_t innerOffset_;
+    std::uint64_t indexOffset_;
+};
+
+} //
+
+#endif
@@ -0,0 +1,342 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#ifndef MTCHAIN_SHAMAP_SPARSEBRANCHARRAY_H_INCLUDED
+#define MTCHAIN_SHAMAP_SPARSEBRANCHARRAY_H_INCLUDED
+
+#include <mtchain/basics/contract.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace mtchain {
+
+/** Child hashes and pointers of an inner node, stored compactly.
+
+    Most inner nodes below the top few levels of a state or transaction
+    tree have only a handful of their 16 branches populated. Rather than
+    always carrying 16 hashes and 16 pointers, this container keeps a
+    16-bit bitmap of the populated branches and stores only those, in
+    branch order, in an array sized to one of a few capacity classes.
+    When a branch is added to a full array it is reallocated to the next
+    class; once more than the largest sparse class is needed the array
+    is promoted to the full 16-entry layout, where a branch is its own
+    index and no bitmap arithmetic is required. Arrays only shrink once
+    two more branches would still fit in the smaller class (the full
+    layout is kept down to 5 branches), so a node whose branch count
+    moves back and forth across a class boundary is not reallocated on
+    every change.
+
+    Empty branches read back as a default constructed (zero) hash and a
+    null child, so callers which hash all 16 branches in order produce
+    exactly the same result with either layout.
+
+    @tparam Hash  The child hash type; default construction yields zero.
+    @tparam Child The child pointer type; default construction yields null.
+*/
+template <class Hash, class Child>
+class SparseBranchArray
+{
+public:
+    static int constexpr branchFactor = 16;
+
+private:
+    struct Entry
+    {
+        Hash hash;
+        Child child;
+    };
+
+    // Capacity classes; the last one is the full layout
+    static std::uint8_t constexpr classes[] = { 2, 4, 6, branchFactor };
+
+    std::unique_ptr<Entry[]> entries_;
+    std::uint16_t isBranch_ = 0;
+    std::uint8_t capacity_ = 0;
+
+    static
+    int
+    popcount16 (std::uint16_t v)
+    {
+        v = v - ((v >> 1) & 0x5555);
+        v = (v & 0x3333) + ((v >> 2) & 0x3333);
+        v = (v + (v >> 4)) & 0x0F0F;
+        return (v + (v >> 8)) & 0x1F;
+    }
+
+    static
+    std::uint8_t
+    capacityFor (int count)
+    {
+        if (count == 0)
+            return 0;
+        for (auto c : classes)
+            if (count <= c)
+                return c;
+        return branchFactor;
+    }
+
+    // Branches a shrunk array must still have room for
+    static int constexpr shrinkSlack = 2;
+
+    static
+    void
+    checkBranch (int branch)
+    {
+        if (branch < 0 || branch >= branchFactor)
+            Throw<std::out_of_range> ("SparseBranchArray: bad branch");
+    }
+
+    // Position of a branch in the entry array for the current layout
+    int
+    index (int branch) const
+    {
+        if (isDense ())
+            return branch;
+        return popcount16 (isBranch_ & ((1u << branch) - 1));
+    }
+
+    // Move the populated branches into an array of a new capacity
+    void
+    resize (std::uint8_t capacity)
+    {
+        if (capacity == capacity_)
+            return;
+
+        std::unique_ptr<Entry[]> entries;
+        if (capacity != 0)
+            entries.reset (new Entry[capacity]);
+
+        bool const toDense = (capacity == branchFactor);
+        int from = 0;
+        int to = 0;
+        for (int b = 0; b < branchFactor; ++b)
+        {
+            if (! (isBranch_ & (1u << b)))
+                continue;
+            from = isDense () ? b : from;
+            to = toDense ? b : to;
+            entries[to] = std::move (entries_[from]);
+            ++from;
+            ++to;
+        }
+
+        entries_ = std::move (entries);
+        capacity_ = capacity;
+    }
+
+public:
+    SparseBranchArray () = default;
+    SparseBranchArray (SparseBranchArray&&) = default;
+    SparseBranchArray& operator= (SparseBranchArray&&) = default;
+
+    SparseBranchArray (SparseBranchArray const& other)
+        : isBranch_ (other.isBranch_)
+        , capacity_ (other.capacity_)
+    {
+        if (capacity_ != 0)
+        {
+            entries_.reset (new Entry[capacity_]);
+            for (int i = 0; i < capacity_; ++i)
+                entries_[i] = other.entries_[i];
+        }
+    }
+
+    SparseBranchArray&
+    operator= (SparseBranchArray const& other)
+    {
+        if (this != &other)
+        {
+            SparseBranchArray tmp (other);
+            *this = std::move (tmp);
+        }
+        return *this;
+    }
+
+    /** Returns `true` if the full 16-entry layout is in use. */
+    bool
+    isDense () const
+    {
+        return capacity_ == branchFactor;
+    }
+
+    /** Returns the bitmap of populated branches. */
+    std::uint16_t
+    branches () const
+    {
+        return isBranch_;
+    }
+
+    /** Returns the number of populated branches. */
+    int
+    count () const
+    {
+        return popcount16 (isBranch_);
+    }
+
+    bool
+    empty () const
+    {
+        return isBranch_ == 0;
+    }
+
+    bool
+    isEmptyBranch (int branch) const
+    {
+        return (isBranch_ & (1u << branch)) == 0;
+    }
+
+    /** Returns the hash of a branch, or a zero hash if it is empty. */
+    Hash const&
+    hash (int branch) const
+    {
+        static Hash const zero{};
+        if (isEmptyBranch (branch))
+            return zero;
+        return entries_[index (branch)].hash;
+    }
+
+    /** Returns the child of a branch, or a null child if it is empty. */
+    Child const&
+    child (int branch) const
+    {
+        static Child const none{};
+        if (isEmptyBranch (branch))
+            return none;
+        return entries_[index (branch)].child;
+    }
+
+    /** Populate (or replace) a branch.
+
+        The array grows to the next capacity class if necessary.
+    */
+    void
+    set (int branch, Hash const& hash, Child child = Child{})
+    {
+        checkBranch (branch);
+
+        if (isEmptyBranch (branch))
+        {
+            auto const capacity = capacityFor (count () + 1);
+            if (capacity > capacity_)
+                resize (capacity);
+
+            if (! isDense ())
+            {
+                // Open a slot at this branch's position
+                int const pos = index (branch);
+                for (int i = count (); i > pos; --i)
+                    entries_[i] = std::move (entries_[i - 1]);
+            }
+
+            isBranch_ |= (1u << branch);
+        }
+
+        auto& e = entries_[index (branch)];
+        e.hash = hash;
+        e.child = std::move (child);
+    }
+
+    /** Update the child of a populated branch, keeping its hash. */
+    void
+    setChild (int branch, Child child)
+    {
+        checkBranch (branch);
+        if (isEmptyBranch (branch))
+            Throw<std::logic_error> ("SparseBranchArray: empty branch");
+        entries_[index (branch)].child = std::move (child);
+    }
+
+    /** Empty a branch.
+
+        The array shrinks to a smaller capacity class once it fits with
+        room to spare, and is freed when the last branch is cleared.
+    */
+    void
+    clear (int branch)
+    {
+        checkBranch (branch);
+
+        if (isEmptyBranch (branch))
+            return;
+
+        int const pos = index (branch);
+
+        if (isDense ())
+        {
+            entries_[pos] = Entry{};
+        }
+        else
+        {
+            int const n = count ();
+            for (int i = pos; i + 1 < n; ++i)
+                entries_[i] = std::move (entries_[i + 1]);
+            entries_[n - 1] = Entry{};
+        }
+
+        isBranch_ &= ~(1u << branch);
+
+        auto const n = count ();
+        auto const capacity = (n == 0) ? 0 : capacityFor (n + shrinkSlack);
+        if (capacity < capacity_)
+            resize (capacity);
+    }
+
+    /** Call `f (branch, hash, child)` for each populated branch, in order. */
+    template <class Function>
+    void
+    forEach (Function&& f) const
+    {
+        int i = 0;
+        for (int b = 0; b < branchFactor; ++b)
+        {
+            if (isEmptyBranch (b))
+                continue;
+            auto const& e = entries_[isDense () ? b : i++];
+            f (b, e.hash, e.child);
+        }
+    }
+
+    /** Call `f (hash)` for all 16 branches, in order.
+
+        Empty branches are presented as a zero hash, which is what
+        inner node serialization and hashing expect.
+    */
+    template <class Function>
+    void
+    forEachHash (Function&& f) const
+    {
+        for (int b = 0; b < branchFactor; ++b)
+            f (hash (b));
+    }
+
+    /** Returns the number of entries allocated. */
+    std::size_t
+    capacity () const
+    {
+        return capacity_;
+    }
+
+    /** Returns the bytes of heap storage held for branch entries. */
+    std::size_t
+    bytes () const
+    {
+        return capacity_ * sizeof(Entry);
+    }
+};
+
+template <class Hash, class Child>
+std::uint8_t constexpr SparseBranchArray<Hash, Child>::classes[];
+
+} //
+
+#endif
@@ -0,0 +1,194 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/FetchPackStream.h>
+#include <mtchain/protocol/digest_batch.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+namespace mtchain {
+
+FetchPackWriter::FetchPackWriter (std::size_t limit)
+    : limit_ (limit)
+{
+}
+
+bool
+FetchPackWriter::add (uint256 const& hash, Slice node)
+{
+    auto const needed = overhead + node.size ();
+
+    if (limit_ != 0 && buffer_.size () + needed > limit_)
+    {
+        full_ = true;
+        return false;
+    }
+
+    auto const offset = buffer_.size ();
+    buffer_.resize (offset + needed);
+    auto p = buffer_.data () + offset;
+
+    std::memcpy (p, hash.data (), 32);
+    p += 32;
+
+    auto const size = static_cast<std::uint32_t> (node.size ());
+    *p++ = static_cast<std::uint8_t> (size >> 24);
+    *p++ = static_cast<std::uint8_t> (size >> 16);
+    *p++ = static_cast<std::uint8_t> (size >> 8);
+    *p++ = static_cast<std::uint8_t> (size);
+
+    if (! node.empty ())
+        std::memcpy (p, node.data (), node.size ());
+
+    ++count_;
+    return true;
+}
+
+Blob
+FetchPackWriter::release ()
+{
+    Blob result;
+    result.swap (buffer_);
+    count_ = 0;
+    full_ = false;
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+bool
+FetchPackReader::parse (Slice pack)
+{
+    nodes_.clear ();
+    sorted_ = false;
+
+    auto p = pack.data ();
+    auto remaining = pack.size ();
+
+    while (remaining != 0)
+    {
+        if (remaining < FetchPackWriter::overhead)
+        {
+            nodes_.clear ();
+            return false;
+        }
+
+        Node n;
+        std::memcpy (n.hash.data (), p, 32);
+        p += 32;
+
+        std::size_t const size =
+            (std::size_t (p[0]) << 24) | (std::size_t (p[1]) << 16) |
+            (std::size_t (p[2]) << 8) | std::size_t (p[3]);
+        p += 4;
+        remaining -= FetchPackWriter::overhead;
+
+        if (size > remaining)
+        {
+            nodes_.clear ();
+            return false;
+        }
+
+        n.data = Slice (p, size);
+        p += size;
+        remaining -= size;
+
+        nodes_.push_back (n);
+    }
+
+    return true;
+}
+
+std::size_t
+FetchPackReader::verify (std::size_t threads)
+{
+    std::vector<char> bad (nodes_.size (), 0);
+
+    // Hash a contiguous range of nodes a batch at a time
+    auto check = [this, &bad](std::size_t first, std::size_t last)
+    {
+        std::size_t constexpr batch = 64;
+        Slice messages[batch];
+        uint256 digests[batch];
+
+        while (first != last)
+        {
+            auto const n = std::min (batch, last - first);
+            for (std::size_t i = 0; i < n; ++i)
+                messages[i] = nodes_[first + i].data;
+            sha512Half_batch (messages, digests, n);
+            for (std::size_t i = 0; i < n; ++i)
+                bad[first + i] = (digests[i] != nodes_[first + i].hash);
+            first += n;
+        }
+    };
+
+    threads = std::max<std::size_t> (1,
+        std::min (threads, nodes_.size () / 256));
+    std::size_t const chunk = (nodes_.size () + threads - 1) / threads;
+
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (std::size_t t = 1; t < threads; ++t)
+    {
+        auto const first = std::min (t * chunk, nodes_.size ());
+        auto const last = std::min (first + chunk, nodes_.size ());
+        workers.emplace_back (check, first, last);
+    }
+    check (0, std::min (chunk, nodes_.size ()));
+    for (auto& w : workers)
+        w.join ();
+
+    std::size_t removed = 0;
+    std::size_t out = 0;
+    for (std::size_t i = 0; i < nodes_.size (); ++i)
+    {
+        if (bad[i])
+            ++removed;
+        else
+            nodes_[out++] = nodes_[i];
+    }
+    nodes_.resize (out);
+
+    std::stable_sort (nodes_.begin (), nodes_.end (),
+        [](Node const& a, Node const& b)
+        {
+            return a.hash < b.hash;
+        });
+    nodes_.erase (std::unique (nodes_.begin (), nodes_.end (),
+        [](Node const& a, Node const& b)
+        {
+            return a.hash == b.hash;
+        }), nodes_.end ());
+    sorted_ = true;
+
+    return removed;
+}
+
+Slice
+FetchPackReader::find (uint256 const& hash) const
+{
+    assert (sorted_);
+
+    auto const it = std::lower_bound (nodes_.begin (), nodes_.end (), hash,
+        [](Node const& n, uint256 const& h)
+        {
+            return n.hash < h;
+        });
+
+    if (it == nodes_.end () || it->hash != hash)
+        return Slice ();
+    return it->data;
+}
+
+} //
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMapBatch.h>
+#include <algorithm>
+#include <set>
+
+namespace mtchain {
+
+SHAMapFatReply
+getNodesFat (SHAMap const& map,
+    std::vector<SHAMapNodeID> requested,
+    bool fatLeaves, std::uint32_t depth,
+    std::size_t maxBytes,
+    std::chrono::steady_clock::duration budget)
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // Parents sort before their descendants
+    std::sort (requested.begin (), requested.end ());
+    requested.erase (std::unique (requested.begin (), requested.end ()),
+        requested.end ());
+
+    auto const deadline = clock_type::now () + budget;
+
+    SHAMapFatReply reply;
+    std::set<SHAMapNodeID> sent;
+    std::vector<SHAMapNodeID> ids;
+    std::vector<Blob> nodes;
+
+    for (auto const& id : requested)
+    {
+        if (reply.served + reply.missing != 0 &&
+            budget != clock_type::duration::zero () &&
+                clock_type::now () >= deadline)
+        {
+            reply.truncated = true;
+            break;
+        }
+
+        if (sent.count (id) != 0)
+        {
+            ++reply.served;
+            continue;
+        }
+
+        ids.clear ();
+        nodes.clear ();
+        if (! map.getNodeFat (id, ids, nodes, fatLeaves, depth))
+        {
+            ++reply.missing;
+            continue;
+        }
+
+        // Only what the peer has not been sent yet counts
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < ids.size (); ++i)
+        {
+            if (sent.count (ids[i]) == 0)
+                bytes += nodes[i].size ();
+        }
+        if (maxBytes != 0 && ! reply.nodes.empty () &&
+            reply.bytes + bytes > maxBytes)
+        {
+            reply.truncated = true;
+            break;
+        }
+
+        ++reply.served;
+        for (std::size_t i = 0; i < ids.size (); ++i)
+        {
+            if (! sent.insert (ids[i]).second)
+                continue;
+            reply.bytes += nodes[i].size ();
+            reply.ids.push_back (ids[i]);
+            reply.nodes.push_back (std::move (nodes[i]));
+        }
+    }
+
+    return reply;
+}
+
+} //
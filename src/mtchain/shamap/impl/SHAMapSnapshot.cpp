@@ -0,0 +1,310 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMapSnapshot.h>
+#include <mtchain/basics/contract.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mtchain {
+
+namespace {
+
+char const magic[8] = { 'M', 'T', 'C', 'S', 'N', 'A', 'P', '1' };
+
+std::uint32_t constexpr formatVersion = 2;
+std::size_t constexpr headerSize = 128;
+std::size_t constexpr leafHeaderSize = 32 + 4;
+std::size_t constexpr innerSize = 1 + 32 + 32;
+std::size_t constexpr checksumOffset = 88;
+
+template <class Integer>
+void
+store (std::uint8_t* p, Integer v)
+{
+    for (std::size_t i = 0; i < sizeof(Integer); ++i)
+        p[i] = static_cast<std::uint8_t> (v >> (8 * i));
+}
+
+template <class Integer>
+Integer
+load (std::uint8_t const* p)
+{
+    Integer v = 0;
+    for (std::size_t i = 0; i < sizeof(Integer); ++i)
+        v |= static_cast<Integer> (p[i]) << (8 * i);
+    return v;
+}
+
+// Adds the header to the checksum, which covers the body first. The
+// checksum field itself is hashed as zeros.
+void
+hashHeader (sha512_half_hasher& h, std::uint8_t const* header)
+{
+    std::uint8_t copy[headerSize];
+    std::memcpy (copy, header, headerSize);
+    std::memset (copy + checksumOffset, 0, 32);
+    h (copy, headerSize);
+}
+
+// Orders inner nodes by depth, then prefix
+int
+compareInner (int depthA, std::uint8_t const* prefixA,
+    int depthB, std::uint8_t const* prefixB)
+{
+    if (depthA != depthB)
+        return depthA < depthB ? -1 : 1;
+    return std::memcmp (prefixA, prefixB, 32);
+}
+
+}
+
+SHAMapSnapshotWriter::SHAMapSnapshotWriter (std::string const& path,
+        std::uint32_t ledgerSeq, uint256 const& rootHash)
+    : out_ (path, std::ios::binary | std::ios::trunc)
+    , path_ (path)
+    , ledgerSeq_ (ledgerSeq)
+    , rootHash_ (rootHash)
+    , offset_ (headerSize)
+{
+    if (! out_)
+        Throw<std::runtime_error> ("Unable to create snapshot " + path);
+
+    // Reserve room for the header, written by finish()
+    char const zeros[headerSize] = {};
+    out_.write (zeros, headerSize);
+}
+
+void
+SHAMapSnapshotWriter::write (void const* data, std::size_t size)
+{
+    out_.write (static_cast<char const*> (data), size);
+    if (! out_)
+        Throw<std::runtime_error> ("Unable to write snapshot " + path_);
+    checksum_ (data, size);
+    offset_ += size;
+}
+
+void
+SHAMapSnapshotWriter::addLeaf (uint256 const& key, Slice data)
+{
+    if (finished_ || innerCount_ != 0)
+        Throw<std::logic_error> (
+            "SHAMapSnapshotWriter: leaf added after inner nodes");
+    if (! index_.empty () && ! (lastKey_ < key))
+        Throw<std::logic_error> (
+            "SHAMapSnapshotWriter: leaves out of order");
+
+    index_.push_back (offset_);
+    lastKey_ = key;
+
+    std::uint8_t header[leafHeaderSize];
+    std::memcpy (header, key.data (), 32);
+    store (header + 32, static_cast<std::uint32_t> (data.size ()));
+    write (header, sizeof(header));
+    if (! data.empty ())
+        write (data.data (), data.size ());
+}
+
+void
+SHAMapSnapshotWriter::addInner (
+    int depth, uint256 const& prefix, uint256 const& hash)
+{
+    if (finished_)
+        Throw<std::logic_error> (
+            "SHAMapSnapshotWriter: inner node added after finish");
+    if (depth < 0 || depth > 64)
+        Throw<std::out_of_range> ("SHAMapSnapshotWriter: bad depth");
+    if (innerCount_ != 0 && compareInner (lastDepth_, lastPrefix_.data (),
+            depth, prefix.data ()) >= 0)
+        Throw<std::logic_error> (
+            "SHAMapSnapshotWriter: inner nodes out of order");
+
+    if (innerCount_ == 0)
+        innerOffset_ = offset_;
+    ++innerCount_;
+    lastDepth_ = depth;
+    lastPrefix_ = prefix;
+
+    std::uint8_t record[innerSize];
+    record[0] = static_cast<std::uint8_t> (depth);
+    std::memcpy (record + 1, prefix.data (), 32);
+    std::memcpy (record + 33, hash.data (), 32);
+    write (record, sizeof(record));
+}
+
+void
+SHAMapSnapshotWriter::finish ()
+{
+    if (finished_)
+        Throw<std::logic_error> (
+            "SHAMapSnapshotWriter: finished twice");
+    finished_ = true;
+
+    if (innerCount_ == 0)
+        innerOffset_ = offset_;
+
+    auto const indexOffset = offset_;
+    for (auto const offset : index_)
+    {
+        std::uint8_t buf[8];
+        store (buf, offset);
+        write (buf, sizeof(buf));
+    }
+
+    std::uint8_t header[headerSize] = {};
+    std::memcpy (header, magic, sizeof(magic));
+    store (header + 8, formatVersion);
+    store (header + 12, ledgerSeq_);
+    std::memcpy (header + 16, rootHash_.data (), 32);
+    store (header + 48, static_cast<std::uint64_t> (index_.size ()));
+    store (header + 56, innerCount_);
+    store (header + 64, innerOffset_);
+    store (header + 72, indexOffset);
+    store (header + 80, offset_);
+    hashHeader (checksum_, header);
+    auto const sum = static_cast<uint256> (checksum_);
+    std::memcpy (header + checksumOffset, sum.data (), 32);
+
+    out_.seekp (0);
+    out_.write (reinterpret_cast<char const*> (header), headerSize);
+    out_.close ();
+    if (! out_)
+        Throw<std::runtime_error> ("Unable to write snapshot " + path_);
+}
+
+//------------------------------------------------------------------------------
+
+SHAMapSnapshot::SHAMapSnapshot (std::string const& path)
+{
+    using namespace boost::interprocess;
+
+    try
+    {
+        file_ = file_mapping (path.c_str (), read_only);
+        region_ = mapped_region (file_, read_only);
+    }
+    catch (interprocess_exception const& e)
+    {
+        Throw<std::runtime_error> (
+            "Unable to map snapshot " + path + ": " + e.what ());
+    }
+
+    base_ = static_cast<std::uint8_t const*> (region_.get_address ());
+    size_ = region_.get_size ();
+
+    auto bad = [&path](char const* why)
+    {
+        Throw<std::runtime_error> (
+            "Malformed snapshot " + path + ": " + why);
+    };
+
+    if (size_ < headerSize || std::memcmp (base_, magic, sizeof(magic)) != 0)
+        bad ("no header");
+    if (load<std::uint32_t> (at (8)) != formatVersion)
+        bad ("unknown version");
+
+    ledgerSeq_ = load<std::uint32_t> (at (12));
+    std::memcpy (rootHash_.data (), at (16), 32);
+    leafCount_ = load<std::uint64_t> (at (48));
+    innerCount_ = load<std::uint64_t> (at (56));
+    innerOffset_ = load<std::uint64_t> (at (64));
+    indexOffset_ = load<std::uint64_t> (at (72));
+
+    if (load<std::uint64_t> (at (80)) != size_)
+        bad ("truncated");
+    if (innerOffset_ < headerSize || indexOffset_ < innerOffset_ ||
+            indexOffset_ > size_)
+        bad ("bad offsets");
+    if (leafCount_ > (size_ - indexOffset_) / 8 ||
+            indexOffset_ + leafCount_ * 8 != size_)
+        bad ("bad leaf index");
+    if (innerCount_ > (indexOffset_ - innerOffset_) / innerSize ||
+            innerOffset_ + innerCount_ * innerSize != indexOffset_)
+        bad ("bad inner node table");
+}
+
+bool
+SHAMapSnapshot::verify () const
+{
+    sha512_half_hasher h;
+    h (at (headerSize), size_ - headerSize);
+    hashHeader (h, base_);
+    auto const sum = static_cast<uint256> (h);
+    return std::memcmp (sum.data (), at (checksumOffset), 32) == 0;
+}
+
+SHAMapSnapshot::Leaf
+SHAMapSnapshot::leaf (std::size_t i) const
+{
+    if (i >= leafCount_)
+        Throw<std::out_of_range> ("SHAMapSnapshot: bad leaf");
+
+    auto const offset = load<std::uint64_t> (at (indexOffset_ + i * 8));
+    if (offset < headerSize || offset > innerOffset_ - leafHeaderSize)
+        Throw<std::runtime_error> ("SHAMapSnapshot: bad leaf offset");
+
+    auto const size = load<std::uint32_t> (at (offset + 32));
+    if (size > innerOffset_ - leafHeaderSize - offset)
+        Throw<std::runtime_error> ("SHAMapSnapshot: bad leaf size");
+
+    Leaf result;
+    std::memcpy (result.key.data (), at (offset), 32);
+    result.data = Slice (at (offset + leafHeaderSize), size);
+    return result;
+}
+
+boost::optional<Slice>
+SHAMapSnapshot::findLeaf (uint256 const& key) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = leafCount_;
+    while (lo < hi)
+    {
+        auto const mid = lo + (hi - lo) / 2;
+        auto const l = leaf (mid);
+        if (l.key == key)
+            return l.data;
+        if (l.key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return boost::none;
+}
+
+boost::optional<uint256>
+SHAMapSnapshot::findInner (int depth, uint256 const& prefix) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = innerCount_;
+    while (lo < hi)
+    {
+        auto const mid = lo + (hi - lo) / 2;
+        auto const record = at (innerOffset_ + mid * innerSize);
+        auto const c = compareInner (record[0], record + 1,
+            depth, prefix.data ());
+        if (c == 0)
+        {
+            uint256 hash;
+            std::memcpy (hash.data (), record + 33, 32);
+            return hash;
+        }
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return boost::none;
+}
+
+} //
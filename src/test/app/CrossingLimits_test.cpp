@@ -9,6 +9,7 @@
 #include <BeastConfig.h>
 #include <test/jtx.h>
 #include <mtchain/beast/unit_test.h>
+#include <chrono>
 
 namespace mtchain {
 namespace test {
@@ -149,5 +150,60 @@ public:
 
 BEAST_DEFINE_TESTSUITE_MANUAL(CrossingLimits,tx,mtchain);
 
+// Measures what crossing costs per offer consumed, in long books
+class CrossingCost_test : public beast::unit_test::suite
+{
+public:
+    void
+    run()
+    {
+        using namespace jtx;
+        using clock_type = std::chrono::steady_clock;
+        using namespace std::chrono;
+
+        Env env(*this);
+        auto const gw = Account("gateway");
+        auto const USD = gw["USD"];
+
+        env.fund(M(100000000), gw, "alice", "bob", "carol", "dan", "evita");
+        for (auto const maker : { "bob", "carol", "dan" })
+        {
+            env.trust(USD(1000), maker);
+            env(pay(gw, maker, USD(400)));
+            for (int i = 0; i < 400; ++i)
+                env(offer(maker, M(1), USD(1)));
+        }
+        env.close();
+
+        // An offer which crosses nothing, to separate the fixed cost
+        auto start = clock_type::now();
+        env(offer("alice", USD(1000), M(1)));
+        auto const fixed = duration_cast<microseconds>(
+            clock_type::now() - start).count();
+
+        // Two takers consume all 1200 offers, each staying below
+        // the crossing limit.
+        std::size_t crossed = 0;
+        std::int64_t total = 0;
+        for (auto const taker : { "alice", "evita" })
+        {
+            start = clock_type::now();
+            env(offer(taker, USD(600), M(600)));
+            total += duration_cast<microseconds>(
+                clock_type::now() - start).count();
+            crossed += 600;
+        }
+        env.require (owners ("bob", 1), owners ("carol", 1),
+            owners ("dan", 1));
+
+        log << crossed << " offers crossed in " << total << "us, " <<
+            "fixed cost " << fixed << "us per transaction, " <<
+            (total - 2 * fixed) / static_cast<std::int64_t>(crossed) <<
+            "us per offer" << std::endl;
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(CrossingCost,tx,mtchain);
+
 } // test
 } //
@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/app/paths/LineCacheRegistry.h>
+#include <mtchain/app/paths/ParallelPathSearch.h>
+#include <mtchain/basics/contract.h>
+#include <mtchain/beast/unit_test.h>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace mtchain {
+namespace test {
+
+class ParallelPathSearch_test : public beast::unit_test::suite
+{
+    static
+    uint256
+    ledger (int i)
+    {
+        uint256 k;
+        k.zero ();
+        *k.begin () = static_cast<std::uint8_t> (i);
+        return k;
+    }
+
+    void
+    testSearch ()
+    {
+        testcase ("search");
+
+        using namespace std::chrono_literals;
+
+        // One search per source currency, each finding its own "paths"
+        SearchDeadline const deadline (10s);
+        auto const results = searchInParallel<std::string> (6, 3, deadline,
+            [](std::size_t i, SearchDeadline const&)
+            {
+                return "paths for currency " + std::to_string (i);
+            });
+
+        BEAST_EXPECT(results.size () == 6);
+        for (std::size_t i = 0; i < results.size (); ++i)
+            BEAST_EXPECT(results[i] &&
+                *results[i] == "paths for currency " + std::to_string (i));
+
+        BEAST_EXPECT(searchInParallel<int> (0, 4, deadline,
+            [](std::size_t, SearchDeadline const&) { return 0; }).empty ());
+    }
+
+    void
+    testDeadline ()
+    {
+        testcase ("deadline");
+
+        using namespace std::chrono_literals;
+
+        // Searches stop at the deadline with the best found so far
+        {
+            SearchDeadline const deadline (20ms);
+            auto const results = searchInParallel<int> (2, 2, deadline,
+                [](std::size_t, SearchDeadline const& d)
+                {
+                    int best = 0;
+                    while (! d.expired ())
+                    {
+                        ++best;
+                        std::this_thread::sleep_for (1ms);
+                    }
+                    return best;
+                });
+            BEAST_EXPECT(results[0] && *results[0] > 0);
+            BEAST_EXPECT(results[1] && *results[1] > 0);
+        }
+
+        // Searches not started by the deadline are skipped
+        {
+            SearchDeadline deadline (10s);
+            std::atomic<int> ran {0};
+            auto const results = searchInParallel<int> (5, 1, deadline,
+                [&](std::size_t i, SearchDeadline const&)
+                {
+                    ++ran;
+                    if (i == 1)
+                        deadline.cancel ();
+                    return static_cast<int> (i);
+                });
+            BEAST_EXPECT(ran == 2);
+            BEAST_EXPECT(results[0] && results[1]);
+            BEAST_EXPECT(! results[2] && ! results[4]);
+        }
+    }
+
+    void
+    testException ()
+    {
+        testcase ("exception");
+
+        using namespace std::chrono_literals;
+
+        SearchDeadline const deadline (10s);
+        try
+        {
+            searchInParallel<int> (10, 3, deadline,
+                [](std::size_t i, SearchDeadline const&) -> int
+                {
+                    if (i == 4)
+                        Throw<std::runtime_error> ("search failed");
+                    return 0;
+                });
+            fail ("no exception");
+        }
+        catch (std::runtime_error const& e)
+        {
+            BEAST_EXPECT(std::string (e.what ()) == "search failed");
+        }
+    }
+
+    void
+    testLineCache ()
+    {
+        testcase ("line cache");
+
+        struct Lines
+        {
+            int ledger;
+        };
+
+        LineCacheRegistry<Lines> registry;
+        auto make = [](int i)
+        {
+            return [i] { return std::make_shared<Lines> (Lines { i }); };
+        };
+
+        auto a = registry.get (ledger (1), make (1));
+        auto b = registry.get (ledger (1), make (1));
+        auto c = registry.get (ledger (2), make (2));
+        BEAST_EXPECT(a == b);
+        BEAST_EXPECT(a != c && c->ledger == 2);
+        BEAST_EXPECT(registry.created () == 2);
+        BEAST_EXPECT(registry.shared () == 1);
+
+        // Once no request uses it, a new one is made
+        a.reset ();
+        b.reset ();
+        auto d = registry.get (ledger (1), make (1));
+        BEAST_EXPECT(d->ledger == 1);
+        BEAST_EXPECT(registry.created () == 3);
+
+        // Concurrent requests on one ledger share one cache
+        std::vector<std::shared_ptr<Lines>> got (8);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < got.size (); ++i)
+            threads.emplace_back ([&, i]
+            {
+                got[i] = registry.get (ledger (3), make (3));
+            });
+        for (auto& t : threads)
+            t.join ();
+        BEAST_EXPECT(std::all_of (got.begin (), got.end (),
+            [&got](std::shared_ptr<Lines> const& p)
+            {
+                return p == got.front ();
+            }));
+        BEAST_EXPECT(registry.created () == 4);
+    }
+
+public:
+    void
+    run ()
+    {
+        testSearch ();
+        testDeadline ();
+        testException ();
+        testLineCache ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ParallelPathSearch,app,mtchain);
+
+} // test
+} //
@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/app/paths/PathRequestTracker.h>
+#include <mtchain/beast/unit_test.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+namespace test {
+
+class PathRequestTracker_test : public beast::unit_test::suite
+{
+    using Tracker = PathRequestTracker<int, std::string>;
+
+    static
+    uint256
+    key (int i)
+    {
+        uint256 k;
+        k.zero ();
+        *k.begin () = static_cast<std::uint8_t> (i >> 8);
+        *(k.begin () + 1) = static_cast<std::uint8_t> (i);
+        return k;
+    }
+
+    // A directory of book i, at some quality
+    static
+    uint256
+    dir (int i, std::uint64_t quality)
+    {
+        auto k = key (i);
+        for (int b = 0; b < 8; ++b)
+            *(k.end () - 1 - b) =
+                static_cast<std::uint8_t> (quality >> (8 * b));
+        return k;
+    }
+
+    static
+    std::vector<uint256>
+    keys (std::initializer_list<int> ids)
+    {
+        std::vector<uint256> result;
+        for (auto i : ids)
+            result.push_back (key (i));
+        return result;
+    }
+
+    static
+    std::vector<int>
+    sorted (std::vector<int> v)
+    {
+        std::sort (v.begin (), v.end ());
+        return v;
+    }
+
+    void
+    testUpdates ()
+    {
+        testcase ("updates");
+
+        Tracker tracker;
+        tracker.add (1);
+        tracker.add (2);
+        tracker.add (3);
+
+        // New requests are computed at the first close
+        BEAST_EXPECT(sorted (tracker.onLedgerClosed (10, {})) ==
+            std::vector<int> ({ 1, 2, 3 }));
+        tracker.computed (1, 10, keys ({ 100, 101 }));
+        tracker.computed (2, 10, keys ({ 101, 200 }));
+        tracker.computed (3, 10, keys ({ 300 }));
+
+        // Most ledgers touch none of the corridors
+        BEAST_EXPECT(tracker.onLedgerClosed (11, keys ({ 999 })).empty ());
+
+        // Only the requests using a modified line or book
+        BEAST_EXPECT(sorted (tracker.onLedgerClosed (12, keys ({ 101 }))) ==
+            std::vector<int> ({ 1, 2 }));
+
+        // Until recomputed they stay due
+        tracker.computed (1, 12, keys ({ 100 }));
+        BEAST_EXPECT(tracker.onLedgerClosed (13, {}) ==
+            std::vector<int> ({ 2 }));
+        tracker.computed (2, 13, keys ({ 200 }));
+
+        // Dependencies are replaced by the latest computation
+        BEAST_EXPECT(tracker.onLedgerClosed (14, keys ({ 101 })).empty ());
+
+        auto const stats = tracker.getStats ();
+        BEAST_EXPECT(stats.closes == 5);
+        BEAST_EXPECT(stats.recomputed == 6);
+        BEAST_EXPECT(stats.skipped == 9);
+    }
+
+    void
+    testGapsAndRemoval ()
+    {
+        testcase ("gaps and removal");
+
+        Tracker tracker;
+        tracker.add (1);
+        tracker.add (2);
+        tracker.onLedgerClosed (10, {});
+        tracker.computed (1, 10, keys ({ 100 }));
+        tracker.computed (2, 10, keys ({ 200 }));
+
+        // A skipped ledger recomputes everything
+        BEAST_EXPECT(sorted (tracker.onLedgerClosed (12, {})) ==
+            std::vector<int> ({ 1, 2 }));
+        tracker.computed (1, 12, keys ({ 100 }));
+        tracker.computed (2, 12, keys ({ 200 }));
+
+        tracker.remove (2);
+        tracker.computed (2, 12, keys ({ 100 }));
+        BEAST_EXPECT(tracker.size () == 1);
+        BEAST_EXPECT(tracker.onLedgerClosed (13, keys ({ 100, 200 })) ==
+            std::vector<int> ({ 1 }));
+    }
+
+    void
+    testLateResult ()
+    {
+        testcase ("result finishing after a close");
+
+        Tracker tracker;
+        tracker.add (1);
+        tracker.onLedgerClosed (10, {});
+        tracker.computed (1, 10, keys ({ 100 }));
+
+        // A search starts against ledger 11, and ledger 12 closes,
+        // modifying a line it read, before it finishes
+        BEAST_EXPECT(tracker.onLedgerClosed (11, {}).empty ());
+        BEAST_EXPECT(tracker.onLedgerClosed (12, keys ({ 100 })) ==
+            std::vector<int> ({ 1 }));
+        tracker.computed (1, 11, keys ({ 100 }));
+
+        // The stale result does not clear the request
+        BEAST_EXPECT(tracker.onLedgerClosed (13, {}) ==
+            std::vector<int> ({ 1 }));
+        tracker.computed (1, 13, keys ({ 100 }));
+        BEAST_EXPECT(tracker.onLedgerClosed (14, {}).empty ());
+
+        // Even a result against a later ledger only clears it once
+        // that ledger is the latest
+        tracker.add (2);
+        tracker.computed (2, 15, keys ({ 200 }));
+        BEAST_EXPECT(tracker.onLedgerClosed (15, {}) ==
+            std::vector<int> ({ 2 }));
+    }
+
+    void
+    testBooks ()
+    {
+        testcase ("books");
+
+        Tracker tracker;
+        tracker.add (1);
+        tracker.add (2);
+        tracker.add (3);
+        tracker.onLedgerClosed (10, {});
+
+        // 1 crossed book 500, 2 searched USD and EUR, which had no book
+        tracker.computed (1, 10, keys ({ 100 }), { dir (500, 7) },
+            { "XRP", "USD" });
+        tracker.computed (2, 10, keys ({ 200 }), {}, { "USD", "EUR" });
+        tracker.computed (3, 10, keys ({ 300 }), {}, { "XRP", "BTC" });
+
+        // An offer opens a new quality level in book 500
+        BEAST_EXPECT(tracker.onLedgerClosed (11, {}, { dir (500, 9) }) ==
+            std::vector<int> ({ 1 }));
+        tracker.computed (1, 11, keys ({ 100 }), { dir (500, 7) },
+            { "XRP", "USD" });
+
+        // Other books do not matter
+        BEAST_EXPECT(tracker.onLedgerClosed (12, {}, { dir (501, 7) })
+            .empty ());
+
+        // The first offer in an empty book opens it to requests which
+        // searched both sides
+        BEAST_EXPECT(tracker.onLedgerClosed (13, {}, { dir (502, 1) },
+            { { "EUR", "USD" } }) == std::vector<int> ({ 2 }));
+        tracker.computed (2, 13, keys ({ 200 }), { dir (502, 1) },
+            { "USD", "EUR" });
+        BEAST_EXPECT(sorted (tracker.onLedgerClosed (14, {}, {},
+            { { "XRP", "USD" }, { "BTC", "XRP" } })) ==
+                std::vector<int> ({ 1, 3 }));
+    }
+
+public:
+    void
+    run ()
+    {
+        testUpdates ();
+        testGapsAndRemoval ();
+        testLateResult ();
+        testBooks ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(PathRequestTracker,app,mtchain);
+
+} // test
+} //
@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/CacheGovernor.h>
+#include <mtchain/basics/chrono.h>
+#include <mtchain/basics/ShardedTaggedCache.h>
+#include <mtchain/beast/unit_test.h>
+
+namespace mtchain {
+
+class CacheGovernor_test : public beast::unit_test::suite
+{
+    // A cache whose usage is scripted by the test
+    struct FakeCache : CacheGovernor::Source
+    {
+        std::string name_;
+        std::size_t bytesPerEntry;
+        CacheGovernor::Usage u;
+        int targetSize = 0;
+        std::chrono::seconds targetAge {0};
+
+        FakeCache (std::string name, std::size_t bpe, std::size_t entries)
+            : name_ (std::move (name))
+            , bytesPerEntry (bpe)
+        {
+            setEntries (entries);
+        }
+
+        void
+        setEntries (std::size_t entries)
+        {
+            u.entries = entries;
+            u.bytes = entries * bytesPerEntry;
+        }
+
+        std::string const&
+        name () const override
+        {
+            return name_;
+        }
+
+        CacheGovernor::Usage
+        usage () override
+        {
+            return u;
+        }
+
+        void
+        setTarget (int size, std::chrono::seconds age) override
+        {
+            targetSize = size;
+            targetAge = age;
+            // Pretend the cache fills up to its new target
+            setEntries (size);
+        }
+    };
+
+    static
+    CacheGovernor::Limits
+    limits (int base)
+    {
+        CacheGovernor::Limits l;
+        l.minSize = 16;
+        l.baseSize = base;
+        l.baseAge = std::chrono::seconds (60);
+        l.minAge = std::chrono::seconds (5);
+        l.maxAge = std::chrono::seconds (300);
+        return l;
+    }
+
+    void
+    testShift ()
+    {
+        testcase ("shift towards misses");
+
+        beast::Journal const j;
+        std::size_t const budget = 1000 * 100 + 1000 * 50;
+        CacheGovernor g (budget, j);
+
+        FakeCache busy ("busy", 100, 1000);
+        FakeCache idle ("idle", 50, 1000);
+        g.add (busy, limits (1000));
+        g.add (idle, limits (1000));
+
+        for (int i = 0; i < 20; ++i)
+        {
+            busy.u.hits += 500;
+            busy.u.misses += 500;
+            idle.u.hits += 1000;
+            g.rebalance ();
+
+            BEAST_EXPECT(busy.u.bytes + idle.u.bytes <= budget);
+        }
+
+        // The idle cache gave its memory to the one that needed it
+        BEAST_EXPECT(idle.targetSize == 16);
+        BEAST_EXPECT(busy.targetSize > 1000);
+        BEAST_EXPECT(busy.targetAge > std::chrono::seconds (60));
+        BEAST_EXPECT(idle.targetAge == std::chrono::seconds (5));
+
+        auto const targets = g.getTargets ();
+        BEAST_EXPECT(targets.size () == 2);
+        BEAST_EXPECT(targets[0].name == "busy");
+        BEAST_EXPECT(targets[0].score > targets[1].score);
+    }
+
+    void
+    testBudget ()
+    {
+        testcase ("budget");
+
+        beast::Journal const j;
+        CacheGovernor g (10000, j);
+
+        FakeCache a ("a", 10, 2000);
+        FakeCache b ("b", 10, 2000);
+        g.add (a, limits (2000));
+        g.add (b, limits (2000));
+
+        // No misses anywhere: sizes only shrink to fit the budget
+        g.rebalance ();
+        BEAST_EXPECT(a.targetSize == 500);
+        BEAST_EXPECT(b.targetSize == 500);
+        BEAST_EXPECT(a.targetAge == std::chrono::seconds (15));
+
+        // A larger budget lets them grow back only when they miss
+        g.setBudget (100000);
+        g.rebalance ();
+        BEAST_EXPECT(a.targetSize == 500);
+
+        a.u.misses += 100;
+        b.u.misses += 100;
+        g.rebalance ();
+        BEAST_EXPECT(a.targetSize > 500);
+        BEAST_EXPECT(a.targetSize == b.targetSize);
+
+        // Upper limits are respected
+        g.remove (b);
+        auto l = limits (2000);
+        l.maxSize = 3000;
+        g.remove (a);
+        g.add (a, l);
+        for (int i = 0; i < 20; ++i)
+        {
+            a.u.misses += 1000;
+            g.rebalance ();
+        }
+        BEAST_EXPECT(a.targetSize == 3000);
+        BEAST_EXPECT(a.targetAge == std::chrono::seconds (90));
+    }
+
+    void
+    testCapped ()
+    {
+        testcase ("capped caches");
+
+        beast::Journal const j;
+        std::size_t const budget = 30000;
+        CacheGovernor g (budget, j);
+
+        FakeCache a ("a", 10, 1000);
+        FakeCache b ("b", 10, 1000);
+        auto la = limits (1000);
+        la.maxSize = 500;
+        g.add (a, la);
+        g.add (b, limits (1000));
+
+        for (int i = 0; i < 40; ++i)
+        {
+            a.u.misses += 100;
+            b.u.misses += 100;
+            g.rebalance ();
+            BEAST_EXPECT(a.u.bytes + b.u.bytes <= budget);
+        }
+
+        // What the capped cache can not use goes to the other one
+        BEAST_EXPECT(a.targetSize == 500);
+        BEAST_EXPECT(b.targetSize > 2400);
+    }
+
+    void
+    testTaggedCache ()
+    {
+        testcase ("sharded cache");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        using Cache = ShardedTaggedCache<int, int>;
+        Cache cache ("test", 100, 60, clock, j);
+
+        GovernedCache<Cache> governed ("test", cache, 64);
+
+        for (int i = 0; i < 10; ++i)
+            cache.insert (i, i);
+        for (int i = 0; i < 20; ++i)
+            cache.fetch (i);
+
+        auto const u = governed.usage ();
+        BEAST_EXPECT(u.entries == 10);
+        BEAST_EXPECT(u.bytes == 640);
+        BEAST_EXPECT(u.hits == 10);
+        BEAST_EXPECT(u.misses == 10);
+
+        governed.setTarget (500, std::chrono::seconds (30));
+        BEAST_EXPECT(cache.getTargetSize () == 500);
+        BEAST_EXPECT(cache.getTargetAge () == 30);
+    }
+
+public:
+    void
+    run ()
+    {
+        testShift ();
+        testBudget ();
+        testCapped ();
+        testTaggedCache ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(CacheGovernor,common,mtchain);
+
+} //
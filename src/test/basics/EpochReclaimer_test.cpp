@@ -0,0 +1,296 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/EpochReclaimer.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace mtchain {
+
+class EpochReclaimer_test : public beast::unit_test::suite
+{
+    struct Tracked
+    {
+        static std::atomic<int> live;
+
+        std::uint64_t magic = 0x5eed5eed5eed5eedULL;
+
+        Tracked ()
+        {
+            ++live;
+        }
+
+        ~Tracked ()
+        {
+            magic = 0;
+            --live;
+        }
+    };
+
+public:
+    void testDeferral ()
+    {
+        testcase ("deferral");
+
+        EpochReclaimer r (4);
+        Tracked::live = 0;
+
+        // Nothing retired, nothing freed
+        BEAST_EXPECT(r.reclaim () == 0);
+
+        {
+            EpochReclaimer::ReadGuard guard (r);
+            r.retire (new Tracked);
+            BEAST_EXPECT(r.pending () == 1);
+
+            // The reader may still hold the object
+            for (int i = 0; i < 4; ++i)
+                r.reclaim ();
+            BEAST_EXPECT(Tracked::live == 1);
+            BEAST_EXPECT(r.pending () == 1);
+        }
+
+        // Freed once the epoch can move past the reader's
+        std::size_t freed = 0;
+        for (int i = 0; i < 3; ++i)
+            freed += r.reclaim ();
+        BEAST_EXPECT(freed == 1);
+        BEAST_EXPECT(Tracked::live == 0);
+        BEAST_EXPECT(r.pending () == 0);
+    }
+
+    void testSharedPtr ()
+    {
+        testcase ("shared_ptr");
+
+        EpochReclaimer r (4);
+        Tracked::live = 0;
+
+        std::weak_ptr<Tracked> weak;
+        {
+            auto p = std::make_shared<Tracked> ();
+            weak = p;
+            r.retire (std::move (p));
+        }
+        BEAST_EXPECT(! weak.expired ());
+
+        for (int i = 0; i < 3; ++i)
+            r.reclaim ();
+        BEAST_EXPECT(weak.expired ());
+        BEAST_EXPECT(Tracked::live == 0);
+    }
+
+    void testDestructor ()
+    {
+        testcase ("destructor");
+
+        Tracked::live = 0;
+        {
+            EpochReclaimer r (4);
+            for (int i = 0; i < 10; ++i)
+                r.retire (new Tracked);
+            BEAST_EXPECT(Tracked::live == 10);
+        }
+        BEAST_EXPECT(Tracked::live == 0);
+    }
+
+    // Readers dereference a published object while a writer keeps
+    // replacing and retiring it. A freed object would show a bad magic.
+    void testStress ()
+    {
+        testcase ("stress");
+
+        EpochReclaimer r (8);
+        Tracked::live = 0;
+
+        std::atomic<Tracked*> current {new Tracked};
+        std::atomic<bool> done {false};
+        std::atomic<std::size_t> bad {0};
+        std::atomic<std::size_t> reads {0};
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t)
+        {
+            readers.emplace_back ([&]
+                {
+                    while (! done)
+                    {
+                        EpochReclaimer::ReadGuard guard (r);
+                        auto p = current.load ();
+                        for (int i = 0; i < 16; ++i)
+                        {
+                            if (p->magic != 0x5eed5eed5eed5eedULL)
+                                ++bad;
+                        }
+                        ++reads;
+                    }
+                });
+        }
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            auto old = current.exchange (new Tracked);
+            r.retire (old);
+            if (i % 16 == 0)
+                r.reclaim ();
+        }
+
+        done = true;
+        for (auto& t : readers)
+            t.join ();
+
+        delete current.load ();
+        for (int i = 0; i < 3; ++i)
+            r.reclaim ();
+
+        BEAST_EXPECT(bad == 0);
+        BEAST_EXPECT(r.pending () == 0);
+        BEAST_EXPECT(Tracked::live == 0);
+        log << "    " << reads << " reads" << std::endl;
+    }
+
+    void run ()
+    {
+        testDeferral ();
+        testSharedPtr ();
+        testDestructor ();
+        testStress ();
+    }
+};
+
+std::atomic<int> EpochReclaimer_test::Tracked::live {0};
+
+BEAST_DEFINE_TESTSUITE(EpochReclaimer,common,mtchain);
+
+//------------------------------------------------------------------------------
+
+// Scaling benchmark: threads walk the same immutable 16-way tree, the way
+// RPC handlers walk a validated ledger. The reference counted walk copies
+// a shared_ptr at every step, as SHAMap::descend does; the epoch walk
+// follows raw pointers inside a read section.
+class EpochReclaimer_timing_test : public beast::unit_test::suite
+{
+    struct Node
+    {
+        std::array<std::shared_ptr<Node>, 16> children;
+        std::uint64_t value = 0;
+    };
+
+    static
+    std::shared_ptr<Node>
+    build (int depth, beast::xor_shift_engine& g)
+    {
+        auto n = std::make_shared<Node> ();
+        n->value = g ();
+        if (depth != 0)
+        {
+            for (auto& c : n->children)
+                c = build (depth - 1, g);
+        }
+        return n;
+    }
+
+    // Find a random leaf: the pattern of peekItem
+    static
+    std::uint64_t
+    lookupShared (std::shared_ptr<Node> const& root, std::uint64_t key)
+    {
+        auto n = root;
+        while (n->children[0])
+        {
+            auto next = n->children[key & 15];
+            n = std::move (next);
+            key >>= 4;
+        }
+        return n->value;
+    }
+
+    static
+    std::uint64_t
+    lookupRaw (Node const* n, std::uint64_t key)
+    {
+        while (n->children[0])
+        {
+            n = n->children[key & 15].get ();
+            key >>= 4;
+        }
+        return n->value;
+    }
+
+    template <class Lookup>
+    std::chrono::milliseconds
+    measure (int threads, Lookup&& lookup)
+    {
+        using namespace std::chrono;
+
+        int const lookups = 2000000 / threads;
+        std::atomic<std::uint64_t> sink {0};
+
+        auto const start = steady_clock::now ();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&, t]
+                {
+                    beast::xor_shift_engine g (t + 1);
+                    std::uint64_t sum = 0;
+                    for (int i = 0; i < lookups; ++i)
+                        sum += lookup (g ());
+                    sink += sum;
+                });
+        }
+        for (auto& w : workers)
+            w.join ();
+
+        return duration_cast<milliseconds> (steady_clock::now () - start);
+    }
+
+public:
+    void run ()
+    {
+        testcase ("scaling");
+
+        beast::xor_shift_engine g (1);
+        auto const root = build (4, g);
+        EpochReclaimer r;
+
+        for (int threads : { 1, 2, 4, 8, 16, 32 })
+        {
+            auto const shared = measure (threads,
+                [&](std::uint64_t key)
+                {
+                    return lookupShared (root, key);
+                });
+
+            auto const epoch = measure (threads,
+                [&](std::uint64_t key)
+                {
+                    EpochReclaimer::ReadGuard guard (r);
+                    return lookupRaw (root.get (), key);
+                });
+
+            log <<
+                "    " << threads << " threads: " <<
+                "shared_ptr " << shared.count () << "ms, " <<
+                "epoch " << epoch.count () << "ms" << std::endl;
+        }
+
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(EpochReclaimer_timing,common,mtchain);
+
+} //
@@ -0,0 +1,291 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/chrono.h>
+#include <mtchain/basics/ShardedTaggedCache.h>
+#include <mtchain/basics/TaggedCache.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/clock/manual_clock.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace mtchain {
+
+class ShardedTaggedCache_test : public beast::unit_test::suite
+{
+public:
+    // The same life cycle as TaggedCache_test, on a sharded cache
+    void testLifeCycle ()
+    {
+        testcase ("life cycle");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        clock.set (0);
+
+        using Key = int;
+        using Value = std::string;
+        using Cache = ShardedTaggedCache <Key, Value>;
+
+        Cache c ("test", 1, 1, clock, j,
+            beast::insight::NullCollector::New (), 4);
+        BEAST_EXPECT(c.shardCount () == 4);
+
+        // Insert an item, retrieve it, and age it so it gets purged.
+        {
+            BEAST_EXPECT(c.getCacheSize() == 0);
+            BEAST_EXPECT(c.getTrackSize() == 0);
+            BEAST_EXPECT(! c.insert (1, "one"));
+            BEAST_EXPECT(c.getCacheSize() == 1);
+            BEAST_EXPECT(c.getTrackSize() == 1);
+
+            {
+                std::string s;
+                BEAST_EXPECT(c.retrieve (1, s));
+                BEAST_EXPECT(s == "one");
+            }
+
+            ++clock;
+            c.sweep ();
+            BEAST_EXPECT(c.getCacheSize () == 0);
+            BEAST_EXPECT(c.getTrackSize () == 0);
+        }
+
+        // Insert an item, maintain a strong pointer, age it, and
+        // verify that the entry still exists.
+        {
+            BEAST_EXPECT(! c.insert (2, "two"));
+            BEAST_EXPECT(c.getCacheSize() == 1);
+            BEAST_EXPECT(c.getTrackSize() == 1);
+
+            {
+                Cache::mapped_ptr p (c.fetch (2));
+                BEAST_EXPECT(p != nullptr);
+                ++clock;
+                c.sweep ();
+                BEAST_EXPECT(c.getCacheSize() == 0);
+                BEAST_EXPECT(c.getTrackSize() == 1);
+            }
+
+            // Make sure its gone now that our reference is gone
+            ++clock;
+            c.sweep ();
+            BEAST_EXPECT(c.getCacheSize() == 0);
+            BEAST_EXPECT(c.getTrackSize() == 0);
+        }
+
+        // Canonicalize a new object with the same key while the
+        // original is only weakly tracked; we must get the original.
+        {
+            BEAST_EXPECT(! c.insert (4, "four"));
+
+            {
+                Cache::mapped_ptr p1 (c.fetch (4));
+                BEAST_EXPECT(p1 != nullptr);
+
+                ++clock;
+                c.sweep ();
+                BEAST_EXPECT(c.getCacheSize() == 0);
+                BEAST_EXPECT(c.getTrackSize() == 1);
+
+                Cache::mapped_ptr p2 (std::make_shared <std::string> ("four"));
+                BEAST_EXPECT(c.canonicalize (4, p2, false));
+                BEAST_EXPECT(c.getCacheSize() == 1);
+                BEAST_EXPECT(c.getTrackSize() == 1);
+                BEAST_EXPECT(p1.get() == p2.get());
+            }
+
+            ++clock;
+            c.sweep ();
+            BEAST_EXPECT(c.getCacheSize() == 0);
+            BEAST_EXPECT(c.getTrackSize() == 0);
+        }
+
+        // del
+        {
+            BEAST_EXPECT(! c.insert (5, "five"));
+            BEAST_EXPECT(c.del (5, false));
+            BEAST_EXPECT(c.getTrackSize() == 0);
+            BEAST_EXPECT(! c.del (5, false));
+        }
+    }
+
+    void testIncrementalSweep ()
+    {
+        testcase ("incremental sweep");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        clock.set (0);
+
+        using Cache = ShardedTaggedCache <int, int>;
+        Cache c ("test", 0, 1, clock, j,
+            beast::insight::NullCollector::New (), 8);
+
+        int const items = 1000;
+        for (int i = 0; i < items; ++i)
+            c.insert (i, i);
+        BEAST_EXPECT(c.getCacheSize () == items);
+
+        // Every shard should hold part of the keys
+        auto stats = c.getShardStats ();
+        BEAST_EXPECT(stats.size () == 8);
+        for (auto const& s : stats)
+            BEAST_EXPECT(s.cached > 0 && s.cached < items);
+
+        ++clock;
+
+        // Each call visits one more shard and only removes its entries
+        std::size_t removed = 0;
+        for (std::size_t i = 0; i < c.shardCount (); ++i)
+        {
+            auto const n = c.sweepSome (1);
+            BEAST_EXPECT(n > 0);
+            removed += n;
+            BEAST_EXPECT(c.getCacheSize () == items - static_cast<int>(removed));
+        }
+        BEAST_EXPECT(removed == items);
+        BEAST_EXPECT(c.getTrackSize () == 0);
+    }
+
+    void testStatistics ()
+    {
+        testcase ("statistics");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        clock.set (0);
+
+        using Cache = ShardedTaggedCache <int, int>;
+        Cache c ("test", 0, 60, clock, j);
+
+        for (int i = 0; i < 100; ++i)
+            c.insert (i, i);
+
+        for (int i = 0; i < 200; ++i)
+            c.fetch (i);
+
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        for (auto const& s : c.getShardStats ())
+        {
+            hits += s.hits;
+            misses += s.misses;
+        }
+        BEAST_EXPECT(hits == 100);
+        BEAST_EXPECT(misses == 100);
+        BEAST_EXPECT(c.getHitRate () == 50.0f);
+        BEAST_EXPECT(c.getKeys ().size () == 100);
+
+        c.reset ();
+        BEAST_EXPECT(c.getHitRate () == 0.0f);
+        BEAST_EXPECT(c.getTrackSize () == 0);
+    }
+
+    void run ()
+    {
+        testLifeCycle ();
+        testIncrementalSweep ();
+        testStatistics ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ShardedTaggedCache,common,mtchain);
+
+//------------------------------------------------------------------------------
+
+// Contention benchmark: several threads fetch and canonicalize keys from a
+// working set larger than the cache while one thread sweeps periodically.
+class ShardedTaggedCache_timing_test : public beast::unit_test::suite
+{
+    template <class Cache, class Sweep>
+    std::chrono::milliseconds
+    measure (Cache& c, int threads, Sweep&& sweep)
+    {
+        using namespace std::chrono;
+
+        int const opsPerThread = 500000;
+        int const keys = 1 << 18;
+        std::atomic<bool> done {false};
+
+        auto const start = steady_clock::now ();
+
+        std::thread sweeper ([&]
+            {
+                while (! done)
+                {
+                    sweep ();
+                    std::this_thread::sleep_for (milliseconds (1));
+                }
+            });
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&c, t, keys, opsPerThread]
+                {
+                    beast::xor_shift_engine g (t + 1);
+                    for (int i = 0; i < opsPerThread; ++i)
+                    {
+                        int const key = static_cast<int>(g () % keys);
+                        if (! c.fetch (key))
+                        {
+                            auto p = std::make_shared<int> (key);
+                            c.canonicalize (key, p);
+                        }
+                    }
+                });
+        }
+
+        for (auto& w : workers)
+            w.join ();
+        done = true;
+        sweeper.join ();
+
+        return duration_cast<milliseconds> (steady_clock::now () - start);
+    }
+
+public:
+    void run ()
+    {
+        testcase ("contention");
+
+        beast::Journal const j;
+
+        for (int threads : { 1, 2, 4, 8, 16 })
+        {
+            TaggedCache <int, int> single (
+                "single", 65536, 1, stopwatch (), j);
+            auto const t1 = measure (single, threads,
+                [&] { single.sweep (); });
+
+            ShardedTaggedCache <int, int> sharded (
+                "sharded", 65536, 1, stopwatch (), j,
+                    beast::insight::NullCollector::New (), 32);
+            auto const t2 = measure (sharded, threads,
+                [&] { sharded.sweepSome (4); });
+
+            log <<
+                "    " << threads << " threads: " <<
+                "TaggedCache " << t1.count () << "ms, " <<
+                "ShardedTaggedCache " << t2.count () << "ms (" <<
+                sharded.getHitRate () << "% hits)" << std::endl;
+        }
+
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(ShardedTaggedCache_timing,common,mtchain);
+
+} //
@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/basics/SlabAllocator.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <cstring>
+#include <set>
+#include <thread>
+
+namespace mtchain {
+
+class SlabAllocator_test : public beast::unit_test::suite
+{
+public:
+    void testReuse ()
+    {
+        testcase ("reuse");
+
+        SlabAllocator a (256, 4096);
+        BEAST_EXPECT(a.slabs () == 0);
+
+        auto p = a.allocate (40);
+        BEAST_EXPECT(reinterpret_cast<std::uintptr_t> (p) %
+            SlabAllocator::granularity == 0);
+        BEAST_EXPECT(a.slabs () == 1);
+        BEAST_EXPECT(a.reserved () == 4096);
+
+        // Same class: the freed block comes back
+        a.deallocate (p, 40);
+        BEAST_EXPECT(a.allocate (48) == p);
+
+        // Another class gets its own slab
+        auto q = a.allocate (100);
+        BEAST_EXPECT(a.slabs () == 2);
+        a.deallocate (q, 100);
+        a.deallocate (p, 48);
+
+        // Large requests bypass the slabs
+        auto big = a.allocate (1000);
+        BEAST_EXPECT(a.slabs () == 2);
+        a.deallocate (big, 1000);
+    }
+
+    void testDistinct ()
+    {
+        testcase ("distinct");
+
+        SlabAllocator a (256, 4096);
+        beast::xor_shift_engine rng (1);
+
+        // Blocks never overlap, across many slabs and sizes
+        std::vector<std::pair<std::uint8_t*, std::size_t>> blocks;
+        for (int i = 0; i < 5000; ++i)
+        {
+            std::size_t const size = 1 + rng () % 256;
+            auto p = static_cast<std::uint8_t*> (a.allocate (size));
+            std::memset (p, i & 0xff, size);
+            blocks.emplace_back (p, size);
+        }
+
+        bool ok = true;
+        for (std::size_t i = 0; i < blocks.size (); ++i)
+        {
+            for (std::size_t j = 0; j < blocks[i].second; ++j)
+                ok = ok && blocks[i].first[j] == (i & 0xff);
+        }
+        BEAST_EXPECT(ok);
+
+        std::set<std::uint8_t*> unique;
+        for (auto const& b : blocks)
+            unique.insert (b.first);
+        BEAST_EXPECT(unique.size () == blocks.size ());
+
+        auto const slabs = a.slabs ();
+        for (auto const& b : blocks)
+            a.deallocate (b.first, b.second);
+
+        // Everything freed is reused before new slabs are taken
+        for (auto const& b : blocks)
+            a.allocate (b.second);
+        BEAST_EXPECT(a.slabs () == slabs);
+    }
+
+    void testThreads ()
+    {
+        testcase ("threads");
+
+        SlabAllocator a;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back ([&a, t]
+                {
+                    beast::xor_shift_engine rng (t + 1);
+                    std::vector<std::pair<void*, std::size_t>> live;
+                    for (int i = 0; i < 20000; ++i)
+                    {
+                        if (live.size () > 100 && rng () % 2)
+                        {
+                            auto const b = live.back ();
+                            live.pop_back ();
+                            a.deallocate (b.first, b.second);
+                        }
+                        else
+                        {
+                            std::size_t const size = 1 + rng () % 300;
+                            live.emplace_back (a.allocate (size), size);
+                        }
+                    }
+                    for (auto const& b : live)
+                        a.deallocate (b.first, b.second);
+                });
+        }
+        for (auto& t : threads)
+            t.join ();
+        pass ();
+    }
+
+    void run ()
+    {
+        testReuse ();
+        testDistinct ();
+        testThreads ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SlabAllocator,common,mtchain);
+
+} //
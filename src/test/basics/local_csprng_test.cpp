@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/crypto/local_csprng.h>
+#include <mtchain/beast/unit_test.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace mtchain {
+
+class local_csprng_test : public beast::unit_test::suite
+{
+    void
+    testOutput ()
+    {
+        testcase ("output");
+
+        auto& prng = local_crypto_prng ();
+
+        std::set<std::uint64_t> seen;
+        for (int i = 0; i < 10000; ++i)
+            seen.insert (prng ());
+        BEAST_EXPECT(seen.size () == 10000);
+
+        // Sizes which straddle the end of the buffer, and a large one
+        std::vector<std::uint8_t> buf (3 * local_csprng_engine::bufferSize);
+        for (std::size_t size : { 1, 7, 100, 1000, 4095, 4097, 12288 })
+        {
+            std::fill (buf.begin (), buf.end (), 0);
+            prng (buf.data (), size);
+            auto const zeros = std::count (buf.begin (),
+                buf.begin () + size, 0);
+            // About one byte in 256 is zero
+            BEAST_EXPECT(zeros < static_cast<long> (size / 64 + 8));
+        }
+
+        prng.mix_entropy ();
+        std::uint8_t extra[16] = { 1, 2, 3 };
+        prng.mix_entropy (extra, sizeof(extra));
+        BEAST_EXPECT(seen.count (prng ()) == 0);
+    }
+
+    void
+    testThreads ()
+    {
+        testcase ("threads");
+
+        std::mutex m;
+        std::set<local_csprng_engine*> engines;
+        std::set<std::uint64_t> values;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back ([&]
+            {
+                auto& prng = local_crypto_prng ();
+                std::vector<std::uint64_t> v (1000);
+                for (auto& x : v)
+                    x = prng ();
+
+                std::lock_guard<std::mutex> lock (m);
+                engines.insert (&prng);
+                values.insert (v.begin (), v.end ());
+            });
+        }
+        for (auto& t : threads)
+            t.join ();
+
+        BEAST_EXPECT(engines.size () == 4);
+        BEAST_EXPECT(values.size () == 4000);
+    }
+
+    void
+    testFork ()
+    {
+#ifndef _WIN32
+        testcase ("fork");
+
+        // Fill the buffer, so the child inherits unused bytes
+        auto& prng = local_crypto_prng ();
+        prng ();
+
+        int fds[2];
+        if (! BEAST_EXPECT(pipe (fds) == 0))
+            return;
+
+        auto const pid = fork ();
+        if (pid == 0)
+        {
+            std::array<std::uint8_t, 32> child;
+            local_crypto_prng () (child.data (), child.size ());
+            auto const written = write (fds[1], child.data (), child.size ());
+            _exit (written == static_cast<ssize_t> (child.size ()) ? 0 : 1);
+        }
+        close (fds[1]);
+        if (! BEAST_EXPECT(pid > 0))
+        {
+            close (fds[0]);
+            return;
+        }
+
+        std::array<std::uint8_t, 32> parent;
+        prng (parent.data (), parent.size ());
+
+        std::array<std::uint8_t, 32> child;
+        auto const got = read (fds[0], child.data (), child.size ());
+        close (fds[0]);
+        int status = 0;
+        waitpid (pid, &status, 0);
+
+        BEAST_EXPECT(got == static_cast<ssize_t> (child.size ()));
+        BEAST_EXPECT(child != parent);
+#endif
+    }
+
+public:
+    void
+    run ()
+    {
+        testOutput ();
+        testThreads ();
+        testFork ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(local_csprng,crypto,mtchain);
+
+//------------------------------------------------------------------------------
+
+class local_csprng_timing_test : public beast::unit_test::suite
+{
+    // The shared engine: one lock, one OpenSSL call per draw
+    class shared_engine
+    {
+        std::mutex mutex_;
+
+    public:
+        void
+        operator()(void* ptr, std::size_t count)
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            RAND_bytes (static_cast<unsigned char*> (ptr),
+                static_cast<int> (count));
+        }
+    };
+
+    template <class Draw>
+    std::chrono::milliseconds
+    time (std::size_t threads, Draw draw)
+    {
+        auto const start = std::chrono::steady_clock::now ();
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&draw]
+            {
+                std::uint8_t nonce[32];
+                for (int i = 0; i < 200000; ++i)
+                    draw (nonce, sizeof(nonce));
+            });
+        }
+        for (auto& w : workers)
+            w.join ();
+        return std::chrono::duration_cast<std::chrono::milliseconds> (
+            std::chrono::steady_clock::now () - start);
+    }
+
+public:
+    void
+    run ()
+    {
+        shared_engine shared;
+        for (std::size_t threads : { 1, 2, 4, 8 })
+        {
+            auto const a = time (threads,
+                [&shared](void* p, std::size_t n) { shared (p, n); });
+            auto const b = time (threads,
+                [](void* p, std::size_t n) { local_crypto_prng () (p, n); });
+            log << threads << " threads, 32 byte draws: shared " <<
+                a.count () << "ms, local " << b.count () << "ms" << std::endl;
+        }
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(local_csprng_timing,crypto,mtchain);
+
+} //
@@ -0,0 +1,509 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/ledger/FlatDeferredCredits.h>
+#include <mtchain/basics/hardened_hash.h>
+#include <mtchain/protocol/AccountID.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace mtchain {
+namespace test {
+
+class FlatDeferredCredits_test : public beast::unit_test::suite
+{
+protected:
+    // Stands in for STAmount
+    struct Amount
+    {
+        std::int64_t value;
+
+        Amount&
+        operator+= (Amount const& other)
+        {
+            value += other.value;
+            return *this;
+        }
+
+        Amount
+        operator- () const
+        {
+            return { -value };
+        }
+
+        friend
+        bool
+        operator== (Amount const& a, Amount const& b)
+        {
+            return a.value == b.value;
+        }
+
+        friend
+        Amount
+        zeroed (Amount const&)
+        {
+            return { 0 };
+        }
+    };
+
+    using Currency = std::uint32_t;
+    using Credits = FlatDeferredCredits<AccountID, Currency, Amount>;
+    using SeededCredits = FlatDeferredCredits<AccountID, Currency, Amount,
+        hardened_hash<>>;
+
+    // Counts the allocations made by the reference maps
+    static std::size_t allocations;
+
+    template <class T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+
+        CountingAllocator () = default;
+
+        template <class U>
+        CountingAllocator (CountingAllocator<U> const&)
+        {
+        }
+
+        T*
+        allocate (std::size_t n)
+        {
+            ++allocations;
+            return std::allocator<T> ().allocate (n);
+        }
+
+        void
+        deallocate (T* p, std::size_t n)
+        {
+            std::allocator<T> ().deallocate (p, n);
+        }
+
+        template <class U>
+        bool
+        operator== (CountingAllocator<U> const&) const
+        {
+            return true;
+        }
+
+        template <class U>
+        bool
+        operator!= (CountingAllocator<U> const&) const
+        {
+            return false;
+        }
+    };
+
+    // The std::map based tables PaymentSandbox used before
+    class Reference
+    {
+    public:
+        void
+        credit (AccountID const& sender, AccountID const& receiver,
+            Amount const& amount, Amount const& preCreditSenderBalance,
+                Currency const& currency)
+        {
+            auto const k = key (sender, receiver, currency);
+            auto const i = credits_.find (k);
+            if (i == credits_.end ())
+            {
+                Value v;
+                if (sender < receiver)
+                {
+                    v.highAcctCredits = amount;
+                    v.lowAcctCredits = zeroed (amount);
+                    v.lowAcctOrigBalance = preCreditSenderBalance;
+                }
+                else
+                {
+                    v.highAcctCredits = zeroed (amount);
+                    v.lowAcctCredits = amount;
+                    v.lowAcctOrigBalance = -preCreditSenderBalance;
+                }
+                credits_.emplace (k, v);
+            }
+            else
+            {
+                auto& v = i->second;
+                if (sender < receiver)
+                    v.highAcctCredits += amount;
+                else
+                    v.lowAcctCredits += amount;
+            }
+        }
+
+        void
+        ownerCount (AccountID const& id, std::uint32_t cur,
+            std::uint32_t next)
+        {
+            auto const v = std::max (cur, next);
+            auto r = ownerCounts_.emplace (id, v);
+            if (! r.second)
+                r.first->second = std::max (r.first->second, v);
+        }
+
+        boost::optional<std::uint32_t>
+        ownerCount (AccountID const& id) const
+        {
+            auto const i = ownerCounts_.find (id);
+            if (i == ownerCounts_.end ())
+                return boost::none;
+            return i->second;
+        }
+
+        boost::optional<Credits::Adjustment>
+        adjustments (AccountID const& main, AccountID const& other,
+            Currency const& currency) const
+        {
+            auto const i = credits_.find (key (main, other, currency));
+            if (i == credits_.end ())
+                return boost::none;
+            auto const& v = i->second;
+            if (main < other)
+                return Credits::Adjustment (v.highAcctCredits,
+                    v.lowAcctCredits, v.lowAcctOrigBalance);
+            return Credits::Adjustment (v.lowAcctCredits,
+                v.highAcctCredits, -v.lowAcctOrigBalance);
+        }
+
+        std::size_t
+        size () const
+        {
+            return credits_.size ();
+        }
+
+        void
+        apply (Reference& to) const
+        {
+            for (auto const& i : credits_)
+            {
+                auto r = to.credits_.emplace (i);
+                if (! r.second)
+                {
+                    r.first->second.lowAcctCredits +=
+                        i.second.lowAcctCredits;
+                    r.first->second.highAcctCredits +=
+                        i.second.highAcctCredits;
+                }
+            }
+            for (auto const& i : ownerCounts_)
+                to.ownerCount (i.first, i.second, i.second);
+        }
+
+    private:
+        using Key = std::tuple<AccountID, AccountID, Currency>;
+
+        struct Value
+        {
+            Amount lowAcctCredits;
+            Amount highAcctCredits;
+            Amount lowAcctOrigBalance;
+        };
+
+        static
+        Key
+        key (AccountID const& a, AccountID const& b, Currency const& c)
+        {
+            if (a < b)
+                return Key (a, b, c);
+            return Key (b, a, c);
+        }
+
+        std::map<Key, Value, std::less<Key>,
+            CountingAllocator<std::pair<Key const, Value>>> credits_;
+        std::map<AccountID, std::uint32_t, std::less<AccountID>,
+            CountingAllocator<std::pair<AccountID const, std::uint32_t>>>
+                ownerCounts_;
+    };
+
+    static
+    std::vector<AccountID>
+    makeAccounts (std::size_t count)
+    {
+        std::vector<AccountID> result (count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            result[i].data ()[0] = static_cast<std::uint8_t> (i >> 8);
+            result[i].data ()[1] = static_cast<std::uint8_t> (i);
+        }
+        return result;
+    }
+
+    template <class A, class B>
+    static
+    bool
+    same (boost::optional<A> const& a, boost::optional<B> const& b)
+    {
+        if (! a || ! b)
+            return ! a && ! b;
+        return a->debits == b->debits && a->credits == b->credits &&
+            a->origBalance == b->origBalance;
+    }
+
+private:
+    void
+    testCredits ()
+    {
+        testcase ("credits");
+
+        auto const accounts = makeAccounts (3);
+        auto const& alice = accounts[0];
+        auto const& bob = accounts[1];
+        Currency const usd = 1;
+
+        Credits credits;
+        BEAST_EXPECT(credits.empty ());
+        BEAST_EXPECT(! credits.adjustments (alice, bob, usd));
+
+        credits.credit (alice, bob, { 10 }, { 100 }, usd);
+        credits.credit (bob, alice, { 3 }, { 50 }, usd);
+        credits.credit (alice, bob, { 5 }, { 90 }, usd);
+        BEAST_EXPECT(credits.size () == 1);
+
+        auto const a = credits.adjustments (alice, bob, usd);
+        BEAST_EXPECT(a && a->debits.value == 15 && a->credits.value == 3 &&
+            a->origBalance.value == 100);
+        auto const b = credits.adjustments (bob, alice, usd);
+        BEAST_EXPECT(b && b->debits.value == 3 && b->credits.value == 15 &&
+            b->origBalance.value == -100);
+        BEAST_EXPECT(! credits.adjustments (alice, bob, usd + 1));
+
+        credits.ownerCount (alice, 2, 3);
+        credits.ownerCount (alice, 3, 1);
+        BEAST_EXPECT(credits.ownerCount (alice) == 3u);
+        BEAST_EXPECT(! credits.ownerCount (bob));
+
+        // Applying to a parent adds the credits, keeping its balance
+        Credits parent;
+        parent.credit (bob, alice, { 1 }, { 40 }, usd);
+        parent.ownerCount (alice, 5, 4);
+        credits.apply (parent);
+        auto const p = parent.adjustments (alice, bob, usd);
+        BEAST_EXPECT(p && p->debits.value == 15 && p->credits.value == 4 &&
+            p->origBalance.value == -40);
+        BEAST_EXPECT(parent.ownerCount (alice) == 5u);
+    }
+
+    template <class Table>
+    void
+    testRandom (std::string const& name, std::size_t lines)
+    {
+        testcase (name + ", " + std::to_string (lines) + " lines");
+
+        beast::xor_shift_engine rng (lines);
+        auto const accounts = makeAccounts (lines);
+        auto const pick = [&]()
+        {
+            return accounts[rng () % accounts.size ()];
+        };
+
+        typename Table::Pool pool;
+        Table parent (&pool);
+        Reference parentRef;
+        for (int round = 0; round < 20; ++round)
+        {
+            Table child (&pool);
+            Reference childRef;
+            for (std::size_t i = 0; i < 4 * lines; ++i)
+            {
+                auto const from = pick ();
+                auto const to = pick ();
+                auto const currency = static_cast<Currency> (rng () % 3);
+                Amount const amount { std::int64_t (rng () % 1000) };
+                Amount const balance { std::int64_t (rng () % 10000) };
+                child.credit (from, to, amount, balance, currency);
+                childRef.credit (from, to, amount, balance, currency);
+
+                auto const count = std::uint32_t (rng () % 10);
+                child.ownerCount (from, count, count + 1);
+                childRef.ownerCount (from, count, count + 1);
+            }
+
+            if (rng () % 2)
+            {
+                child.apply (parent);
+                childRef.apply (parentRef);
+            }
+
+            bool ok = child.size () == childRef.size () &&
+                parent.size () == parentRef.size ();
+            for (auto const& a : accounts)
+            {
+                for (auto const& b : accounts)
+                {
+                    for (Currency c = 0; c < 3; ++c)
+                    {
+                        ok = ok && same (child.adjustments (a, b, c),
+                            childRef.adjustments (a, b, c));
+                        ok = ok && same (parent.adjustments (a, b, c),
+                            parentRef.adjustments (a, b, c));
+                    }
+                }
+                ok = ok && child.ownerCount (a) == childRef.ownerCount (a);
+                ok = ok && parent.ownerCount (a) == parentRef.ownerCount (a);
+            }
+            BEAST_EXPECT(ok);
+        }
+
+        // Only the parent and the first child needed new storage
+        BEAST_EXPECT(pool.created () == 2);
+        BEAST_EXPECT(pool.reused () == 19);
+    }
+
+    void
+    testPool ()
+    {
+        testcase ("pool");
+
+        auto const accounts = makeAccounts (2);
+        Credits::Pool pool;
+        {
+            Credits a (&pool);
+            a.credit (accounts[0], accounts[1], { 1 }, { 1 }, 0);
+            a.ownerCount (accounts[0], 1, 2);
+
+            // Moving hands the storage over
+            Credits b (std::move (a));
+            BEAST_EXPECT(b.size () == 1);
+        }
+        BEAST_EXPECT(pool.created () == 1);
+
+        // Recycled storage starts out empty
+        Credits c (&pool);
+        BEAST_EXPECT(pool.reused () == 1);
+        BEAST_EXPECT(c.empty ());
+        BEAST_EXPECT(! c.adjustments (accounts[0], accounts[1], 0));
+        BEAST_EXPECT(! c.ownerCount (accounts[0]));
+    }
+
+public:
+    void
+    run ()
+    {
+        testCredits ();
+        testRandom<Credits> ("random", 6);
+        testRandom<Credits> ("random", 40);
+        // Each table, and each copy of a table, hashes with its own seed
+        testRandom<SeededCredits> ("seeded hash", 6);
+        testRandom<SeededCredits> ("seeded hash", 40);
+        testPool ();
+    }
+};
+
+std::size_t FlatDeferredCredits_test::allocations = 0;
+
+BEAST_DEFINE_TESTSUITE(FlatDeferredCredits,ledger,mtchain);
+
+//------------------------------------------------------------------------------
+
+// The sandbox pattern of a Flow call: for each strand evaluation a
+// sandbox is opened on top of the payment's, credits a few trust lines
+// and is either applied or discarded.
+class FlatDeferredCredits_timing_test : public FlatDeferredCredits_test
+{
+    struct MapFlow
+    {
+        Reference
+        make ()
+        {
+            return Reference ();
+        }
+    };
+
+    struct FlatFlow
+    {
+        static std::size_t created;
+        Credits::Pool pool;
+
+        ~FlatFlow ()
+        {
+            created += pool.created ();
+        }
+
+        Credits
+        make ()
+        {
+            return Credits (&pool);
+        }
+    };
+
+    template <class Flow>
+    void
+    payments (std::size_t count, std::size_t lines)
+    {
+        beast::xor_shift_engine rng (1);
+        auto const accounts = makeAccounts (64);
+        for (std::size_t p = 0; p < count; ++p)
+        {
+            Flow flow;
+            auto parent = flow.make ();
+            auto const first = rng () % (accounts.size () - lines);
+            for (int strand = 0; strand < 50; ++strand)
+            {
+                auto sb = flow.make ();
+                for (std::size_t i = 0; i < lines; ++i)
+                {
+                    auto const& from = accounts[first + i];
+                    auto const& to = accounts[first + i + 1];
+                    sb.credit (from, to, { 10 }, { 1000 }, 1);
+                    sb.adjustments (from, to, 1);
+                }
+                sb.ownerCount (accounts[first], 3, 2);
+                if (strand % 4 == 0)
+                    sb.apply (parent);
+            }
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        using namespace std::chrono;
+
+        std::size_t const count = 20000;
+        for (std::size_t lines : { 2, 6, 12 })
+        {
+            testcase (std::to_string (lines) + " lines per strand");
+
+            allocations = 0;
+            auto start = steady_clock::now ();
+            payments<MapFlow> (count, lines);
+            auto const mapMs = duration_cast<milliseconds> (
+                steady_clock::now () - start);
+            log << "    std::map: " << mapMs.count () << "ms, " <<
+                allocations << " node allocations" << std::endl;
+
+            FlatFlow::created = 0;
+            start = steady_clock::now ();
+            payments<FlatFlow> (count, lines);
+            auto const flatMs = duration_cast<milliseconds> (
+                steady_clock::now () - start);
+            log << "    flat: " << flatMs.count () << "ms, " <<
+                FlatFlow::created << " tables given new storage" << std::endl;
+            pass ();
+        }
+    }
+};
+
+std::size_t FlatDeferredCredits_timing_test::FlatFlow::created = 0;
+
+BEAST_DEFINE_TESTSUITE_MANUAL(FlatDeferredCredits_timing,ledger,mtchain);
+
+} // test
+} //
@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/ledger/FundsCache.h>
+#include <mtchain/beast/unit_test.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+namespace test {
+
+class FundsCache_test : public beast::unit_test::suite
+{
+    // Stands in for FreezeHandling
+    enum Freeze
+    {
+        ignoreFreeze,
+        zeroIfFrozen
+    };
+
+    using Cache = FundsCache<std::string, std::string, std::int64_t, Freeze>;
+    using Balances = std::map<std::pair<std::string, std::string>,
+        std::int64_t>;
+
+    void
+    testLookup ()
+    {
+        testcase ("lookup");
+
+        Balances balances {
+            { { "bob", "USD" }, 10 },
+            { { "bob", "EUR" }, 20 },
+            { { "carol", "USD" }, 30 } };
+        int reads = 0;
+
+        Cache cache;
+        auto const funds = [&](std::string const& owner,
+            std::string const& issue)
+        {
+            return cache.get (owner, issue, zeroIfFrozen, [&]
+            {
+                ++reads;
+                return balances[{ owner, issue }];
+            });
+        };
+
+        BEAST_EXPECT(funds ("bob", "USD") == 10);
+        BEAST_EXPECT(funds ("bob", "EUR") == 20);
+        BEAST_EXPECT(funds ("bob", "USD") == 10);
+        BEAST_EXPECT(funds ("carol", "USD") == 30);
+        BEAST_EXPECT(reads == 3);
+        BEAST_EXPECT(cache.hits () == 1 && cache.misses () == 3);
+
+        // A transfer from bob to carol changes both
+        balances[{ "bob", "USD" }] -= 5;
+        balances[{ "carol", "USD" }] += 5;
+        cache.invalidate ("bob", "carol");
+        BEAST_EXPECT(funds ("bob", "USD") == 5);
+        BEAST_EXPECT(funds ("carol", "USD") == 35);
+        BEAST_EXPECT(funds ("bob", "EUR") == 20);
+        BEAST_EXPECT(reads == 6);
+
+        cache.clear ();
+        BEAST_EXPECT(funds ("bob", "EUR") == 20);
+        BEAST_EXPECT(reads == 7);
+    }
+
+    void
+    testLongBook ()
+    {
+        testcase ("long book");
+
+        // 1000 offers from 4 owners, most of them unfunded, as in the
+        // step limit test. Only consumed offers move funds.
+        Balances balances {
+            { { "alice", "USD" }, 400 },
+            { { "bob", "USD" }, 0 },
+            { { "carol", "USD" }, 1 },
+            { { "dan", "USD" }, 1000 } };
+        std::vector<std::string> const owners {
+            "alice", "bob", "carol", "dan" };
+
+        Cache cache;
+        int reads = 0;
+        int consumed = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            auto const& owner = owners[i * owners.size () / 1000];
+            auto const funded = cache.get (owner, "USD", zeroIfFrozen, [&]
+            {
+                ++reads;
+                return balances[{ owner, "USD" }];
+            });
+            if (funded <= 0)
+                continue;
+
+            balances[{ owner, "USD" }] -= 1;
+            cache.invalidate (owner, "taker");
+            ++consumed;
+        }
+
+        BEAST_EXPECT(consumed == 501);
+        // Funded offers still need a fresh read after each transfer,
+        // but unfunded ones are decided from the cache.
+        BEAST_EXPECT(reads == consumed + 2);
+    }
+
+    void
+    testFreeze ()
+    {
+        testcase ("freeze");
+
+        // bob's USD line is frozen: what he holds depends on whether
+        // the caller honours the freeze.
+        std::int64_t const balance = 10;
+        int reads = 0;
+
+        Cache cache;
+        auto const holds = [&](Freeze freeze)
+        {
+            return cache.get ("bob", "USD", freeze, [&]
+            {
+                ++reads;
+                return freeze == zeroIfFrozen ? 0 : balance;
+            });
+        };
+
+        BEAST_EXPECT(holds (zeroIfFrozen) == 0);
+        BEAST_EXPECT(holds (ignoreFreeze) == 10);
+        BEAST_EXPECT(holds (zeroIfFrozen) == 0);
+        BEAST_EXPECT(holds (ignoreFreeze) == 10);
+        BEAST_EXPECT(reads == 2);
+
+        cache.invalidate ("bob");
+        BEAST_EXPECT(holds (ignoreFreeze) == 10);
+        BEAST_EXPECT(reads == 3);
+    }
+
+public:
+    void
+    run ()
+    {
+        testLookup ();
+        testFreeze ();
+        testLongBook ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(FundsCache,ledger,mtchain);
+
+} // test
+} //
@@ -0,0 +1,337 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/ledger/OrderBookIndex.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace mtchain {
+namespace test {
+
+class OrderBookIndex_test : public beast::unit_test::suite
+{
+    // The cached funded amount of each offer
+    using Index = OrderBookIndex<std::int64_t>;
+    using Change = Index::Change;
+
+    static
+    uint256
+    key (int i)
+    {
+        uint256 k;
+        k.zero ();
+        *k.begin () = static_cast<std::uint8_t> (i >> 8);
+        *(k.begin () + 1) = static_cast<std::uint8_t> (i);
+        return k;
+    }
+
+    static
+    Change
+    create (int book, int offer, std::uint64_t quality,
+        std::int64_t funded, int owner = 0)
+    {
+        return { Change::created, key (book), key (offer), quality, funded,
+            key (owner) };
+    }
+
+    static
+    Change
+    modify (int offer, std::int64_t funded)
+    {
+        return { Change::modified, uint256 (), key (offer), 0, funded };
+    }
+
+    static
+    Change
+    remove (int offer)
+    {
+        return { Change::deleted, uint256 (), key (offer), 0, 0 };
+    }
+
+    // Keys of a book's offers, in iteration order
+    static
+    std::vector<uint256>
+    keys (std::shared_ptr<Index::Book const> const& book)
+    {
+        std::vector<uint256> result;
+        if (book)
+            for (auto const& e : *book)
+                result.push_back (e.key);
+        return result;
+    }
+
+    void
+    testOrder ()
+    {
+        testcase ("order");
+
+        Index index;
+        BEAST_EXPECT(! index.current ());
+
+        // Within a quality, offers keep the order they were placed in
+        index.reset (10, key (1000), {
+            create (1, 5, 200, 50),
+            create (1, 3, 100, 30),
+            create (1, 4, 200, 40),
+            create (1, 2, 100, 20),
+            create (2, 9, 7, 90) });
+
+        auto const s = index.current ();
+        if (! BEAST_EXPECT(s))
+            return;
+        BEAST_EXPECT(s->seq () == 10);
+        BEAST_EXPECT(s->books () == 2);
+        BEAST_EXPECT(keys (s->book (key (1))) == std::vector<uint256> (
+            { key (3), key (2), key (5), key (4) }));
+        BEAST_EXPECT(! s->book (key (3)));
+
+        auto const b = s->book (key (1));
+        BEAST_EXPECT(b->lower_bound (150)->key == key (5));
+        BEAST_EXPECT(b->lower_bound (300) == b->end ());
+        BEAST_EXPECT(b->begin ()->offer == 30);
+    }
+
+    void
+    testUpdate ()
+    {
+        testcase ("update");
+
+        Index index;
+        index.reset (10, key (1000), {
+            create (1, 1, 100, 10),
+            create (1, 2, 100, 20),
+            create (2, 3, 50, 30) });
+        auto const before = index.current ();
+
+        BEAST_EXPECT(index.apply (11, key (1000), key (1001), {
+            modify (1, 5),
+            create (1, 4, 90, 40),
+            remove (2),
+            create (1, 2, 100, 21) }));
+
+        auto const after = index.current ();
+        if (! BEAST_EXPECT(after && after->seq () == 11))
+            return;
+
+        // Re-created offers go to the back of their quality
+        BEAST_EXPECT(keys (after->book (key (1))) == std::vector<uint256> (
+            { key (4), key (1), key (2) }));
+        BEAST_EXPECT(std::next (after->book (key (1))->begin ())->offer == 5);
+
+        // The old snapshot is untouched, and unchanged books are shared
+        BEAST_EXPECT(keys (before->book (key (1))) == std::vector<uint256> (
+            { key (1), key (2) }));
+        BEAST_EXPECT(before->book (key (1))->begin ()->offer == 10);
+        BEAST_EXPECT(before->book (key (2)) == after->book (key (2)));
+
+        // Emptied books disappear, and may come back in the same update
+        BEAST_EXPECT(index.apply (12, key (1001), key (1002), {
+            remove (3) }));
+        BEAST_EXPECT(! index.current ()->book (key (2)));
+        BEAST_EXPECT(index.apply (13, key (1002), key (1003), {
+            create (3, 6, 1, 60), remove (6), create (3, 7, 2, 70) }));
+        BEAST_EXPECT(keys (index.current ()->book (key (3))) ==
+            std::vector<uint256> ({ key (7) }));
+
+        BEAST_EXPECT(index.current (key (1003)));
+        BEAST_EXPECT(! index.current (key (1002)));
+    }
+
+    void
+    testInvalid ()
+    {
+        testcase ("invalid");
+
+        Index index;
+        auto const rebuild = [&index]
+        {
+            index.reset (10, key (1000), { create (1, 1, 100, 10) });
+        };
+
+        // A skipped ledger
+        rebuild ();
+        BEAST_EXPECT(! index.apply (12, key (1000), key (1002), {}));
+        BEAST_EXPECT(! index.current ());
+
+        // A different parent
+        rebuild ();
+        BEAST_EXPECT(! index.apply (11, key (999), key (1001), {}));
+        BEAST_EXPECT(! index.current ());
+
+        // An offer the index does not know
+        rebuild ();
+        BEAST_EXPECT(! index.apply (11, key (1000), key (1001), {
+            modify (2, 0) }));
+        BEAST_EXPECT(! index.current ());
+        BEAST_EXPECT(! index.apply (11, key (1000), key (1001), {}));
+
+        // A duplicate offer
+        rebuild ();
+        BEAST_EXPECT(! index.apply (11, key (1000), key (1001), {
+            create (2, 1, 5, 0) }));
+        BEAST_EXPECT(! index.current ());
+
+        rebuild ();
+        BEAST_EXPECT(index.apply (11, key (1000), key (1001), {}));
+        BEAST_EXPECT(index.current ());
+    }
+
+    static
+    Change
+    funds (int owner)
+    {
+        return { Change::funds, uint256 (), uint256 (), 0, 0, key (owner) };
+    }
+
+    void
+    testFunds ()
+    {
+        testcase ("funds");
+
+        Index index;
+        index.reset (10, key (1000), {
+            create (1, 1, 100, 10, 7),
+            create (1, 2, 100, 20, 8),
+            create (2, 3, 50, 30, 7) });
+        auto const before = index.current ();
+
+        // Owner 7 paid away half of everything
+        std::vector<uint256> refreshed;
+        auto const halve = [&refreshed](Index::Entry const& e)
+        {
+            refreshed.push_back (e.key);
+            return e.offer / 2;
+        };
+        BEAST_EXPECT(index.apply (11, key (1000), key (1001), {
+            funds (7), funds (9) }, halve));
+        BEAST_EXPECT(refreshed.size () == 2);
+
+        auto const s = index.current ();
+        BEAST_EXPECT(s->book (key (1))->begin ()->offer == 5);
+        BEAST_EXPECT(std::next (s->book (key (1))->begin ())->offer == 20);
+        BEAST_EXPECT(s->book (key (2))->begin ()->offer == 15);
+        BEAST_EXPECT(s->book (key (2))->begin ()->owner == key (7));
+        BEAST_EXPECT(before->book (key (1))->begin ()->offer == 10);
+
+        // Deleted offers are no longer refreshed, created ones are
+        refreshed.clear ();
+        BEAST_EXPECT(index.apply (12, key (1001), key (1002), {
+            remove (1), create (3, 4, 1, 40, 7), funds (7) }, halve));
+        BEAST_EXPECT(refreshed.size () == 2);
+        BEAST_EXPECT(index.current ()->book (key (3))->begin ()->offer == 20);
+
+        // Funds changes for an owner with offers need a refresh
+        BEAST_EXPECT(index.apply (13, key (1002), key (1003), { funds (9) }));
+        BEAST_EXPECT(! index.apply (14, key (1003), key (1004), {
+            funds (8) }));
+        BEAST_EXPECT(! index.current ());
+    }
+
+    void
+    testRandom ()
+    {
+        testcase ("random");
+
+        // A directory walk, modeled as (book, quality, placed) order
+        using Model = std::map<std::tuple<int, std::uint64_t, int>,
+            std::pair<int, std::int64_t>>;
+
+        beast::xor_shift_engine g (31);
+        Model model;
+        std::map<int, Model::key_type> live;
+        int placed = 0;
+        int next = 0;
+
+        Index index;
+        index.reset (1, key (1), {});
+
+        for (int seq = 2; seq < 200; ++seq)
+        {
+            std::vector<Change> changes;
+            for (int n = g () % 20; n > 0; --n)
+            {
+                auto const r = g () % 4;
+                if (r < 2 || live.empty ())
+                {
+                    int const book = g () % 5;
+                    std::uint64_t const quality = g () % 8;
+                    auto const where =
+                        std::make_tuple (book, quality, placed++);
+                    model[where] = { next, 0 };
+                    live[next] = where;
+                    changes.push_back (create (book, next, quality, 0));
+                    ++next;
+                    continue;
+                }
+
+                auto iter = live.lower_bound (g () % next);
+                if (iter == live.end ())
+                    iter = live.begin ();
+                if (r == 2)
+                {
+                    auto const funded = static_cast<std::int64_t> (g () % 100);
+                    model[iter->second].second = funded;
+                    changes.push_back (modify (iter->first, funded));
+                }
+                else
+                {
+                    model.erase (iter->second);
+                    changes.push_back (remove (iter->first));
+                    live.erase (iter);
+                }
+            }
+
+            if (! index.apply (seq, key (seq - 1), key (seq), changes))
+            {
+                fail ("update rejected");
+                return;
+            }
+        }
+
+        auto const s = index.current ();
+        bool same = true;
+        auto m = model.begin ();
+        for (int book = 0; book < 5; ++book)
+        {
+            auto const b = s->book (key (book));
+            if (! b)
+                continue;
+            for (auto const& e : *b)
+            {
+                same = same && m != model.end () &&
+                    std::get<0> (m->first) == book &&
+                    e.key == key (m->second.first) &&
+                    e.offer == m->second.second;
+                ++m;
+            }
+        }
+        BEAST_EXPECT(same && m == model.end ());
+    }
+
+public:
+    void
+    run ()
+    {
+        testOrder ();
+        testUpdate ();
+        testInvalid ();
+        testFunds ();
+        testRandom ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(OrderBookIndex,ledger,mtchain);
+
+} // test
+} //
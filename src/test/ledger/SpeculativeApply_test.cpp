@@ -0,0 +1,280 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/ledger/SpeculativeApply.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace mtchain {
+namespace test {
+
+/*  A toy ledger of account balances, with payments as transactions.
+
+    A payment reads both accounts and writes both if the sender can
+    afford it, and writes nothing otherwise, so its outcome depends on
+    earlier payments in the same way a real transaction's does.
+*/
+class SpeculativeApply_test : public beast::unit_test::suite
+{
+protected:
+    using State = std::map<uint256, std::int64_t>;
+    using Writes = std::vector<std::pair<uint256, std::int64_t>>;
+
+    struct Payment
+    {
+        uint256 from;
+        uint256 to;
+        std::int64_t amount;
+    };
+
+    static
+    uint256
+    account (int i)
+    {
+        uint256 k;
+        k.zero ();
+        *k.begin () = static_cast<std::uint8_t> (i >> 8);
+        *(k.begin () + 1) = static_cast<std::uint8_t> (i);
+        return k;
+    }
+
+    static
+    State
+    makeState (int accounts, std::int64_t balance)
+    {
+        State s;
+        for (int i = 0; i < accounts; ++i)
+            s[account (i)] = balance;
+        return s;
+    }
+
+    // Busy work standing in for signature checks and invariants
+    static
+    std::uint64_t
+    work (int rounds)
+    {
+        std::uint64_t h = 0;
+        for (int i = 0; i < rounds; ++i)
+            h = h * 6364136223846793005ULL + 1442695040888963407ULL;
+        return h;
+    }
+
+    static
+    Speculation<Writes>
+    pay (State const& state, Payment const& p, int rounds)
+    {
+        Speculation<Writes> s;
+        s.reads = { p.from, p.to };
+        if (work (rounds) == 1)
+            s.reads.clear ();
+
+        auto const from = state.at (p.from);
+        auto const to = state.at (p.to);
+        if (from >= p.amount)
+        {
+            s.outcome = { { p.from, from - p.amount },
+                { p.to, to + p.amount } };
+            s.writes = { p.from, p.to };
+        }
+        return s;
+    }
+
+    static
+    void
+    apply (State& state, Writes const& w)
+    {
+        for (auto const& e : w)
+            state[e.first] = e.second;
+    }
+
+    static
+    State
+    serial (State state, std::vector<Payment> const& txs, int rounds)
+    {
+        for (auto const& p : txs)
+            apply (state, pay (state, p, rounds).outcome);
+        return state;
+    }
+
+    static
+    SpeculativeApplyStats
+    speculative (State& state, std::vector<Payment> const& txs,
+        std::size_t threads, int rounds)
+    {
+        State const& base = state;
+        return applySpeculatively<Writes> (txs.size (), threads,
+            [&](std::size_t i)
+            {
+                return pay (base, txs[i], rounds);
+            },
+            [&](std::size_t, Writes&& w)
+            {
+                apply (state, w);
+            },
+            [&](std::size_t i)
+            {
+                auto s = pay (state, txs[i], rounds);
+                apply (state, s.outcome);
+                return s.writes;
+            });
+    }
+
+    static
+    std::vector<Payment>
+    makePayments (int count, int accounts, bool disjoint,
+        beast::xor_shift_engine& rng)
+    {
+        std::vector<Payment> txs;
+        for (int i = 0; i < count; ++i)
+        {
+            Payment p;
+            if (disjoint)
+            {
+                p.from = account (2 * i);
+                p.to = account (2 * i + 1);
+            }
+            else
+            {
+                int const a = rng () % accounts;
+                p.from = account (a);
+                p.to = account ((a + 1 + rng () % (accounts - 1)) % accounts);
+            }
+            p.amount = 1 + rng () % 150;
+            txs.push_back (p);
+        }
+        return txs;
+    }
+
+public:
+    void
+    testDisjoint ()
+    {
+        testcase ("disjoint");
+
+        beast::xor_shift_engine rng (1);
+        auto const txs = makePayments (500, 1000, true, rng);
+        auto state = makeState (1000, 100);
+        auto const expected = serial (state, txs, 0);
+
+        auto const stats = speculative (state, txs, 4, 0);
+        BEAST_EXPECT(state == expected);
+        BEAST_EXPECT(stats.committed == txs.size ());
+        BEAST_EXPECT(stats.reexecuted == 0);
+    }
+
+    void
+    testConflicts ()
+    {
+        testcase ("conflicts");
+
+        // Few accounts and low balances: many payments conflict and
+        // some only succeed because of an earlier one
+        for (int accounts : { 3, 20, 200 })
+        {
+            beast::xor_shift_engine rng (accounts);
+            auto const txs = makePayments (1000, accounts, false, rng);
+            auto state = makeState (accounts, 100);
+            auto const expected = serial (state, txs, 0);
+
+            auto const stats = speculative (state, txs, 4, 0);
+            BEAST_EXPECT(state == expected);
+            BEAST_EXPECT(stats.committed + stats.reexecuted == txs.size ());
+            BEAST_EXPECT(stats.reexecuted != 0);
+        }
+    }
+
+    void
+    testException ()
+    {
+        testcase ("exception");
+
+        std::size_t commits = 0;
+        try
+        {
+            applySpeculatively<int> (100, 4,
+                [](std::size_t i)
+                {
+                    if (i == 37)
+                        throw std::runtime_error ("bad transaction");
+                    return Speculation<int> {};
+                },
+                [&](std::size_t, int&&) { ++commits; },
+                [](std::size_t) { return std::vector<uint256> {}; });
+            fail ();
+        }
+        catch (std::runtime_error const&)
+        {
+            pass ();
+        }
+        BEAST_EXPECT(commits == 0);
+    }
+
+    void
+    run ()
+    {
+        testDisjoint ();
+        testConflicts ();
+        testException ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SpeculativeApply,ledger,mtchain);
+
+//------------------------------------------------------------------------------
+
+// Non-overlapping payments with a fixed amount of work each, applied
+// serially and speculatively on an increasing number of threads.
+class SpeculativeApply_timing_test : public SpeculativeApply_test
+{
+public:
+    void
+    run ()
+    {
+        using namespace std::chrono;
+
+        testcase ("disjoint payments");
+
+        int const count = 20000;
+        int const rounds = 20000;
+
+        beast::xor_shift_engine rng (1);
+        auto const txs = makePayments (count, 2 * count, true, rng);
+        auto const initial = makeState (2 * count, 100);
+
+        auto start = steady_clock::now ();
+        auto const expected = serial (initial, txs, rounds);
+        auto const serialMs = duration_cast<milliseconds> (
+            steady_clock::now () - start);
+        log << "    serial: " << serialMs.count () << "ms" << std::endl;
+
+        for (std::size_t threads : { 1, 2, 4, 8 })
+        {
+            auto state = initial;
+            start = steady_clock::now ();
+            auto const stats = speculative (state, txs, threads, rounds);
+            auto const ms = duration_cast<milliseconds> (
+                steady_clock::now () - start);
+
+            BEAST_EXPECT(state == expected);
+            log << "    " << threads << " threads: " << ms.count () <<
+                "ms, " << stats.reexecuted << " re-executed" << std::endl;
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SpeculativeApply_timing,ledger,mtchain);
+
+} // test
+} //
@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/ledger/StrandCache.h>
+#include <mtchain/beast/unit_test.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+namespace test {
+
+class StrandCache_test : public beast::unit_test::suite
+{
+    static
+    uint256
+    key (int i)
+    {
+        uint256 k;
+        k.zero ();
+        *k.begin () = static_cast<std::uint8_t> (i >> 8);
+        *(k.begin () + 1) = static_cast<std::uint8_t> (i);
+        return k;
+    }
+
+    // A directory of book i, at some quality
+    static
+    uint256
+    dir (int i, std::uint64_t quality)
+    {
+        auto k = key (i);
+        for (int b = 0; b < 8; ++b)
+            *(k.end () - 1 - b) =
+                static_cast<std::uint8_t> (quality >> (8 * b));
+        return k;
+    }
+
+    static
+    std::vector<uint256>
+    keys (std::initializer_list<int> ids)
+    {
+        std::vector<uint256> result;
+        for (auto i : ids)
+            result.push_back (key (i));
+        return result;
+    }
+
+    void
+    testDependencies ()
+    {
+        testcase ("dependencies");
+
+        DependencyIndex<int> index;
+        index.insert (1, keys ({ 10, 11, 11 }));
+        index.insert (2, keys ({ 11, 12 }));
+        index.insert (3, keys ({ 13 }));
+        BEAST_EXPECT(index.size () == 3);
+        BEAST_EXPECT(index.keys () == 4);
+
+        auto hit = index.affected (keys ({ 11, 14 }));
+        std::sort (hit.begin (), hit.end ());
+        BEAST_EXPECT(hit == std::vector<int> ({ 1, 2 }));
+        BEAST_EXPECT(index.affected (keys ({ 14 })).empty ());
+
+        // Re-registering replaces the old dependencies
+        index.insert (1, keys ({ 13 }));
+        hit = index.affected (keys ({ 10, 13 }));
+        std::sort (hit.begin (), hit.end ());
+        BEAST_EXPECT(hit == std::vector<int> ({ 1, 3 }));
+        BEAST_EXPECT(index.keys () == 3);
+
+        index.erase (3);
+        index.erase (3);
+        BEAST_EXPECT(! index.contains (3));
+        BEAST_EXPECT(index.affected (keys ({ 13 })) ==
+            std::vector<int> ({ 1 }));
+
+        index.clear ();
+        BEAST_EXPECT(index.size () == 0 && index.keys () == 0);
+    }
+
+    void
+    testCache ()
+    {
+        testcase ("cache");
+
+        StrandCache<std::string> cache (3);
+        cache.reset (key (1000));
+
+        // Two corridors through a gateway's trust lines, one through a book
+        auto const usd = std::make_shared<std::string> ("USD strands");
+        auto const eur = std::make_shared<std::string> ("EUR strands");
+        auto const book = std::make_shared<std::string> ("book strands");
+        cache.insert (key (1), usd, keys ({ 100, 101 }));
+        cache.insert (key (2), eur, keys ({ 100, 102 }));
+        cache.insert (key (3), book, keys ({ 200 }));
+
+        BEAST_EXPECT(cache.find (key (1)) == usd);
+        BEAST_EXPECT(cache.find (key (3)) == book);
+        BEAST_EXPECT(! cache.find (key (4)));
+        BEAST_EXPECT(cache.hits () == 2 && cache.misses () == 1);
+
+        // A payment changing one trust line only affects its corridor
+        cache.invalidate (keys ({ 101, 300 }));
+        BEAST_EXPECT(! cache.find (key (1)));
+        BEAST_EXPECT(cache.find (key (2)) == eur);
+        BEAST_EXPECT(cache.invalidated () == 1);
+
+        cache.invalidate (keys ({ 100 }));
+        BEAST_EXPECT(cache.size () == 1);
+
+        // The same ledger keeps the entries, a new one drops them
+        cache.reset (key (1000));
+        BEAST_EXPECT(cache.size () == 1);
+        cache.reset (key (1001));
+        BEAST_EXPECT(cache.size () == 0);
+        BEAST_EXPECT(! cache.find (key (3)));
+
+        // A full cache starts over
+        for (int i = 0; i < 4; ++i)
+            cache.insert (key (i), usd, keys ({ i }));
+        BEAST_EXPECT(cache.size () == 1);
+        BEAST_EXPECT(cache.find (key (3)) == usd);
+        cache.invalidate (keys ({ 0, 1, 2 }));
+        BEAST_EXPECT(cache.size () == 1);
+    }
+
+    void
+    testBooks ()
+    {
+        testcase ("books");
+
+        StrandCache<std::string> cache;
+        cache.reset (key (1000));
+
+        auto const strands = std::make_shared<std::string> ("strands");
+        cache.insert (key (1), strands, keys ({ 100 }), { dir (500, 7) });
+        cache.insert (key (2), strands, keys ({ 100 }), { dir (501, 7) });
+
+        // Changing the quality directory read, or opening another
+        // quality in the same book, drops the strands through it
+        cache.invalidate ({}, { dir (502, 7) });
+        BEAST_EXPECT(cache.size () == 2);
+        cache.invalidate ({}, { dir (500, 9) });
+        BEAST_EXPECT(! cache.find (key (1)));
+        cache.invalidate ({}, { dir (501, 7) });
+        BEAST_EXPECT(cache.size () == 0);
+    }
+
+public:
+    void
+    run ()
+    {
+        testDependencies ();
+        testCache ();
+        testBooks ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(StrandCache,ledger,mtchain);
+
+} // test
+} //
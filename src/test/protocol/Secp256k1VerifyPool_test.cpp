@@ -0,0 +1,394 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/Secp256k1VerifyPool.h>
+#include <mtchain/protocol/PublicKey.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/unit_test.h>
+#include <secp256k1/include/secp256k1.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mtchain {
+
+namespace detail {
+
+// Digests signed by a handful of keys, with compressed public keys
+// and DER encoded, low S signatures
+class SignedDigests
+{
+public:
+    std::vector<uint256> digests;
+    std::vector<Blob> keys;
+    std::vector<Blob> signatures;
+
+    SignedDigests (std::size_t count, std::uint64_t seed)
+        : ctx_ (secp256k1_context_create (SECP256K1_CONTEXT_SIGN))
+    {
+        beast::xor_shift_engine g (seed);
+
+        std::vector<uint256> secrets;
+        std::vector<Blob> publics;
+        while (secrets.size () < 4)
+        {
+            uint256 sk;
+            beast::rngfill (sk.data (), sk.size (), g);
+            secp256k1_pubkey pk;
+            if (secp256k1_ec_pubkey_create (ctx_.get (), &pk,
+                    sk.data ()) != 1)
+                continue;
+            Blob key (33);
+            std::size_t len = key.size ();
+            secp256k1_ec_pubkey_serialize (ctx_.get (), key.data (), &len,
+                &pk, SECP256K1_EC_COMPRESSED);
+            secrets.push_back (sk);
+            publics.push_back (std::move (key));
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            uint256 digest;
+            beast::rngfill (digest.data (), digest.size (), g);
+
+            auto const k = i % secrets.size ();
+            secp256k1_ecdsa_signature sig;
+            secp256k1_ecdsa_sign (ctx_.get (), &sig, digest.data (),
+                secrets[k].data (), nullptr, nullptr);
+
+            digests.push_back (digest);
+            keys.push_back (publics[k]);
+            signatures.push_back (der (sig));
+        }
+    }
+
+    // The same signature with S replaced by its negation
+    Blob
+    highS (Blob const& signature) const
+    {
+        static std::uint8_t const order[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+            0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B,
+            0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41 };
+
+        secp256k1_ecdsa_signature sig;
+        secp256k1_ecdsa_signature_parse_der (ctx_.get (), &sig,
+            signature.data (), signature.size ());
+        std::uint8_t rs[64];
+        secp256k1_ecdsa_signature_serialize_compact (ctx_.get (), rs, &sig);
+
+        int borrow = 0;
+        for (int i = 31; i >= 0; --i)
+        {
+            int const d = order[i] - rs[32 + i] - borrow;
+            rs[32 + i] = static_cast<std::uint8_t> (d);
+            borrow = d < 0;
+        }
+
+        secp256k1_ecdsa_signature_parse_compact (ctx_.get (), &sig, rs);
+        return der (sig);
+    }
+
+    // The same key, uncompressed
+    Blob
+    uncompressed (Blob const& key) const
+    {
+        secp256k1_pubkey pk;
+        if (secp256k1_ec_pubkey_parse (ctx_.get (), &pk,
+                key.data (), key.size ()) != 1)
+            return {};
+        Blob result (65);
+        std::size_t len = result.size ();
+        secp256k1_ec_pubkey_serialize (ctx_.get (), result.data (), &len,
+            &pk, SECP256K1_EC_UNCOMPRESSED);
+        return result;
+    }
+
+private:
+    struct ContextDeleter
+    {
+        void
+        operator() (secp256k1_context* ctx) const
+        {
+            secp256k1_context_destroy (ctx);
+        }
+    };
+
+    Blob
+    der (secp256k1_ecdsa_signature const& sig) const
+    {
+        Blob result (72);
+        std::size_t len = result.size ();
+        secp256k1_ecdsa_signature_serialize_der (ctx_.get (), result.data (),
+            &len, &sig);
+        result.resize (len);
+        return result;
+    }
+
+    std::unique_ptr<secp256k1_context, ContextDeleter> ctx_;
+};
+
+} // detail
+
+class Secp256k1VerifyPool_test : public beast::unit_test::suite
+{
+    void
+    testVerify ()
+    {
+        testcase ("verify");
+
+        detail::SignedDigests s (200, 19);
+        s.digests[3].data ()[0] ^= 1;
+        s.signatures[40].pop_back ();
+        s.keys[41][0] = 0x05;
+        s.signatures[50] = s.highS (s.signatures[50]);
+        s.signatures[51] = s.highS (s.signatures[51]);
+
+        std::vector<std::atomic<int>> verdicts (s.digests.size ());
+        for (auto& v : verdicts)
+            v = -1;
+
+        {
+            Secp256k1VerifyPool pool (3);
+            BEAST_EXPECT(pool.threads () == 3);
+            for (std::size_t i = 0; i < s.digests.size (); ++i)
+            {
+                BEAST_EXPECT(pool.submit (s.digests[i], makeSlice (s.keys[i]),
+                    makeSlice (s.signatures[i]), i != 51,
+                    [&verdicts, i](bool ok) { verdicts[i] = ok; }));
+            }
+        }
+
+        for (std::size_t i = 0; i < verdicts.size (); ++i)
+        {
+            bool const good = i != 3 && i != 40 && i != 41 && i != 50;
+            BEAST_EXPECT(verdicts[i] == (good ? 1 : 0));
+        }
+    }
+
+    // The verdict verifyDigest gives, or false for keys PublicKey
+    // refuses to hold
+    static
+    bool
+    serial (uint256 const& digest, Blob const& key, Blob const& signature,
+        bool fullyCanonical)
+    {
+        if (! publicKeyType (makeSlice (key)))
+            return false;
+        return verifyDigest (PublicKey (makeSlice (key)), digest,
+            makeSlice (signature), fullyCanonical);
+    }
+
+    void
+    testAgreement ()
+    {
+        testcase ("agrees with verifyDigest");
+
+        detail::SignedDigests s (8, 23);
+
+        struct Case
+        {
+            uint256 digest;
+            Blob key;
+            Blob signature;
+        };
+        std::vector<Case> cases;
+        for (std::size_t i = 0; i < s.digests.size (); ++i)
+        {
+            auto const& d = s.digests[i];
+            auto const& k = s.keys[i];
+            auto const& sig = s.signatures[i];
+
+            cases.push_back ({ d, k, sig });
+            cases.push_back ({ d, k, s.highS (sig) });
+
+            // Uncompressed and hybrid encodings of the same key
+            auto const u = s.uncompressed (k);
+            cases.push_back ({ d, u, sig });
+            auto h = u;
+            h[0] = k[0] == 0x02 ? 0x06 : 0x07;
+            cases.push_back ({ d, h, sig });
+
+            // R padded with a needless zero byte
+            Blob padded;
+            padded.push_back (0x30);
+            padded.push_back (static_cast<std::uint8_t> (sig[1] + 1));
+            padded.push_back (0x02);
+            padded.push_back (static_cast<std::uint8_t> (sig[3] + 1));
+            padded.push_back (0x00);
+            padded.insert (padded.end (), sig.begin () + 4, sig.end ());
+            cases.push_back ({ d, k, padded });
+
+            // Trailing garbage inside the sequence
+            auto trailing = sig;
+            trailing.push_back (0x00);
+            ++trailing[1];
+            cases.push_back ({ d, k, trailing });
+
+            // A wrong sequence length
+            auto length = sig;
+            --length[1];
+            cases.push_back ({ d, k, length });
+        }
+
+        std::vector<std::atomic<int>> verdicts (2 * cases.size ());
+        {
+            Secp256k1VerifyPool pool (2);
+            for (std::size_t i = 0; i < verdicts.size (); ++i)
+            {
+                auto const& c = cases[i / 2];
+                pool.submit (c.digest, makeSlice (c.key),
+                    makeSlice (c.signature), i % 2 == 0,
+                    [&verdicts, i](bool ok) { verdicts[i] = ok; });
+            }
+        }
+
+        int accepted = 0;
+        for (std::size_t i = 0; i < verdicts.size (); ++i)
+        {
+            auto const& c = cases[i / 2];
+            bool const expected = serial (c.digest, c.key, c.signature,
+                i % 2 == 0);
+            BEAST_EXPECT((verdicts[i] == 1) == expected);
+            accepted += expected;
+        }
+
+        // Each good signature, plus its high S form when allowed
+        BEAST_EXPECT(accepted == 3 * 8);
+    }
+
+    void
+    testStats ()
+    {
+        testcase ("stats");
+
+        detail::SignedDigests s (20, 5);
+        s.digests[0].data ()[0] ^= 1;
+
+        std::promise<void> started;
+        std::promise<void> release;
+        auto wait = release.get_future ().share ();
+
+        Secp256k1VerifyPool pool (1, 8);
+
+        // Hold the only worker so that requests stay queued
+        BEAST_EXPECT(pool.submit (s.digests[1], makeSlice (s.keys[1]),
+            makeSlice (s.signatures[1]), true,
+            [&started, wait](bool)
+            {
+                started.set_value ();
+                wait.wait ();
+            }));
+        started.get_future ().wait ();
+
+        std::atomic<int> done {0};
+        std::size_t accepted = 0;
+        for (std::size_t i = 0; i < 10; ++i)
+        {
+            if (pool.submit (s.digests[i], makeSlice (s.keys[i]),
+                    makeSlice (s.signatures[i]), true,
+                    [&done](bool) { ++done; }))
+                ++accepted;
+        }
+        BEAST_EXPECT(accepted == 8);
+
+        auto st = pool.stats ();
+        BEAST_EXPECT(st.queued == 8);
+        BEAST_EXPECT(st.dropped == 2);
+
+        release.set_value ();
+        while (done != 8)
+            std::this_thread::yield ();
+
+        st = pool.stats ();
+        BEAST_EXPECT(st.queued == 0);
+        BEAST_EXPECT(st.verified == 8);
+        BEAST_EXPECT(st.failed == 1);
+        BEAST_EXPECT(st.perSecond > 0);
+    }
+
+    void
+    run ()
+    {
+        testVerify ();
+        testAgreement ();
+        testStats ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Secp256k1VerifyPool,protocol,mtchain);
+
+//------------------------------------------------------------------------------
+
+class Secp256k1VerifyPool_timing_test : public beast::unit_test::suite
+{
+public:
+    void
+    run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+        using namespace std::chrono;
+
+        std::size_t const count = 4000;
+        detail::SignedDigests s (count, 1);
+
+        // One shared context, one thread
+        {
+            auto const ctx = secp256k1_context_create (
+                SECP256K1_CONTEXT_VERIFY);
+            auto const start = clock_type::now ();
+            std::size_t good = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                secp256k1_pubkey key;
+                secp256k1_ecdsa_signature sig;
+                if (secp256k1_ec_pubkey_parse (ctx, &key, s.keys[i].data (),
+                        s.keys[i].size ()) == 1 &&
+                    secp256k1_ecdsa_signature_parse_der (ctx, &sig,
+                        s.signatures[i].data (), s.signatures[i].size ()) == 1 &&
+                    secp256k1_ecdsa_verify (ctx, &sig, s.digests[i].data (),
+                        &key) == 1)
+                    ++good;
+            }
+            auto const ms = duration_cast<milliseconds> (
+                clock_type::now () - start).count ();
+            secp256k1_context_destroy (ctx);
+            BEAST_EXPECT(good == count);
+            log << "serial: " << ms << "ms" << std::endl;
+        }
+
+        for (std::size_t threads : { 1, 2, 4, 8 })
+        {
+            std::atomic<std::size_t> good {0};
+            auto const start = clock_type::now ();
+            {
+                Secp256k1VerifyPool pool (threads, count);
+                for (std::size_t i = 0; i < count; ++i)
+                    pool.submit (s.digests[i], makeSlice (s.keys[i]),
+                        makeSlice (s.signatures[i]), true,
+                        [&good](bool ok) { good += ok; });
+            }
+            auto const ms = duration_cast<milliseconds> (
+                clock_type::now () - start).count ();
+            BEAST_EXPECT(good == count);
+            log << threads << " threads: " << ms << "ms" << std::endl;
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(Secp256k1VerifyPool_timing,protocol,mtchain);
+
+} //
@@ -0,0 +1,257 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/SignatureBatch.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/unit_test.h>
+#include <ed25519-donna/ed25519.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace mtchain {
+
+namespace detail {
+
+// Messages signed by a handful of keys, in the 33 byte PublicKey form
+class SignedMessages
+{
+public:
+    std::vector<Blob> messages;
+    std::vector<Blob> keys;
+    std::vector<Blob> signatures;
+
+    SignedMessages (std::size_t count, std::uint64_t seed)
+    {
+        beast::xor_shift_engine g (seed);
+
+        std::vector<Blob> secrets;
+        std::vector<Blob> publics;
+        for (int i = 0; i < 8; ++i)
+        {
+            Blob sk (32);
+            beast::rngfill (sk.data (), sk.size (), g);
+            Blob pk (33);
+            pk[0] = 0xED;
+            ed25519_publickey (sk.data (), pk.data () + 1);
+            secrets.push_back (std::move (sk));
+            publics.push_back (std::move (pk));
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Blob m (20 + g () % 200);
+            beast::rngfill (m.data (), m.size (), g);
+
+            auto const k = i % secrets.size ();
+            Blob sig (64);
+            ed25519_sign (m.data (), m.size (), secrets[k].data (),
+                publics[k].data () + 1, sig.data ());
+
+            messages.push_back (std::move (m));
+            keys.push_back (publics[k]);
+            signatures.push_back (std::move (sig));
+        }
+    }
+
+    std::vector<Ed25519BatchItem>
+    items () const
+    {
+        std::vector<Ed25519BatchItem> result;
+        for (std::size_t i = 0; i < messages.size (); ++i)
+            result.push_back ({ makeSlice (messages[i]),
+                makeSlice (keys[i]), makeSlice (signatures[i]) });
+        return result;
+    }
+};
+
+} // detail
+
+class SignatureBatch_test : public beast::unit_test::suite
+{
+    static
+    bool
+    single (Ed25519BatchItem const& item)
+    {
+        return ed25519_sign_open (item.message.data (),
+            item.message.size (), item.publicKey.data () + 1,
+            item.signature.data ()) == 0;
+    }
+
+    void
+    testValid ()
+    {
+        testcase ("valid");
+
+        // Below the batching threshold, one batch, and several
+        for (std::size_t count : { 0, 1, 3, 4, 64, 150 })
+        {
+            detail::SignedMessages s (count, count + 1);
+            auto const valid = verifyEd25519Batch (s.items ());
+            BEAST_EXPECT(valid.size () == count);
+            BEAST_EXPECT(std::find (valid.begin (), valid.end (), false) ==
+                valid.end ());
+        }
+    }
+
+    void
+    testInvalid ()
+    {
+        testcase ("invalid");
+
+        detail::SignedMessages s (150, 77);
+
+        // Damage a message, a signature and a key in different batches
+        s.messages[5][0] ^= 1;
+        s.signatures[70][10] ^= 0x40;
+        s.keys[140][7] ^= 2;
+
+        auto const items = s.items ();
+        auto const valid = verifyEd25519Batch (items);
+        for (std::size_t i = 0; i < items.size (); ++i)
+        {
+            if (valid[i] != single (items[i]))
+            {
+                fail ("disagrees with individual verification at " +
+                    std::to_string (i));
+                return;
+            }
+        }
+        BEAST_EXPECT(! valid[5] && ! valid[70] && ! valid[140]);
+        BEAST_EXPECT(valid[4] && valid[69] && valid[141]);
+    }
+
+    void
+    testMalformed ()
+    {
+        testcase ("malformed");
+
+        detail::SignedMessages s (10, 3);
+
+        // Wrong key type and size
+        s.keys[0][0] = 0x02;
+        s.keys[1].pop_back ();
+        s.signatures[2].pop_back ();
+
+        // S + L is an alternate encoding of a valid signature
+        {
+            std::uint8_t const order[32] = {
+                0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58,
+                0xD6, 0x9C, 0xF7, 0xA2, 0xDE, 0xF9, 0xDE, 0x14,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10 };
+            int carry = 0;
+            for (int i = 0; i < 32; ++i)
+            {
+                int const sum = s.signatures[3][32 + i] + order[i] + carry;
+                s.signatures[3][32 + i] = static_cast<std::uint8_t> (sum);
+                carry = sum >> 8;
+            }
+        }
+
+        // A non canonical R
+        std::fill (s.signatures[4].begin (), s.signatures[4].begin () + 32,
+            0xFF);
+        s.signatures[4][31] = 0x7F;
+
+        auto const valid = verifyEd25519Batch (s.items ());
+        for (std::size_t i = 0; i < 5; ++i)
+            BEAST_EXPECT(! valid[i]);
+        for (std::size_t i = 5; i < 10; ++i)
+            BEAST_EXPECT(valid[i]);
+    }
+
+    void
+    testVerifier ()
+    {
+        testcase ("verifier");
+
+        detail::SignedMessages s (20, 11);
+        s.signatures[13][0] ^= 1;
+
+        Ed25519BatchVerifier v (8);
+        std::vector<int> verdicts (20, -1);
+        for (std::size_t i = 0; i < 20; ++i)
+        {
+            v.add (makeSlice (s.messages[i]), makeSlice (s.keys[i]),
+                makeSlice (s.signatures[i]),
+                [&verdicts, i](bool ok) { verdicts[i] = ok; });
+
+            // The caller's copy may go away once queued
+            s.messages[i].clear ();
+        }
+
+        // Two full batches ran, the rest wait for a flush
+        BEAST_EXPECT(v.size () == 4);
+        BEAST_EXPECT(verdicts[15] == 1 && verdicts[16] == -1);
+        v.flush ();
+        BEAST_EXPECT(v.size () == 0);
+
+        for (std::size_t i = 0; i < 20; ++i)
+            BEAST_EXPECT(verdicts[i] == (i == 13 ? 0 : 1));
+    }
+
+    void
+    run ()
+    {
+        testValid ();
+        testInvalid ();
+        testMalformed ();
+        testVerifier ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SignatureBatch,protocol,mtchain);
+
+//------------------------------------------------------------------------------
+
+class SignatureBatch_timing_test : public beast::unit_test::suite
+{
+public:
+    void
+    run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+        using namespace std::chrono;
+
+        detail::SignedMessages s (4096, 1);
+        auto const items = s.items ();
+
+        auto start = clock_type::now ();
+        std::size_t good = 0;
+        for (auto const& item : items)
+        {
+            if (ed25519_sign_open (item.message.data (),
+                    item.message.size (), item.publicKey.data () + 1,
+                    item.signature.data ()) == 0)
+                ++good;
+        }
+        auto const single = duration_cast<milliseconds> (
+            clock_type::now () - start).count ();
+        BEAST_EXPECT(good == items.size ());
+
+        start = clock_type::now ();
+        auto const valid = verifyEd25519Batch (items);
+        auto const batch = duration_cast<milliseconds> (
+            clock_type::now () - start).count ();
+        BEAST_EXPECT(std::find (valid.begin (), valid.end (), false) ==
+            valid.end ());
+
+        log << items.size () << " signatures: individual " << single <<
+            "ms, batched " << batch << "ms" << std::endl;
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SignatureBatch_timing,protocol,mtchain);
+
+} //
@@ -0,0 +1,215 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/SignatureCache.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/unit_test.h>
+#include <vector>
+
+namespace mtchain {
+
+class SignatureCache_test : public beast::unit_test::suite
+{
+    beast::xor_shift_engine g_ {41};
+
+    uint256
+    randomID ()
+    {
+        uint256 id;
+        beast::rngfill (id.data (), id.size (), g_);
+        return id;
+    }
+
+    std::vector<std::uint8_t>
+    randomBytes (std::size_t size)
+    {
+        std::vector<std::uint8_t> v (size);
+        beast::rngfill (v.data (), v.size (), g_);
+        return v;
+    }
+
+    std::vector<std::uint8_t>
+    randomKey ()
+    {
+        auto key = randomBytes (33);
+        key[0] = 0x02;
+        return key;
+    }
+
+    void
+    testBasics ()
+    {
+        testcase ("basics");
+
+        SignatureCache c (100);
+        BEAST_EXPECT(c.capacity () >= 100);
+
+        auto const tx = randomID ();
+        auto const key = randomKey ();
+        auto const other = randomKey ();
+        auto const sig = randomBytes (71);
+
+        auto const contains = [&](uint256 const& id,
+            std::vector<std::uint8_t> const& k)
+        {
+            return c.contains (id, {}, makeSlice (k), makeSlice (sig));
+        };
+
+        BEAST_EXPECT(! contains (tx, key));
+        c.insert (tx, {}, makeSlice (key), makeSlice (sig));
+        c.insert (tx, {}, makeSlice (key), makeSlice (sig));
+        BEAST_EXPECT(contains (tx, key));
+        BEAST_EXPECT(! contains (tx, other));
+        BEAST_EXPECT(! contains (randomID (), key));
+
+        auto stats = c.getStats ();
+        BEAST_EXPECT(stats.size == 1);
+        BEAST_EXPECT(stats.hits == 1);
+        BEAST_EXPECT(stats.misses == 3);
+        BEAST_EXPECT(stats.hitRate () == 0.25);
+
+        c.clear ();
+        BEAST_EXPECT(! contains (tx, key));
+        stats = c.getStats ();
+        BEAST_EXPECT(stats.size == 0);
+        BEAST_EXPECT(stats.misses == 4);
+    }
+
+    struct Signer
+    {
+        std::vector<std::uint8_t> account;
+        std::vector<std::uint8_t> key;
+        std::vector<std::uint8_t> sig;
+    };
+
+    void
+    testMultiSign ()
+    {
+        testcase ("multisign");
+
+        SignatureCache c;
+        auto const tx = randomID ();
+        std::vector<Signer> signers;
+        for (int i = 0; i < 8; ++i)
+            signers.push_back ({ randomBytes (20), randomKey (),
+                randomBytes (71) });
+
+        int checks = 0;
+        auto const checkAll = [&]
+        {
+            bool ok = true;
+            for (auto const& s : signers)
+                ok = c.verify (tx, makeSlice (s.account), makeSlice (s.key),
+                    makeSlice (s.sig), [&checks] { ++checks; return true; })
+                        && ok;
+            return ok;
+        };
+
+        // Relayed by several peers, then applied at consensus
+        for (int i = 0; i < 4; ++i)
+            BEAST_EXPECT(checkAll ());
+        BEAST_EXPECT(checks == 8);
+
+        // A failed check is not remembered
+        Signer const bad { randomBytes (20), randomKey (), randomBytes (71) };
+        BEAST_EXPECT(! c.verify (tx, makeSlice (bad.account),
+            makeSlice (bad.key), makeSlice (bad.sig), [] { return false; }));
+        BEAST_EXPECT(! c.contains (tx, makeSlice (bad.account),
+            makeSlice (bad.key), makeSlice (bad.sig)));
+
+        auto const stats = c.getStats ();
+        BEAST_EXPECT(stats.hits == 24);
+        BEAST_EXPECT(stats.size == 8);
+    }
+
+    void
+    testSharedKey ()
+    {
+        testcase ("shared key");
+
+        // Two Signers entries of one transaction use the same key for
+        // different accounts. Only the first signature is good.
+        SignatureCache c;
+        auto const tx = randomID ();
+        auto const key = randomKey ();
+        Signer const a { randomBytes (20), key, randomBytes (71) };
+        Signer const b { randomBytes (20), key, randomBytes (71) };
+
+        BEAST_EXPECT(c.verify (tx, makeSlice (a.account), makeSlice (a.key),
+            makeSlice (a.sig), [] { return true; }));
+
+        bool checked = false;
+        BEAST_EXPECT(! c.verify (tx, makeSlice (b.account),
+            makeSlice (b.key), makeSlice (b.sig),
+                [&checked] { checked = true; return false; }));
+        BEAST_EXPECT(checked);
+
+        // Nor does the good signature vouch for the other account, or
+        // another signature vouch for the first
+        BEAST_EXPECT(! c.contains (tx, makeSlice (b.account),
+            makeSlice (key), makeSlice (a.sig)));
+        BEAST_EXPECT(! c.contains (tx, makeSlice (a.account),
+            makeSlice (key), makeSlice (b.sig)));
+        BEAST_EXPECT(c.contains (tx, makeSlice (a.account),
+            makeSlice (key), makeSlice (a.sig)));
+    }
+
+    void
+    testBounded ()
+    {
+        testcase ("bounded");
+
+        SignatureCache c (1000);
+        auto const key = randomKey ();
+        auto const sig = randomBytes (71);
+
+        auto const insert = [&](uint256 const& id)
+        {
+            c.insert (id, {}, makeSlice (key), makeSlice (sig));
+        };
+        auto const contains = [&](uint256 const& id)
+        {
+            return c.contains (id, {}, makeSlice (key), makeSlice (sig));
+        };
+
+        std::vector<uint256> ids;
+        for (std::size_t i = 0; i < 10 * c.capacity (); ++i)
+        {
+            ids.push_back (randomID ());
+            insert (ids.back ());
+        }
+
+        BEAST_EXPECT(c.getStats ().size <= c.capacity ());
+
+        // The most recent entry always survives
+        BEAST_EXPECT(contains (ids.back ()));
+
+        std::size_t held = 0;
+        for (auto const& id : ids)
+            held += contains (id);
+        BEAST_EXPECT(held <= c.capacity ());
+        BEAST_EXPECT(held > c.capacity () / 2);
+    }
+
+    void
+    run ()
+    {
+        testBasics ();
+        testMultiSign ();
+        testSharedKey ();
+        testBounded ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SignatureCache,protocol,mtchain);
+
+} //
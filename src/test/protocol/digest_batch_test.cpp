@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/protocol/digest_batch.h>
+#include <mtchain/protocol/digest.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/unit_test.h>
+#include <vector>
+
+namespace mtchain {
+
+class digest_batch_test : public beast::unit_test::suite
+{
+    std::vector<std::vector<std::uint8_t>> data_;
+    std::vector<Slice> messages_;
+
+    static
+    uint256
+    reference (Slice const& s)
+    {
+        sha512_half_hasher h;
+        h (s.data (), s.size ());
+        return static_cast<sha512_half_hasher::result_type>(h);
+    }
+
+    void
+    check (sha512_batch_engine engine, std::size_t count)
+    {
+        std::vector<uint256> digests (count);
+
+        if (! detail::sha512Half_batch (
+                engine, messages_.data (), digests.data (), count))
+            return;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (digests[i] != reference (messages_[i]))
+            {
+                fail (std::string (to_string (engine)) +
+                    ": digest mismatch, batch of " + std::to_string (count));
+                return;
+            }
+        }
+
+        pass ();
+    }
+
+public:
+    digest_batch_test ()
+    {
+        beast::xor_shift_engine g (5813);
+
+        // Sizes around the padding and block boundaries, followed
+        // by inner-node sized payloads and random leaf sizes.
+        std::vector<std::size_t> sizes {
+            0, 1, 31, 32, 111, 112, 113, 127, 128, 129,
+            239, 240, 241, 255, 256, 257, 516, 1000 };
+
+        for (int i = 0; i < 24; ++i)
+            sizes.push_back (4 + 16 * 32);
+
+        for (int i = 0; i < 64; ++i)
+            sizes.push_back (g () % 400);
+
+        for (auto size : sizes)
+        {
+            std::vector<std::uint8_t> v (size);
+            beast::rngfill (v.data (), v.size (), g);
+            data_.push_back (std::move (v));
+        }
+
+        for (auto const& v : data_)
+            messages_.emplace_back (v.data (), v.size ());
+    }
+
+    void
+    testEngines ()
+    {
+        testcase ("engines");
+
+        log << "    best engine: " <<
+            to_string (sha512Half_batch_engine ()) << std::endl;
+
+        for (auto engine : {
+            sha512_batch_engine::scalar,
+            sha512_batch_engine::avx2,
+            sha512_batch_engine::avx512 })
+        {
+            // Partial and full vectors, plus the whole set
+            for (std::size_t count : { 1, 2, 3, 4, 5, 7, 8, 9, 17 })
+                check (engine, count);
+            check (engine, messages_.size ());
+        }
+
+        BEAST_EXPECT(detail::sha512Half_batch (
+            sha512_batch_engine::scalar, nullptr, nullptr, 0));
+    }
+
+    void
+    testDispatch ()
+    {
+        testcase ("dispatch");
+
+        auto const digests = sha512Half_batch (messages_);
+        BEAST_EXPECT(digests.size () == messages_.size ());
+
+        bool same = true;
+        for (std::size_t i = 0; i < digests.size (); ++i)
+            same = same && (digests[i] == reference (messages_[i]));
+        BEAST_EXPECT(same);
+
+        // Repeating the same message must give the same digest in every lane
+        std::vector<Slice> repeated (11, messages_[20]);
+        auto const r = sha512Half_batch (repeated);
+        for (auto const& d : r)
+            BEAST_EXPECT(d == r.front ());
+    }
+
+    void
+    run ()
+    {
+        testEngines ();
+        testDispatch ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(digest_batch,protocol,mtchain);
+
+} //
@@ -10,6 +10,7 @@
 
 #include <BeastConfig.h>
 #include <mtchain/protocol/digest.h>
+#include <mtchain/protocol/digest_batch.h>
 #include <mtchain/beast/utility/rngfill.h>
 #include <mtchain/beast/xor_shift_engine.h>
 #include <mtchain/beast/unit_test.h>
@@ -140,11 +141,67 @@ public:
         pass ();
     }
 
+    // Hash inner-node sized payloads (a prefix plus 16 child
+    // hashes) through each available batch engine.
+    void testSHA512HalfBatch ()
+    {
+        testcase ("SHA512Half batch");
+
+        using namespace std::chrono;
+
+        std::size_t const size = 4 + 16 * 32;
+        std::size_t const count = 65536;
+
+        std::vector<std::uint8_t> buffer (size * count);
+        beast::xor_shift_engine g(6023);
+        beast::rngfill (buffer.data (), buffer.size (), g);
+
+        std::vector<Slice> messages;
+        for (std::size_t i = 0; i != count; ++i)
+            messages.emplace_back (buffer.data () + i * size, size);
+
+        std::vector<uint256> digests (count);
+
+        for (auto engine : {
+            sha512_batch_engine::scalar,
+            sha512_batch_engine::avx2,
+            sha512_batch_engine::avx512 })
+        {
+            if (! detail::sha512Half_batch (engine,
+                    messages.data (), digests.data (), count))
+            {
+                log << "    " << to_string (engine) <<
+                    ": not supported" << std::endl;
+                continue;
+            }
+
+            nanoseconds best = nanoseconds::max ();
+            for (int i = 0; i != 16; ++i)
+            {
+                auto const start = high_resolution_clock::now ();
+                detail::sha512Half_batch (engine,
+                    messages.data (), digests.data (), count);
+                best = std::min<nanoseconds> (best,
+                    high_resolution_clock::now () - start);
+            }
+
+            auto const secs = duration<double>(best).count ();
+            log <<
+                "    " << to_string (engine) << ": " <<
+                static_cast<std::uint64_t>(count / secs) << " hashes/s, " <<
+                static_cast<std::uint64_t>(count * size / secs / 1e6) <<
+                " MB/s" << std::endl;
+        }
+
+        pass ();
+    }
+
     void run ()
     {
         testSHA512 ();
         testSHA256 ();
         testRIPEMD160 ();
+        testSHA512HalfBatch ();
     }
 };
 
@@ -10,12 +10,35 @@
 
 #include <BeastConfig.h>
 #include <mtchain/protocol/types.h>
+#include <mtchain/protocol/AccountIDStringCache.h>
+#include <mtchain/protocol/FastBase58.h>
 #include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
 
 namespace mtchain {
 
 struct types_test : public beast::unit_test::suite
 {
+    static
+    std::vector<AccountID>
+    randomAccounts (std::size_t count)
+    {
+        beast::xor_shift_engine g (2017);
+        std::vector<AccountID> result (count);
+        for (auto& id : result)
+            beast::rngfill (id.data (), id.size (), g);
+
+        // Leading zero bytes encode differently
+        if (count > 1)
+            std::fill (result[1].data (), result[1].data () + 3, 0);
+        return result;
+    }
+
     void
     testAccountID()
     {
@@ -26,10 +49,120 @@ struct types_test : public beast::unit_test::suite
                 *parseBase58<AccountID>(s)) == s);
     }
 
+    void
+    testFastBase58()
+    {
+        testcase ("fast base58");
+
+        auto const s =
+            "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh";
+        auto const id = fastDecodeBase58Token (s, 0);
+        if (BEAST_EXPECT(id.size () == 20))
+            BEAST_EXPECT(fastEncodeBase58Token (0, id.data (), id.size ()) == s);
+
+        // Wrong type, bad checksum, bad character
+        BEAST_EXPECT(fastDecodeBase58Token (s, 28).empty ());
+        BEAST_EXPECT(fastDecodeBase58Token (
+            "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTi", 0).empty ());
+        BEAST_EXPECT(fastDecodeBase58Token (
+            "rHb9CJAWyB4rj91VRWn96DkukG4bwdty0h", 0).empty ());
+
+        // A token must carry a payload, even a single byte
+        std::uint8_t const one = 0x42;
+        BEAST_EXPECT(fastDecodeBase58Token (
+            fastEncodeBase58Token (0, nullptr, 0), 0).empty ());
+        BEAST_EXPECT(fastDecodeBase58Token (
+            fastEncodeBase58Token (0, &one, 1), 0) == "\x42");
+
+        bool same = true;
+        for (auto const& a : randomAccounts (500))
+        {
+            auto const text = fastEncodeBase58Token (0, a.data (), a.size ());
+            same = same && text == toBase58 (a);
+            auto const back = fastDecodeBase58Token (text, 0);
+            same = same && back.size () == a.size () &&
+                std::memcmp (back.data (), a.data (), a.size ()) == 0;
+        }
+        BEAST_EXPECT(same);
+
+        // Other payload sizes, such as 33 byte public keys
+        beast::xor_shift_engine g (58);
+        for (std::size_t size = 0; size <= 40; ++size)
+        {
+            std::string data (size, '\0');
+            beast::rngfill (&data[0], data.size (), g);
+            if (size > 4)
+                data[0] = data[1] = '\0';
+            BEAST_EXPECT(fastDecodeBase58 (
+                fastEncodeBase58 (data.data (), data.size ())) == data);
+        }
+    }
+
+    void
+    testAccountIDStringCache()
+    {
+        testcase ("string cache");
+
+        auto const accounts = randomAccounts (100);
+        AccountIDStringCache cache (64, 4);
+
+        for (int pass = 0; pass < 2; ++pass)
+            for (auto const& a : accounts)
+                BEAST_EXPECT(cache.toBase58 (a) == toBase58 (a));
+        BEAST_EXPECT(cache.size () <= 64);
+
+        // A small working set stays cached
+        auto const hits = cache.hits ();
+        for (int pass = 0; pass < 10; ++pass)
+            for (std::size_t i = 0; i < 8; ++i)
+                cache.toBase58 (accounts[i]);
+        BEAST_EXPECT(cache.hits () >= hits + 72);
+    }
+
+    void
+    testSpeed()
+    {
+        testcase ("base58 speed");
+
+        using clock_type = std::chrono::steady_clock;
+        using namespace std::chrono;
+
+        auto const accounts = randomAccounts (20000);
+        std::size_t chars = 0;
+
+        auto start = clock_type::now ();
+        for (auto const& a : accounts)
+            chars += toBase58 (a).size ();
+        auto const slow = duration_cast<microseconds> (
+            clock_type::now () - start).count ();
+
+        start = clock_type::now ();
+        for (auto const& a : accounts)
+            chars += fastEncodeBase58Token (0, a.data (), a.size ()).size ();
+        auto const fast = duration_cast<microseconds> (
+            clock_type::now () - start).count ();
+
+        // Responses mostly mention a small set of busy accounts
+        AccountIDStringCache cache (1000);
+        start = clock_type::now ();
+        for (std::size_t i = 0; i < accounts.size (); ++i)
+            chars += cache.toBase58 (accounts[i % 1000]).size ();
+        auto const cached = duration_cast<microseconds> (
+            clock_type::now () - start).count ();
+
+        log << accounts.size () << " conversions: toBase58 " << slow <<
+            "us, fast " << fast << "us, cached " << cached << "us" <<
+            std::endl;
+        BEAST_EXPECT(chars > 0);
+    }
+
     void
     run() override
     {
         testAccountID();
+        testFastBase58();
+        testAccountIDStringCache();
+        testSpeed();
     }
 };
 
@@ -0,0 +1,298 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/CompactFullBelowCache.h>
+#include <mtchain/shamap/FullBelowCache.h>
+#include <mtchain/basics/chrono.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <chrono>
+#include <vector>
+
+namespace mtchain {
+namespace tests {
+
+class CompactFullBelowCache_test : public beast::unit_test::suite
+{
+    static
+    uint256
+    makeKey (beast::xor_shift_engine& rng)
+    {
+        uint256 key;
+        beast::rngfill (key.begin (), key.size (), rng);
+        return key;
+    }
+
+public:
+    void
+    testBasics ()
+    {
+        testcase ("basics");
+
+        TestStopwatch clock;
+        CompactFullBelowCache c ("test", clock);
+        beast::xor_shift_engine rng (1);
+
+        BEAST_EXPECT(c.size () == 0);
+        BEAST_EXPECT(c.getGeneration () == 1);
+
+        auto const a = makeKey (rng);
+        auto const b = makeKey (rng);
+
+        BEAST_EXPECT(! c.touch_if_exists (a));
+        c.insert (a);
+        BEAST_EXPECT(c.size () == 1);
+        BEAST_EXPECT(c.touch_if_exists (a));
+        BEAST_EXPECT(! c.touch_if_exists (b));
+
+        // Inserting twice does not count twice
+        c.insert (a);
+        BEAST_EXPECT(c.size () == 1);
+        c.insert (b);
+        BEAST_EXPECT(c.size () == 2);
+        BEAST_EXPECT(c.touch_if_exists (b));
+    }
+
+    void
+    testGenerations ()
+    {
+        testcase ("generations");
+
+        TestStopwatch clock;
+        CompactFullBelowCache c ("test", clock);
+        beast::xor_shift_engine rng (2);
+
+        std::vector<uint256> keys;
+        for (int i = 0; i < 5000; ++i)
+        {
+            keys.push_back (makeKey (rng));
+            c.insert (keys.back ());
+        }
+        BEAST_EXPECT(c.size () == keys.size ());
+        auto const bytes = c.bytes ();
+
+        c.clear ();
+        BEAST_EXPECT(c.getGeneration () == 2);
+        BEAST_EXPECT(c.size () == 0);
+        BEAST_EXPECT(c.bytes () == bytes);
+        for (auto const& k : keys)
+        {
+            if (c.touch_if_exists (k))
+            {
+                fail ("stale entry found");
+                break;
+            }
+        }
+
+        // Stale slots are reused without growing the table
+        for (auto const& k : keys)
+            c.insert (k);
+        BEAST_EXPECT(c.size () == keys.size ());
+        BEAST_EXPECT(c.bytes () == bytes);
+
+        // Half of the keys again in a new generation
+        c.clear ();
+        for (std::size_t i = 0; i < keys.size (); i += 2)
+            c.insert (keys[i]);
+        BEAST_EXPECT(c.size () == keys.size () / 2);
+
+        bool ok = true;
+        for (std::size_t i = 0; i < keys.size (); ++i)
+            ok = ok && (c.touch_if_exists (keys[i]) == (i % 2 == 0));
+        BEAST_EXPECT(ok);
+
+        c.reset ();
+        BEAST_EXPECT(c.getGeneration () == 1);
+        BEAST_EXPECT(c.size () == 0);
+        BEAST_EXPECT(! c.touch_if_exists (keys[0]));
+    }
+
+    void
+    testSweep ()
+    {
+        testcase ("sweep");
+
+        TestStopwatch clock;
+        clock.set (1000);
+        CompactFullBelowCache c ("test", clock,
+            beast::insight::NullCollector::New (), 0, 10);
+        beast::xor_shift_engine rng (3);
+
+        std::vector<uint256> keys;
+        for (int i = 0; i < 100000; ++i)
+        {
+            keys.push_back (makeKey (rng));
+            c.insert (keys.back ());
+        }
+        auto const large = c.bytes ();
+
+        // Keep the first hundred keys alive
+        clock.advance (std::chrono::seconds (6));
+        for (int i = 0; i < 100; ++i)
+            BEAST_EXPECT(c.touch_if_exists (keys[i]));
+
+        clock.advance (std::chrono::seconds (6));
+        c.sweep ();
+        BEAST_EXPECT(c.size () == 100);
+        BEAST_EXPECT(c.bytes () < large);
+
+        bool ok = true;
+        for (std::size_t i = 0; i < keys.size (); ++i)
+            ok = ok && (c.touch_if_exists (keys[i]) == (i < 100));
+        BEAST_EXPECT(ok);
+
+        // Stale generations are dropped by a sweep as well
+        c.clear ();
+        c.sweep ();
+        BEAST_EXPECT(c.size () == 0);
+        BEAST_EXPECT(! c.touch_if_exists (keys[0]));
+    }
+
+    void
+    testGrowth ()
+    {
+        testcase ("growth");
+
+        TestStopwatch clock;
+        CompactFullBelowCache c ("test", clock);
+        beast::xor_shift_engine rng (4);
+
+        std::vector<uint256> keys;
+        for (int i = 0; i < 300000; ++i)
+        {
+            keys.push_back (makeKey (rng));
+            c.insert (keys.back ());
+        }
+        BEAST_EXPECT(c.size () == keys.size ());
+        BEAST_EXPECT(c.bytes () >= keys.size () * 16);
+
+        bool ok = true;
+        for (auto const& k : keys)
+            ok = ok && c.touch_if_exists (k);
+        BEAST_EXPECT(ok);
+
+        // Fresh keys are absent
+        std::size_t found = 0;
+        for (int i = 0; i < 100000; ++i)
+            found += c.touch_if_exists (makeKey (rng)) ? 1 : 0;
+        BEAST_EXPECT(found == 0);
+    }
+
+    void
+    run ()
+    {
+        testBasics ();
+        testGenerations ();
+        testSweep ();
+        testGrowth ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/*  Compares the compact cache with the KeyCache based FullBelowCache on the
+    access pattern of a sync: every inner node is inserted once as its
+    subtree completes, and looked up, hit or miss, as the walk revisits it.
+    Memory for the node based cache is estimated from its node layout.
+*/
+class CompactFullBelowCache_timing_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    template <class Cache>
+    void
+    measure (char const* name, Cache& c,
+        std::vector<uint256> const& present,
+        std::vector<uint256> const& absent)
+    {
+        auto elapsed = [](clock_type::time_point start)
+        {
+            return std::chrono::duration_cast<
+                std::chrono::milliseconds> (clock_type::now () - start).count ();
+        };
+
+        auto start = clock_type::now ();
+        for (auto const& k : present)
+            c.insert (k);
+        auto const insertMs = elapsed (start);
+
+        std::size_t hits = 0;
+        start = clock_type::now ();
+        for (auto const& k : present)
+            hits += c.touch_if_exists (k) ? 1 : 0;
+        for (auto const& k : absent)
+            hits += c.touch_if_exists (k) ? 1 : 0;
+        auto const lookupMs = elapsed (start);
+        BEAST_EXPECT(hits == present.size ());
+
+        start = clock_type::now ();
+        c.clear ();
+        auto const clearMs = elapsed (start);
+        BEAST_EXPECT(c.size () == 0);
+
+        log <<
+            "    " << name << ": insert " << insertMs << "ms, " <<
+            "lookup " << lookupMs << "ms, " <<
+            "clear " << clearMs << "ms" << std::endl;
+    }
+
+public:
+    void
+    run ()
+    {
+        // About the number of inner nodes in a 10M leaf state map
+        std::size_t const count = 700000;
+
+        beast::xor_shift_engine rng (5);
+        std::vector<uint256> present;
+        std::vector<uint256> absent;
+        present.reserve (count);
+        absent.reserve (count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            uint256 key;
+            beast::rngfill (key.begin (), key.size (), rng);
+            present.push_back (key);
+            beast::rngfill (key.begin (), key.size (), rng);
+            absent.push_back (key);
+        }
+
+        TestStopwatch clock;
+
+        testcase ("FullBelowCache");
+        {
+            FullBelowCache c ("full_below", clock);
+            measure ("FullBelowCache", c, present, absent);
+
+            // Key, timestamp and list link per node plus a bucket
+            std::size_t const bytes = count * (sizeof(uint256) +
+                sizeof(clock_type::time_point) + 3 * sizeof(void*));
+            log << "    about " << bytes / (1024 * 1024) << "MB" << std::endl;
+        }
+
+        testcase ("CompactFullBelowCache");
+        {
+            CompactFullBelowCache c ("full_below", clock);
+            for (auto const& k : present)
+                c.insert (k);
+            log << "    " << c.bytes () / (1024 * 1024) << "MB" << std::endl;
+            c.reset ();
+            measure ("CompactFullBelowCache", c, present, absent);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(CompactFullBelowCache,shamap,mtchain);
+BEAST_DEFINE_TESTSUITE_MANUAL(CompactFullBelowCache_timing,shamap,mtchain);
+
+} // tests
+} //
@@ -0,0 +1,214 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/FetchPackStream.h>
+#include <mtchain/protocol/digest.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <functional>
+
+namespace mtchain {
+namespace tests {
+
+class FetchPackStream_test : public beast::unit_test::suite
+{
+    struct Source
+    {
+        uint256 hash;
+        Blob data;
+    };
+
+    static
+    std::vector<Source>
+    makeNodes (std::size_t count, beast::xor_shift_engine& rng)
+    {
+        std::vector<Source> nodes (count);
+        for (auto& n : nodes)
+        {
+            // Sizes of leaf and inner node wire formats
+            n.data.resize ((rng () % 2) ? 40 + rng () % 200 : 513);
+            beast::rngfill (n.data.data (), n.data.size (), rng);
+            n.hash = sha512Half (makeSlice (n.data));
+        }
+        return nodes;
+    }
+
+    void
+    testRoundTrip ()
+    {
+        testcase ("round trip");
+
+        beast::xor_shift_engine rng (1);
+        auto const source = makeNodes (1000, rng);
+
+        FetchPackWriter writer;
+        auto callback = std::ref (writer);
+        for (auto const& n : source)
+            callback (SHAMapHash (n.hash), n.data);
+        BEAST_EXPECT(writer.size () == source.size ());
+        BEAST_EXPECT(! writer.full ());
+
+        auto const pack = writer.release ();
+        BEAST_EXPECT(writer.size () == 0);
+
+        FetchPackReader reader;
+        BEAST_EXPECT(reader.parse (makeSlice (pack)));
+        BEAST_EXPECT(reader.size () == source.size ());
+
+        // Nodes point into the buffer and keep their order
+        bool ok = true;
+        for (std::size_t i = 0; i < source.size (); ++i)
+        {
+            auto const& n = reader.nodes ()[i];
+            ok = ok && n.hash == source[i].hash &&
+                n.data.size () == source[i].data.size () &&
+                n.data.data () >= pack.data () &&
+                n.data.data () < pack.data () + pack.size () &&
+                std::equal (source[i].data.begin (), source[i].data.end (),
+                    n.data.data ());
+        }
+        BEAST_EXPECT(ok);
+
+        BEAST_EXPECT(reader.verify () == 0);
+        BEAST_EXPECT(reader.size () == source.size ());
+
+        ok = true;
+        for (auto const& n : source)
+        {
+            auto const data = reader.find (n.hash);
+            ok = ok && data.size () == n.data.size ();
+        }
+        BEAST_EXPECT(ok);
+
+        uint256 absent;
+        BEAST_EXPECT(reader.find (absent).empty ());
+
+        std::size_t visited = 0;
+        reader.forEach ([&](uint256 const&, Slice) { ++visited; });
+        BEAST_EXPECT(visited == source.size ());
+    }
+
+    void
+    testLimit ()
+    {
+        testcase ("limit");
+
+        beast::xor_shift_engine rng (2);
+        auto const source = makeNodes (100, rng);
+
+        std::size_t const limit = 4096;
+        FetchPackWriter writer (limit);
+        std::size_t added = 0;
+        for (auto const& n : source)
+            added += writer.add (n.hash, makeSlice (n.data)) ? 1 : 0;
+
+        BEAST_EXPECT(writer.full ());
+        BEAST_EXPECT(added == writer.size ());
+        BEAST_EXPECT(added > 0 && added < source.size ());
+        BEAST_EXPECT(writer.data ().size () <= limit);
+
+        FetchPackReader reader;
+        BEAST_EXPECT(reader.parse (writer.data ()));
+        BEAST_EXPECT(reader.size () == added);
+
+        // Called as a fetch pack callback, it reports the same
+        FetchPackWriter callback (limit);
+        std::size_t accepted = 0;
+        for (auto const& n : source)
+            accepted += callback (SHAMapHash (n.hash), n.data) ? 1 : 0;
+        BEAST_EXPECT(callback.full ());
+        BEAST_EXPECT(accepted == added);
+    }
+
+    void
+    testMalformed ()
+    {
+        testcase ("malformed");
+
+        beast::xor_shift_engine rng (3);
+        auto const source = makeNodes (10, rng);
+
+        FetchPackWriter writer;
+        for (auto const& n : source)
+            writer.add (n.hash, makeSlice (n.data));
+        auto pack = writer.release ();
+
+        FetchPackReader reader;
+
+        // Truncated inside a node
+        BEAST_EXPECT(! reader.parse (Slice (pack.data (), pack.size () - 1)));
+        BEAST_EXPECT(reader.size () == 0);
+
+        // Truncated inside a header
+        auto const first = FetchPackWriter::overhead + source[0].data.size ();
+        BEAST_EXPECT(! reader.parse (Slice (pack.data (), first + 10)));
+
+        // A length running past the end
+        pack[32] = 0xff;
+        BEAST_EXPECT(! reader.parse (makeSlice (pack)));
+
+        BEAST_EXPECT(reader.parse (Slice ()));
+        BEAST_EXPECT(reader.size () == 0);
+    }
+
+    void
+    testVerify (std::size_t threads)
+    {
+        testcase ("verify on " + std::to_string (threads) + " threads");
+
+        beast::xor_shift_engine rng (4);
+        auto source = makeNodes (5000, rng);
+
+        // Corrupt every hundredth node and repeat a few
+        std::size_t corrupted = 0;
+        for (std::size_t i = 0; i < source.size (); i += 100)
+        {
+            source[i].data[7] ^= 1;
+            ++corrupted;
+        }
+        for (std::size_t i = 1; i < 50; i += 10)
+            source.push_back (source[i]);
+
+        FetchPackWriter writer;
+        for (auto const& n : source)
+            writer.add (n.hash, makeSlice (n.data));
+
+        FetchPackReader reader;
+        BEAST_EXPECT(reader.parse (writer.data ()));
+        BEAST_EXPECT(reader.verify (threads) == corrupted);
+        BEAST_EXPECT(reader.size () == 5000 - corrupted);
+
+        bool ok = true;
+        for (std::size_t i = 0; i < 5000; ++i)
+        {
+            auto const data = reader.find (source[i].hash);
+            ok = ok && (data.empty () == (i % 100 == 0));
+        }
+        BEAST_EXPECT(ok);
+    }
+
+public:
+    void
+    run ()
+    {
+        testRoundTrip ();
+        testLimit ();
+        testMalformed ();
+        testVerify (1);
+        testVerify (4);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(FetchPackStream,shamap,mtchain);
+
+} // tests
+} //
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/InlineSHAMapItem.h>
+#include <mtchain/basics/Blob.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace mtchain {
+namespace tests {
+
+class InlineSHAMapItem_test : public beast::unit_test::suite
+{
+public:
+    void
+    testItem ()
+    {
+        testcase ("item");
+
+        beast::xor_shift_engine rng (1);
+        uint256 key;
+        beast::rngfill (key.begin (), key.size (), rng);
+        Blob data (150);
+        beast::rngfill (data.data (), data.size (), rng);
+
+        auto const item = InlineSHAMapItem::make (key, makeSlice (data));
+        BEAST_EXPECT(item);
+        BEAST_EXPECT(item->key () == key);
+        BEAST_EXPECT(item->size () == data.size ());
+        BEAST_EXPECT(std::memcmp (item->data (), data.data (),
+            data.size ()) == 0);
+        BEAST_EXPECT(item->slice ().size () == data.size ());
+
+        // The payload follows the header in the same block
+        BEAST_EXPECT(static_cast<std::uint8_t const*> (item->data ()) ==
+            reinterpret_cast<std::uint8_t const*> (item.get ()) +
+                sizeof(InlineSHAMapItem));
+
+        auto const empty = InlineSHAMapItem::make (key, Slice ());
+        BEAST_EXPECT(empty->size () == 0);
+    }
+
+    void
+    testPointer ()
+    {
+        testcase ("pointer");
+
+        uint256 key;
+        key.zero ();
+        Blob data (10, 7);
+
+        InlineSHAMapItem::pointer a = InlineSHAMapItem::make (
+            key, makeSlice (data));
+        auto const raw = a.get ();
+
+        InlineSHAMapItem::pointer b = a;
+        BEAST_EXPECT(b.get () == raw);
+
+        InlineSHAMapItem::pointer c = std::move (b);
+        BEAST_EXPECT(! b);
+        BEAST_EXPECT(c.get () == raw);
+
+        a = InlineSHAMapItem::pointer ();
+        BEAST_EXPECT(! a);
+        BEAST_EXPECT(c->size () == 10);
+
+        // The last reference frees the block for the next item
+        c = InlineSHAMapItem::pointer ();
+        auto const d = InlineSHAMapItem::make (key, makeSlice (data));
+        BEAST_EXPECT(d.get () == raw);
+    }
+
+    void
+    run ()
+    {
+        testItem ();
+        testPointer ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(InlineSHAMapItem,shamap,mtchain);
+
+//------------------------------------------------------------------------------
+
+/*  Builds a state map's worth of leaves both ways and reports heap
+    allocations, bytes and time. The separate layout is what SHAMapItem
+    does today: a shared_ptr made with make_shared holding a key and a
+    Blob. Heap bytes assume 16 bytes of allocator overhead per block and
+    16 byte rounding.
+*/
+class InlineSHAMapItem_timing_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    struct SeparateItem
+    {
+        uint256 key;
+        Blob data;
+
+        SeparateItem (uint256 const& k, Slice s)
+            : key (k)
+            , data (s.data (), s.data () + s.size ())
+        {
+        }
+    };
+
+    static
+    std::size_t
+    heapBytes (std::size_t size)
+    {
+        return ((size + 16 + 15) / 16) * 16;
+    }
+
+public:
+    void
+    run ()
+    {
+        testcase ("leaves");
+
+        std::size_t const count = 1000000;
+
+        // Payload sizes typical of state entries
+        beast::xor_shift_engine rng (2);
+        std::vector<std::uint32_t> sizes (count);
+        for (auto& s : sizes)
+            s = 60 + rng () % 140;
+
+        uint256 key;
+        Blob data (512);
+        beast::rngfill (data.data (), data.size (), rng);
+
+        {
+            std::size_t bytes = 0;
+            auto const start = clock_type::now ();
+            {
+                std::vector<std::shared_ptr<SeparateItem>> items;
+                items.reserve (count);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    beast::rngfill (key.begin (), 8, rng);
+                    items.push_back (std::make_shared<SeparateItem> (
+                        key, Slice (data.data (), sizes[i])));
+                    // Control block and item, then the Blob buffer
+                    bytes += heapBytes (sizeof(SeparateItem) + 16) +
+                        heapBytes (sizes[i]);
+                }
+            }
+            auto const ms = std::chrono::duration_cast<
+                std::chrono::milliseconds> (clock_type::now () - start);
+
+            log <<
+                "    shared_ptr<SHAMapItem>: " << 2 * count <<
+                " allocations, about " << bytes / (1024 * 1024) << "MB, " <<
+                ms.count () << "ms" << std::endl;
+        }
+
+        {
+            auto& allocator = InlineSHAMapItem::allocator ();
+            auto const slabs = allocator.slabs ();
+            auto const reserved = allocator.reserved ();
+            auto const start = clock_type::now ();
+            {
+                std::vector<InlineSHAMapItem::pointer> items;
+                items.reserve (count);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    beast::rngfill (key.begin (), 8, rng);
+                    items.push_back (InlineSHAMapItem::make (
+                        key, Slice (data.data (), sizes[i])));
+                }
+            }
+            auto const ms = std::chrono::duration_cast<
+                std::chrono::milliseconds> (clock_type::now () - start);
+
+            log <<
+                "    InlineSHAMapItem: " <<
+                allocator.slabs () - slabs << " allocations, " <<
+                (allocator.reserved () - reserved) / (1024 * 1024) << "MB, " <<
+                ms.count () << "ms" << std::endl;
+        }
+
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(InlineSHAMapItem_timing,shamap,mtchain);
+
+} // tests
+} //
@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMapBatch.h>
+#include <mtchain/shamap/SHAMap.h>
+#include <mtchain/shamap/SHAMapItem.h>
+#include <test/shamap/common.h>
+#include <mtchain/beast/unit_test.h>
+
+namespace mtchain {
+namespace tests {
+
+class SHAMapBatch_test : public beast::unit_test::suite
+{
+    // Sync a map using batched replies; every node sent must be useful
+    void
+    testSync (std::size_t maxBytes)
+    {
+        testcase ("sync, cap " + std::to_string (maxBytes));
+
+        beast::Journal const j;
+        TestFamily f (j), f2 (j);
+        SHAMap source (SHAMapType::FREE, f, SHAMap::version{2});
+        SHAMap destination (SHAMapType::FREE, f2, SHAMap::version{2});
+
+        for (int i = 0; i < 10000; ++i)
+            source.addItem (std::move (*makeRandomAS ()), false, false);
+        source.setImmutable ();
+
+        destination.setSynching ();
+        {
+            auto const reply = getNodesFat (source,
+                { SHAMapNodeID () }, false, 0);
+            BEAST_EXPECT(reply.ids.size () == 1);
+            BEAST_EXPECT(destination.addRootNode (source.getHash (),
+                makeSlice (reply.nodes.front ()), snfWIRE,
+                    nullptr).isGood ());
+        }
+
+        std::size_t useless = 0;
+        std::size_t truncated = 0;
+        for (;;)
+        {
+            f2.clock ().advance (std::chrono::seconds (1));
+
+            auto const missing = destination.getMissingNodes (2048, nullptr);
+            if (missing.empty ())
+                break;
+
+            std::vector<SHAMapNodeID> wanted;
+            for (auto const& m : missing)
+            {
+                // Ask twice for some to exercise deduplication
+                wanted.push_back (m.first);
+                if (wanted.size () % 3 == 0)
+                    wanted.push_back (m.first);
+            }
+
+            auto const reply = getNodesFat (source, wanted,
+                true, 1, maxBytes);
+            BEAST_EXPECT(reply.ids.size () == reply.nodes.size ());
+            BEAST_EXPECT(reply.missing == 0);
+            BEAST_EXPECT(reply.served != 0);
+            if (reply.truncated)
+                ++truncated;
+
+            // Only a single oversized subtree may pass the cap
+            if (maxBytes != 0 && reply.bytes > maxBytes)
+                BEAST_EXPECT(reply.served == 1);
+
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < reply.ids.size (); ++i)
+            {
+                bytes += reply.nodes[i].size ();
+                if (! destination.addKnownNode (reply.ids[i],
+                        makeSlice (reply.nodes[i]), nullptr).isUseful ())
+                    ++useless;
+            }
+            BEAST_EXPECT(bytes == reply.bytes);
+        }
+
+        destination.clearSynching ();
+
+        BEAST_EXPECT(useless == 0);
+        BEAST_EXPECT(source.deepCompare (destination));
+        if (maxBytes != 0)
+            BEAST_EXPECT(truncated != 0);
+        else
+            BEAST_EXPECT(truncated == 0);
+    }
+
+    void
+    testLimits ()
+    {
+        testcase ("limits");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap source (SHAMapType::FREE, f, SHAMap::version{2});
+        for (int i = 0; i < 1000; ++i)
+            source.addItem (std::move (*makeRandomAS ()), false, false);
+        source.setImmutable ();
+
+        std::vector<SHAMapNodeID> wanted;
+        for (int b = 0; b < 16; ++b)
+            wanted.push_back (SHAMapNodeID ().getChildNodeID (b));
+
+        auto const all = getNodesFat (source, wanted, true, 1);
+        BEAST_EXPECT(! all.truncated);
+        BEAST_EXPECT(all.served == wanted.size ());
+
+        // A tiny cap still serves one request
+        auto const one = getNodesFat (source, wanted, true, 1, 1);
+        BEAST_EXPECT(one.truncated);
+        BEAST_EXPECT(one.served == 1);
+        BEAST_EXPECT(! one.ids.empty ());
+
+        // Serving stops before a subtree which would pass the cap
+        auto const half = getNodesFat (source, wanted, true, 1,
+            all.bytes / 2);
+        BEAST_EXPECT(half.truncated);
+        BEAST_EXPECT(half.bytes <= all.bytes / 2);
+        BEAST_EXPECT(half.served < wanted.size ());
+        BEAST_EXPECT(half.served != 0);
+
+        // Nodes the map does not have are not counted as served
+        {
+            auto deep = SHAMapNodeID ();
+            for (int i = 0; i < 20; ++i)
+                deep = deep.getChildNodeID (0);
+            auto const absent = getNodesFat (source,
+                { deep, wanted.front () }, true, 1);
+            BEAST_EXPECT(absent.missing == 1);
+            BEAST_EXPECT(absent.served == 1);
+        }
+
+        // An expired budget does the same
+        auto const late = getNodesFat (source, wanted, true, 1, 0,
+            std::chrono::nanoseconds (1));
+        BEAST_EXPECT(late.served >= 1);
+
+        // The root's fat reply already covers its children
+        wanted.push_back (SHAMapNodeID ());
+        auto const covered = getNodesFat (source, wanted, false, 1);
+        BEAST_EXPECT(covered.served == wanted.size ());
+        BEAST_EXPECT(covered.ids.size () == 17);
+    }
+
+public:
+    void
+    run ()
+    {
+        testSync (0);
+        testSync (16 * 1024);
+        testLimits ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapBatch,shamap,mtchain);
+
+} // tests
+} //
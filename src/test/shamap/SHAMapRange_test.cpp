@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMapRange.h>
+#include <mtchain/shamap/SHAMap.h>
+#include <test/shamap/common.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace mtchain {
+namespace tests {
+
+class SHAMapRange_test : public beast::unit_test::suite
+{
+    static
+    void
+    fill (SHAMap& map, std::set<uint256>& keys, int count)
+    {
+        beast::xor_shift_engine rng (7);
+        for (int i = 0; i < count; ++i)
+        {
+            uint256 key;
+            beast::rngfill (key.begin (), key.size (), rng);
+            Blob data (8, static_cast<unsigned char> (i));
+            map.addItem (SHAMapItem (key, data), false, false);
+            keys.insert (key);
+        }
+    }
+
+    void
+    testPartition ()
+    {
+        testcase ("partition");
+
+        for (std::size_t count : { 1, 2, 3, 7, 16, 17, 100, 256, 1000 })
+        {
+            auto const ranges = partitionSHAMapKeys (count);
+            BEAST_EXPECT(ranges.size () == count);
+
+            uint256 zero;
+            zero.zero ();
+            uint256 ones;
+            std::fill (ones.begin (), ones.end (), 0xff);
+
+            BEAST_EXPECT(ranges.front ().first == zero);
+            BEAST_EXPECT(ranges.back ().last == ones);
+
+            // Contiguous, with each boundary on a nibble
+            bool ok = true;
+            for (std::size_t i = 0; i < ranges.size (); ++i)
+            {
+                auto const& r = ranges[i];
+                ok = ok && ! (r.last < r.first);
+                if (i + 1 == ranges.size ())
+                    continue;
+                uint256 next = r.last;
+                ++next;
+                ok = ok && next == ranges[i + 1].first;
+                ok = ok && *(r.last.end () - 1) == 0xff;
+            }
+            BEAST_EXPECT(ok);
+        }
+
+        BEAST_EXPECT(partitionSHAMapKeys (0).size () == 1);
+        BEAST_EXPECT(partitionSHAMapKeys (1000000).size () == 65536);
+    }
+
+    void
+    testRanges ()
+    {
+        testcase ("ranges");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::FREE, f, SHAMap::version{2});
+        std::set<uint256> keys;
+        fill (map, keys, 5000);
+        map.setImmutable ();
+
+        for (std::size_t count : { 1, 5, 16, 50 })
+        {
+            std::vector<uint256> seen;
+            for (auto const& r : partitionSHAMapKeys (count))
+            {
+                auto const marker = visitLeavesInRange (map, r, boost::none,
+                    [&](SHAMapItem const& item)
+                    {
+                        if (! r.contains (item.key ()))
+                            fail ("key outside of range");
+                        seen.push_back (item.key ());
+                        return true;
+                    });
+                BEAST_EXPECT(! marker);
+            }
+
+            // Every key once, in order
+            BEAST_EXPECT(std::equal (seen.begin (), seen.end (),
+                keys.begin (), keys.end ()));
+        }
+    }
+
+    void
+    testMarker ()
+    {
+        testcase ("marker");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::FREE, f, SHAMap::version{2});
+        std::set<uint256> keys;
+        fill (map, keys, 1000);
+        map.setImmutable ();
+
+        // Page through one range 64 leaves at a time
+        auto const range = partitionSHAMapKeys (4)[1];
+        std::vector<uint256> seen;
+        boost::optional<uint256> marker;
+        std::size_t pages = 0;
+        do
+        {
+            std::size_t n = 0;
+            marker = visitLeavesInRange (map, range, marker,
+                [&](SHAMapItem const& item)
+                {
+                    seen.push_back (item.key ());
+                    return ++n < 64;
+                });
+            ++pages;
+        }
+        while (marker);
+
+        std::vector<uint256> expected;
+        for (auto const& k : keys)
+        {
+            if (range.contains (k))
+                expected.push_back (k);
+        }
+        BEAST_EXPECT(seen == expected);
+        BEAST_EXPECT(pages == expected.size () / 64 + 1);
+
+        // A marker past the range visits nothing
+        BEAST_EXPECT(! visitLeavesInRange (map, range, range.last,
+            [&](SHAMapItem const&)
+            {
+                fail ("visited past the marker");
+                return true;
+            }));
+    }
+
+    void
+    testParallel ()
+    {
+        testcase ("parallel");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::FREE, f, SHAMap::version{2});
+        std::set<uint256> keys;
+        fill (map, keys, 5000);
+        map.setImmutable ();
+
+        for (std::size_t threads : { 1, 4 })
+        {
+            std::mutex mutex;
+            std::set<uint256> seen;
+            std::atomic<std::size_t> visits {0};
+
+            visitLeavesParallel (map, threads,
+                [&](SHAMapItem const& item)
+                {
+                    ++visits;
+                    std::lock_guard<std::mutex> lock (mutex);
+                    seen.insert (item.key ());
+                });
+
+            BEAST_EXPECT(visits == keys.size ());
+            BEAST_EXPECT(seen == keys);
+        }
+    }
+
+    void
+    testParallelThrows ()
+    {
+        testcase ("parallel, throwing");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::FREE, f, SHAMap::version{2});
+        std::set<uint256> keys;
+        fill (map, keys, 5000);
+        map.setImmutable ();
+
+        for (std::size_t threads : { 1, 4 })
+        {
+            std::atomic<std::size_t> visits {0};
+            bool caught = false;
+            try
+            {
+                visitLeavesParallel (map, threads,
+                    [&](SHAMapItem const&)
+                    {
+                        if (++visits == 100)
+                            Throw<std::runtime_error> ("visit failed");
+                    });
+            }
+            catch (std::runtime_error const& e)
+            {
+                caught = e.what () == std::string ("visit failed");
+            }
+
+            // The caller gets the exception and the visit stops early
+            BEAST_EXPECT(caught);
+            BEAST_EXPECT(visits < keys.size ());
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        testPartition ();
+        testRanges ();
+        testMarker ();
+        testParallel ();
+        testParallelThrows ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapRange,shamap,mtchain);
+
+} // tests
+} //
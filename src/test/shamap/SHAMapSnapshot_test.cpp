@@ -0,0 +1,305 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMapSnapshot.h>
+#include <mtchain/basics/Blob.h>
+#include <mtchain/beast/unit_test.h>
+#include <mtchain/beast/utility/temp_dir.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/utility/rngfill.h>
+#include <fstream>
+#include <functional>
+#include <map>
+
+namespace mtchain {
+namespace tests {
+
+class SHAMapSnapshot_test : public beast::unit_test::suite
+{
+    using Leaves = std::map<uint256, Blob>;
+
+    static
+    Leaves
+    makeLeaves (std::size_t count, beast::xor_shift_engine& rng)
+    {
+        Leaves leaves;
+        while (leaves.size () < count)
+        {
+            uint256 key;
+            beast::rngfill (key.begin (), key.size (), rng);
+            Blob data (20 + rng () % 180);
+            beast::rngfill (data.data (), data.size (), rng);
+            leaves.emplace (key, std::move (data));
+        }
+        return leaves;
+    }
+
+    // The prefix of a key at a depth, with the bits below it zero
+    static
+    uint256
+    prefixOf (uint256 key, int depth)
+    {
+        auto p = key.begin ();
+        for (int i = 0; i < 32; ++i, ++p)
+        {
+            if (2 * i + 1 == depth)
+                *p &= 0xf0;
+            else if (2 * i >= depth)
+                *p = 0;
+        }
+        return key;
+    }
+
+    static
+    void
+    write (std::string const& path, Leaves const& leaves, uint256 const& root)
+    {
+        SHAMapSnapshotWriter w (path, 42, root);
+        for (auto const& l : leaves)
+            w.addLeaf (l.first, makeSlice (l.second));
+
+        // Stand-in inner nodes: one per depth 1 and depth 2 branch
+        for (int depth = 1; depth <= 2; ++depth)
+        {
+            for (int b = 0; b < (depth == 1 ? 16 : 256); ++b)
+            {
+                uint256 prefix;
+                prefix.zero ();
+                *prefix.begin () = static_cast<std::uint8_t> (
+                    depth == 1 ? b << 4 : b);
+                uint256 hash;
+                std::fill (hash.begin (), hash.end (),
+                    static_cast<std::uint8_t> (depth + b));
+                w.addInner (depth, prefix, hash);
+            }
+        }
+        w.finish ();
+    }
+
+    void
+    testRoundTrip ()
+    {
+        testcase ("round trip");
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("state.snap");
+        beast::xor_shift_engine rng (1);
+        auto const leaves = makeLeaves (5000, rng);
+        uint256 root;
+        std::fill (root.begin (), root.end (), 0xab);
+
+        write (path, leaves, root);
+
+        SHAMapSnapshot s (path);
+        BEAST_EXPECT(s.ledgerSeq () == 42);
+        BEAST_EXPECT(s.rootHash () == root);
+        BEAST_EXPECT(s.leafCount () == leaves.size ());
+        BEAST_EXPECT(s.innerCount () == 16 + 256);
+        BEAST_EXPECT(s.verify ());
+
+        bool ok = true;
+        for (auto const& l : leaves)
+        {
+            auto const data = s.findLeaf (l.first);
+            ok = ok && data && data->size () == l.second.size () &&
+                std::equal (l.second.begin (), l.second.end (),
+                    data->data ());
+        }
+        BEAST_EXPECT(ok);
+
+        // In key order
+        auto it = leaves.begin ();
+        ok = true;
+        s.forEachLeaf ([&](uint256 const& key, Slice data)
+            {
+                ok = ok && it != leaves.end () && key == it->first &&
+                    data.size () == it->second.size ();
+                ++it;
+            });
+        BEAST_EXPECT(ok && it == leaves.end ());
+
+        uint256 absent;
+        absent.zero ();
+        BEAST_EXPECT(! s.findLeaf (absent));
+
+        auto const key = leaves.begin ()->first;
+        auto const inner = s.findInner (2, prefixOf (key, 2));
+        BEAST_EXPECT(inner && *inner->begin () ==
+            static_cast<std::uint8_t> (2 + *key.begin ()));
+        BEAST_EXPECT(s.findInner (1, prefixOf (key, 1)));
+        BEAST_EXPECT(! s.findInner (3, prefixOf (key, 3)));
+
+        try
+        {
+            s.leaf (leaves.size ());
+            fail ();
+        }
+        catch (std::out_of_range const&)
+        {
+            pass ();
+        }
+    }
+
+    void
+    testEmpty ()
+    {
+        testcase ("empty");
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("empty.snap");
+        uint256 root;
+        root.zero ();
+        {
+            SHAMapSnapshotWriter w (path, 1, root);
+            w.finish ();
+        }
+
+        SHAMapSnapshot s (path);
+        BEAST_EXPECT(s.leafCount () == 0);
+        BEAST_EXPECT(s.innerCount () == 0);
+        BEAST_EXPECT(s.verify ());
+        BEAST_EXPECT(! s.findLeaf (root));
+        BEAST_EXPECT(! s.findInner (0, root));
+    }
+
+    void
+    testOrder ()
+    {
+        testcase ("order");
+
+        beast::temp_dir dir;
+        uint256 a, b;
+        a.zero ();
+        b.zero ();
+        *b.begin () = 1;
+
+        auto expectLogicError = [this](std::function<void()> f)
+        {
+            try
+            {
+                f ();
+                fail ();
+            }
+            catch (std::logic_error const&)
+            {
+                pass ();
+            }
+        };
+
+        SHAMapSnapshotWriter w (dir.file ("order.snap"), 1, a);
+        w.addLeaf (b, Slice ());
+        expectLogicError ([&] { w.addLeaf (a, Slice ()); });
+        expectLogicError ([&] { w.addLeaf (b, Slice ()); });
+
+        w.addInner (1, b, a);
+        expectLogicError ([&] { w.addInner (1, a, a); });
+        expectLogicError ([&] { w.addLeaf (b, Slice ()); });
+        w.addInner (2, a, a);
+        w.finish ();
+        expectLogicError ([&] { w.finish (); });
+    }
+
+    void
+    testCorruption ()
+    {
+        testcase ("corruption");
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("bad.snap");
+        beast::xor_shift_engine rng (2);
+        auto const leaves = makeLeaves (100, rng);
+        uint256 root;
+        root.zero ();
+        write (path, leaves, root);
+
+        Blob contents;
+        {
+            std::ifstream in (path, std::ios::binary);
+            contents.assign (std::istreambuf_iterator<char> (in),
+                std::istreambuf_iterator<char> ());
+        }
+
+        auto rewrite = [&](Blob const& b)
+        {
+            std::ofstream out (path, std::ios::binary | std::ios::trunc);
+            out.write (reinterpret_cast<char const*> (b.data ()), b.size ());
+        };
+
+        auto expectMalformed = [&]
+        {
+            try
+            {
+                SHAMapSnapshot s (path);
+                fail ();
+            }
+            catch (std::runtime_error const&)
+            {
+                pass ();
+            }
+        };
+
+        // A flipped data bit is caught by the checksum
+        {
+            auto b = contents;
+            b[200] ^= 1;
+            rewrite (b);
+            SHAMapSnapshot s (path);
+            BEAST_EXPECT(! s.verify ());
+        }
+
+        // So are header fields which still look well formed
+        for (std::size_t offset : { 12, 16, 47 })
+        {
+            auto b = contents;
+            b[offset] ^= 1;
+            rewrite (b);
+            SHAMapSnapshot s (path);
+            BEAST_EXPECT(! s.verify ());
+        }
+
+        // Truncation and bad headers are caught when mapping
+        {
+            rewrite (Blob (contents.begin (), contents.end () - 1));
+            expectMalformed ();
+        }
+        {
+            auto b = contents;
+            b[0] = 'X';
+            rewrite (b);
+            expectMalformed ();
+        }
+        {
+            auto b = contents;
+            b[48] ^= 1;
+            rewrite (b);
+            expectMalformed ();
+        }
+        {
+            rewrite (Blob (10, 0));
+            expectMalformed ();
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        testRoundTrip ();
+        testEmpty ();
+        testOrder ();
+        testCorruption ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapSnapshot,shamap,mtchain);
+
+} // tests
+} //
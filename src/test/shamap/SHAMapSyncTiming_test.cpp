@@ -0,0 +1,283 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SHAMap.h>
+#include <mtchain/shamap/SHAMapItem.h>
+#include <test/shamap/common.h>
+#include <mtchain/beast/unit_test.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace mtchain {
+namespace tests {
+
+/*  Measures how long it takes to acquire a SHAMap from a peer whose
+    replies arrive after a fixed round-trip delay.
+
+    The "strict" schedule is the one used by the sync test and by ledger
+    acquisition: ask for up to 2048 missing nodes, wait for all of them,
+    add them, repeat. It is bound by the number of round trips. The
+    pipelined schedules keep several smaller requests in flight and ask
+    for newly discovered frontier nodes as soon as any reply is added.
+*/
+class SHAMapSyncTiming_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    struct Request
+    {
+        clock_type::time_point due;
+        std::vector<SHAMapNodeID> ids;
+    };
+
+    struct Response
+    {
+        std::vector<SHAMapNodeID> requested;
+        std::vector<SHAMapNodeID> ids;
+        std::vector<Blob> nodes;
+    };
+
+    // Serves getNodeFat requests from a source map once their
+    // round-trip delay has elapsed. Requests in flight overlap.
+    class Peer
+    {
+        SHAMap const& map_;
+        std::chrono::milliseconds const latency_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::deque<Request> requests_;
+        std::deque<Response> responses_;
+        bool stop_ = false;
+        std::thread thread_;
+
+        void
+        serve ()
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            for (;;)
+            {
+                cond_.wait (lock,
+                    [this] { return stop_ || ! requests_.empty (); });
+                if (stop_)
+                    return;
+
+                auto const due = requests_.front ().due;
+                if (cond_.wait_until (lock, due, [this] { return stop_; }))
+                    return;
+
+                auto request = std::move (requests_.front ());
+                requests_.pop_front ();
+                lock.unlock ();
+
+                Response response;
+                for (auto const& id : request.ids)
+                    map_.getNodeFat (id,
+                        response.ids, response.nodes, true, 1);
+                response.requested = std::move (request.ids);
+
+                lock.lock ();
+                responses_.push_back (std::move (response));
+                cond_.notify_all ();
+            }
+        }
+
+    public:
+        Peer (SHAMap const& map, std::chrono::milliseconds latency)
+            : map_ (map)
+            , latency_ (latency)
+            , thread_ (&Peer::serve, this)
+        {
+        }
+
+        ~Peer ()
+        {
+            {
+                std::lock_guard<std::mutex> lock (mutex_);
+                stop_ = true;
+            }
+            cond_.notify_all ();
+            thread_.join ();
+        }
+
+        void
+        send (std::vector<SHAMapNodeID> ids)
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            requests_.push_back (
+                { clock_type::now () + latency_, std::move (ids) });
+            cond_.notify_all ();
+        }
+
+        Response
+        receive ()
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            cond_.wait (lock, [this] { return ! responses_.empty (); });
+            auto response = std::move (responses_.front ());
+            responses_.pop_front ();
+            return response;
+        }
+    };
+
+    struct Result
+    {
+        std::chrono::milliseconds elapsed;
+        std::size_t requests = 0;
+        std::size_t nodes = 0;
+    };
+
+    Result
+    sync (SHAMap& source, SHAMap::version v,
+        std::chrono::milliseconds latency,
+        std::size_t window, std::size_t batch)
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap destination (SHAMapType::FREE, f, v);
+        destination.setSynching ();
+
+        {
+            std::vector<SHAMapNodeID> ids;
+            std::vector<Blob> nodes;
+            BEAST_EXPECT(source.getNodeFat (
+                SHAMapNodeID (), ids, nodes, false, 0));
+            BEAST_EXPECT(destination.addRootNode (
+                source.getHash (), makeSlice (nodes.front ()),
+                snfWIRE, nullptr).isGood ());
+        }
+
+        Result result;
+        std::set<SHAMapNodeID> outstanding;
+        std::size_t inFlight = 0;
+        std::size_t invalid = 0;
+
+        auto const start = clock_type::now ();
+        {
+            Peer peer (source, latency);
+
+            for (;;)
+            {
+                // Keep the pipeline full with nodes not yet asked for
+                while (inFlight < window)
+                {
+                    std::vector<SHAMapNodeID> ids;
+                    for (auto const& m :
+                        destination.getMissingNodes (2048, nullptr))
+                    {
+                        if (! outstanding.insert (m.first).second)
+                            continue;
+                        ids.push_back (m.first);
+                        if (ids.size () == batch)
+                            break;
+                    }
+
+                    if (ids.empty ())
+                        break;
+
+                    peer.send (std::move (ids));
+                    ++inFlight;
+                    ++result.requests;
+                }
+
+                if (inFlight == 0)
+                    break;
+
+                auto const response = peer.receive ();
+                --inFlight;
+
+                f.clock().advance(std::chrono::seconds(1));
+
+                for (std::size_t i = 0; i < response.ids.size (); ++i)
+                {
+                    if (destination.addKnownNode (response.ids[i],
+                            makeSlice (response.nodes[i]),
+                            nullptr).isInvalid ())
+                        ++invalid;
+                }
+                result.nodes += response.ids.size ();
+
+                for (auto const& id : response.requested)
+                    outstanding.erase (id);
+            }
+        }
+        result.elapsed = std::chrono::duration_cast<
+            std::chrono::milliseconds>(clock_type::now () - start);
+
+        destination.clearSynching ();
+
+        BEAST_EXPECT(invalid == 0);
+        BEAST_EXPECT(source.deepCompare (destination));
+
+        return result;
+    }
+
+    void
+    run (SHAMap::version v, int items)
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap source (SHAMapType::FREE, f, v);
+
+        for (int i = 0; i < items; ++i)
+            source.addItem (std::move (*makeRandomAS ()), false, false);
+        source.setImmutable ();
+
+        struct Schedule
+        {
+            char const* name;
+            std::size_t window;
+            std::size_t batch;
+        };
+
+        Schedule const schedules[] = {
+            { "strict",       1, 2048 },
+            { "pipelined x4", 4,  256 },
+            { "pipelined x8", 8,  128 },
+        };
+
+        for (auto latency : { 0, 25, 100 })
+        {
+            for (auto const& s : schedules)
+            {
+                auto const r = sync (source, v,
+                    std::chrono::milliseconds (latency), s.window, s.batch);
+
+                log <<
+                    "    " << latency << "ms " << s.name << ": " <<
+                    r.elapsed.count () << "ms, " <<
+                    r.requests << " requests, " <<
+                    r.nodes << " nodes" << std::endl;
+            }
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        int const items = 50000;
+
+        testcase ("version 1");
+        run (SHAMap::version{1}, items);
+
+        testcase ("version 2");
+        run (SHAMap::version{2}, items);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapSyncTiming,shamap,mtchain);
+
+} // tests
+} //
@@ -22,17 +22,6 @@ namespace tests {
 class sync_test : public beast::unit_test::suite
 {
 public:
-    static std::shared_ptr<SHAMapItem> makeRandomAS ()
-    {
-        Serializer s;
-
-        for (int d = 0; d < 3; ++d)
-            s.add32 (rand_int<std::uint32_t>());
-
-        return std::make_shared<SHAMapItem>(
-            s.getSHA512Half(), s.peekData ());
-    }
-
     bool confuseMap (SHAMap& map, int count)
     {
         // add a bunch of random states to a map, then remove them
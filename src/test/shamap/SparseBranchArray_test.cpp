@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of mtchaind: https://github.com/MTChain/MTChain-core
+    Copyright (c) 2017, 2018 MTChain Alliance.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <mtchain/shamap/SparseBranchArray.h>
+#include <mtchain/basics/base_uint.h>
+#include <mtchain/beast/xor_shift_engine.h>
+#include <mtchain/beast/unit_test.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace mtchain {
+namespace tests {
+
+class SparseBranchArray_test : public beast::unit_test::suite
+{
+    using Child = std::shared_ptr<int>;
+    using Branches = SparseBranchArray<uint256, Child>;
+
+    struct Reference
+    {
+        std::array<uint256, 16> hashes;
+        std::array<Child, 16> children;
+    };
+
+    static
+    uint256
+    makeHash (int v)
+    {
+        uint256 h;
+        *h.begin () = static_cast<std::uint8_t>(v);
+        *(h.end () - 1) = static_cast<std::uint8_t>(v >> 8);
+        return h;
+    }
+
+    bool
+    same (Branches const& b, Reference const& r)
+    {
+        int populated = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (b.hash (i) != r.hashes[i] || b.child (i) != r.children[i])
+                return false;
+            if (b.isEmptyBranch (i) != r.hashes[i].isZero ())
+                return false;
+            if (! r.hashes[i].isZero ())
+                ++populated;
+        }
+
+        int visited = 0;
+        int last = -1;
+        bool ordered = true;
+        b.forEach ([&](int branch, uint256 const& hash, Child const& child)
+            {
+                ordered = ordered && branch > last &&
+                    hash == r.hashes[branch] && child == r.children[branch];
+                last = branch;
+                ++visited;
+            });
+
+        return ordered && visited == populated && b.count () == populated;
+    }
+
+    void
+    testLayouts ()
+    {
+        testcase ("layouts");
+
+        Branches b;
+        BEAST_EXPECT(b.empty ());
+        BEAST_EXPECT(b.capacity () == 0);
+        BEAST_EXPECT(b.bytes () == 0);
+        BEAST_EXPECT(b.hash (3).isZero ());
+        BEAST_EXPECT(b.child (3) == nullptr);
+
+        // Fill from the top branch down, so every insert shifts
+        std::vector<std::size_t> capacities;
+        for (int i = 15; i >= 0; --i)
+        {
+            b.set (i, makeHash (i + 1), std::make_shared<int>(i));
+            capacities.push_back (b.capacity ());
+        }
+
+        std::vector<std::size_t> const expected {
+            2, 2, 4, 4, 6, 6, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16 };
+        BEAST_EXPECT(capacities == expected);
+        BEAST_EXPECT(b.isDense ());
+        BEAST_EXPECT(b.count () == 16);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            BEAST_EXPECT(b.hash (i) == makeHash (i + 1));
+            BEAST_EXPECT(*b.child (i) == i);
+        }
+
+        auto const denseBytes = b.bytes ();
+
+        // Empty it again and watch it shrink back to nothing
+        for (int i = 0; i < 16; ++i)
+            b.clear (i);
+        BEAST_EXPECT(b.empty ());
+        BEAST_EXPECT(b.capacity () == 0);
+
+        // A sparse node uses a fraction of the dense storage
+        Branches sparse;
+        sparse.set (4, makeHash (1));
+        sparse.set (9, makeHash (2));
+        BEAST_EXPECT(! sparse.isDense ());
+        BEAST_EXPECT(sparse.bytes () * 8 == denseBytes);
+    }
+
+    void
+    testHysteresis ()
+    {
+        testcase ("hysteresis");
+
+        Branches b;
+        for (int i = 0; i < 7; ++i)
+            b.set (i, makeHash (i + 1));
+        BEAST_EXPECT(b.isDense ());
+
+        // Moving between 6 and 7 branches keeps the full layout
+        bool dense = true;
+        for (int n = 0; n < 10; ++n)
+        {
+            b.clear (6);
+            dense = dense && b.isDense ();
+            b.set (6, makeHash (7));
+            dense = dense && b.isDense ();
+        }
+        BEAST_EXPECT(dense);
+
+        // It is only given up with room to spare
+        b.clear (6);
+        b.clear (5);
+        BEAST_EXPECT(b.isDense ());
+        b.clear (4);
+        BEAST_EXPECT(b.capacity () == 6);
+        b.clear (3);
+        BEAST_EXPECT(b.capacity () == 6);
+        b.clear (2);
+        BEAST_EXPECT(b.capacity () == 4);
+        b.clear (1);
+        BEAST_EXPECT(b.capacity () == 4);
+        b.clear (0);
+        BEAST_EXPECT(b.capacity () == 0);
+    }
+
+    void
+    testHashOrder ()
+    {
+        testcase ("hash order");
+
+        // Sparse and dense layouts present identical 16-hash sequences
+        Branches sparse;
+        sparse.set (1, makeHash (7));
+        sparse.set (12, makeHash (9));
+
+        Branches dense;
+        for (int i = 0; i < 16; ++i)
+            dense.set (i, makeHash (100 + i));
+        for (int i = 0; i < 16; ++i)
+            if (i != 1 && i != 12)
+                dense.clear (i);
+        dense.set (1, makeHash (7));
+        dense.set (12, makeHash (9));
+
+        std::vector<uint256> a, b;
+        sparse.forEachHash ([&](uint256 const& h) { a.push_back (h); });
+        dense.forEachHash ([&](uint256 const& h) { b.push_back (h); });
+
+        BEAST_EXPECT(a.size () == 16);
+        BEAST_EXPECT(a == b);
+        BEAST_EXPECT(a[1] == makeHash (7));
+        BEAST_EXPECT(a[12] == makeHash (9));
+        BEAST_EXPECT(a[0].isZero ());
+    }
+
+    void
+    testRandom ()
+    {
+        testcase ("random");
+
+        beast::xor_shift_engine g (7);
+        Branches b;
+        Reference r;
+        bool ok = true;
+
+        for (int i = 0; i < 20000 && ok; ++i)
+        {
+            int const branch = static_cast<int>(g () % 16);
+            // Bias towards removal when nearly full, to cross the
+            // promotion boundary in both directions repeatedly.
+            bool const add = (g () % 16) >= static_cast<unsigned>(b.count ());
+
+            if (add)
+            {
+                auto const h = makeHash (i + 1);
+                auto c = std::make_shared<int>(i);
+                b.set (branch, h, c);
+                r.hashes[branch] = h;
+                r.children[branch] = c;
+            }
+            else
+            {
+                b.clear (branch);
+                r.hashes[branch].zero ();
+                r.children[branch].reset ();
+            }
+
+            ok = same (b, r);
+
+            if (ok && (i % 97) == 0)
+            {
+                Branches copy (b);
+                ok = same (copy, r);
+                Branches moved (std::move (copy));
+                ok = ok && same (moved, r);
+            }
+        }
+
+        BEAST_EXPECT(ok);
+    }
+
+    void
+    testErrors ()
+    {
+        testcase ("errors");
+
+        Branches b;
+        try
+        {
+            b.set (16, makeHash (1));
+            fail ("expected out_of_range");
+        }
+        catch (std::out_of_range const&)
+        {
+            pass ();
+        }
+
+        try
+        {
+            b.setChild (3, std::make_shared<int>(3));
+            fail ("expected logic_error");
+        }
+        catch (std::logic_error const&)
+        {
+            pass ();
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        testLayouts ();
+        testHysteresis ();
+        testHashOrder ();
+        testRandom ();
+        testErrors ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SparseBranchArray,shamap,mtchain);
+
+} // tests
+} //
@@ -18,6 +18,9 @@
 #include <mtchain/shamap/FullBelowCache.h>
 #include <mtchain/shamap/TreeNodeCache.h>
 #include <mtchain/shamap/SHAMap.h>
+#include <mtchain/shamap/SHAMapItem.h>
+#include <mtchain/basics/random.h>
+#include <mtchain/protocol/Serializer.h>
 #include <mtchain/basics/StringUtilities.h>
 #include <mtchain/nodestore/DummyScheduler.h>
 #include <mtchain/nodestore/Manager.h>
@@ -111,6 +114,20 @@ public:
     }
 };
 
+// An item of random data, keyed by its hash
+inline
+std::shared_ptr<SHAMapItem>
+makeRandomAS ()
+{
+    Serializer s;
+
+    for (int d = 0; d < 3; ++d)
+        s.add32 (rand_int<std::uint32_t>());
+
+    return std::make_shared<SHAMapItem>(
+        s.getSHA512Half(), s.peekData ());
+}
+
 } // tests
 } //
 
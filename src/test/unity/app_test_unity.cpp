@@ -24,7 +24,9 @@
 #include <test/app/OfferStream_test.cpp>
 #include <test/app/Offer_test.cpp>
 #include <test/app/OversizeMeta_test.cpp>
+#include <test/app/ParallelPathSearch_test.cpp>
 #include <test/app/Path_test.cpp>
+#include <test/app/PathRequestTracker_test.cpp>
 #include <test/app/PayChan_test.cpp>
 #include <test/app/Regression_test.cpp>
 #include <test/app/SetAuth_test.cpp>
@@ -11,8 +11,13 @@
 
 #include <test/ledger/BookDirs_test.cpp>
 #include <test/ledger/Directory_test.cpp>
+#include <test/ledger/FlatDeferredCredits_test.cpp>
+#include <test/ledger/FundsCache_test.cpp>
+#include <test/ledger/OrderBookIndex_test.cpp>
 #include <test/ledger/PaymentSandbox_test.cpp>
 #include <test/ledger/PendingSaves_test.cpp>
 #include <test/ledger/SHAMapV2_test.cpp>
 #include <test/ledger/SkipList_test.cpp>
+#include <test/ledger/SpeculativeApply_test.cpp>
+#include <test/ledger/StrandCache_test.cpp>
 #include <test/ledger/View_test.cpp>
@@ -11,13 +11,17 @@
 
 #include <test/protocol/BuildInfo_test.cpp>
 #include <test/protocol/digest_test.cpp>
+#include <test/protocol/digest_batch_test.cpp>
 #include <test/protocol/InnerObjectFormats_test.cpp>
 #include <test/protocol/IOUAmount_test.cpp>
 #include <test/protocol/Issue_test.cpp>
 #include <test/protocol/PublicKey_test.cpp>
 #include <test/protocol/Quality_test.cpp>
+#include <test/protocol/Secp256k1VerifyPool_test.cpp>
 #include <test/protocol/SecretKey_test.cpp>
 #include <test/protocol/Seed_test.cpp>
+#include <test/protocol/SignatureBatch_test.cpp>
+#include <test/protocol/SignatureCache_test.cpp>
 #include <test/protocol/STAccount_test.cpp>
 #include <test/protocol/STAmount_test.cpp>
 #include <test/protocol/STObject_test.cpp>
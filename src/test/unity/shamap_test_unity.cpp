@@ -9,6 +9,14 @@
 */
 //==============================================================================
 
+#include <test/shamap/CompactFullBelowCache_test.cpp>
 #include <test/shamap/FetchPack_test.cpp>
+#include <test/shamap/FetchPackStream_test.cpp>
+#include <test/shamap/InlineSHAMapItem_test.cpp>
+#include <test/shamap/SHAMapBatch_test.cpp>
+#include <test/shamap/SHAMapRange_test.cpp>
+#include <test/shamap/SHAMapSnapshot_test.cpp>
 #include <test/shamap/SHAMapSync_test.cpp>
-#include <test/shamap/SHAMap_test.cpp>
\ No newline at end of file
+#include <test/shamap/SHAMapSyncTiming_test.cpp>
+#include <test/shamap/SHAMap_test.cpp>
+#include <test/shamap/SparseBranchArray_test.cpp>
\ No newline at end of file